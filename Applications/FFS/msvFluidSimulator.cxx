@@ -23,13 +23,16 @@
 #include <petscvec.h>
 
 // SAMRAI headers
+#include <ArrayData.h>
 #include <BergerRigoutsos.h>
 #include <CartesianGridGeometry.h>
 #include <CartesianPatchGeometry.h>
+#include <CellData.h>
 #include <LoadBalancer.h>
 #include <Patch.h>
 #include <PatchHierarchy.h>
 #include <SAMRAI_config.h>
+#include <SideData.h>
 #include <StandardTagAndInitialize.h>
 #include <Variable.h>
 #include <VariableDatabase.h>
@@ -56,6 +59,7 @@
 #include <vtkHierarchicalBoxDataSet.h>
 #include <vtkAMRBox.h>
 #include <vtkUniformGrid.h>
+#include <vtkCellData.h>
 #include <vtkDoubleArray.h>
 #include <vtkObjectFactory.h>
 #include <vtkPointData.h>
@@ -69,6 +73,10 @@
 #include <vtkDelaunay2D.h>
 #include <vtkTimerLog.h>
 #include <vtkNew.h>
+#include <vtkWeakPointer.h>
+
+// STD includes
+#include <vector>
 
 // -----------------------------------------------------------------------------
 class msvFluidSimulator::vtkInternal
@@ -105,11 +113,23 @@ public:
   void InitializeImmersedBoundaryMethod(vtkPolyData *polydata);
   void InitializeBoundaryConditions();
 
-  // Extract velocity and pressure data
-  void SetPointData(vtkHierarchicalBoxDataSet *dataset);
+  // Map velocity and pressure data into the cell arrays of the grids
+  void SetCellData(vtkHierarchicalBoxDataSet *dataset);
+
+  // Create grid vtk hierarchy from SAMRAI data structures, unless the
+  // patch boxes are the same as when the hierarchy was last created.
+  // Return true if the hierarchy was created.
+  bool SetDataset(vtkHierarchicalBoxDataSet *dataset);
 
-  // Create grid vtk hierarchy from SAMRAI data structures
-  void SetDataset(vtkHierarchicalBoxDataSet *dataset);
+  // Set the cell array name of grid to the depth component of data,
+  // without copy if data covers the cells of grid (ghostBox)
+  void MapCellArray(vtkUniformGrid *grid, const Box<3> &ghostBox,
+                    ArrayData<3,double> &data, int depth, const char *name);
+
+  // Set the cell array name of grid to the average of the side-centered
+  // data normal to axis on the two sides of each cell
+  void AverageSideArray(vtkUniformGrid *grid, const Box<3> &ghostBox,
+                        SideData<3,double> &data, int axis, const char *name);
 
   void SetGridDatabase();
   void SetIBDatabase();
@@ -138,6 +158,19 @@ public:
   Pointer<MemoryDatabase>               IBDatabase;
   Pointer<MemoryDatabase>               BCDatabase;
   vtkSmartPointer<vtkPolyData>          LagrangianDataset;
+
+  // Grid of each local patch, indexed by level and patch number, and the
+  // patch box grown by the ghost cells of the pressure data it covers
+  struct PatchGrid
+    {
+    vtkSmartPointer<vtkUniformGrid> Grid;
+    Box<3>                          GhostBox;
+    };
+  std::vector<std::vector<PatchGrid> >  PatchGrids;
+  // Number of levels, then number of patches and number and box of each
+  // patch per level, when the vtk hierarchy was last created
+  std::vector<int>                      HierarchyBoxes;
+  vtkWeakPointer<vtkHierarchicalBoxDataSet> ExportedDataset;
   msvFluidSimulator*                    External;
   Vec                                   PetscPositionVector;
   Vec                                   PetscVelocityVector;
@@ -164,10 +197,48 @@ msvFluidSimulator::vtkInternal::~vtkInternal()
 }
 
 // -----------------------------------------------------------------------------
-void msvFluidSimulator::vtkInternal::SetDataset(
+bool msvFluidSimulator::vtkInternal::SetDataset(
   vtkHierarchicalBoxDataSet* dataset)
 {
-  int numLevels = this->HierarchyPatch->getFinestLevelNumber();
+  if(this->HierarchyPatch.isNull() || this->NavierStokesIntegrator.isNull() ||
+     !dataset)
+    {
+    return false;
+    }
+
+  // The patches only change when the hierarchy is regridded
+  int numLevels = this->HierarchyPatch->getNumberOfLevels();
+  std::vector<int> boxes(1,numLevels);
+  for (int level_num = 0; level_num < numLevels; ++level_num)
+    {
+    Pointer<PatchLevel<3> > level = this->HierarchyPatch->getPatchLevel(
+      level_num);
+    boxes.push_back(level->getNumberOfPatches());
+    for(PatchLevel<3>::Iterator p(level); p; p++)
+      {
+      const Box<3> &patch_box = level->getPatch(p())->getBox();
+      boxes.push_back(p());
+      for (int d = 0; d < 3; ++d)
+        {
+        boxes.push_back(patch_box.lower(d));
+        boxes.push_back(patch_box.upper(d));
+        }
+      }
+    }
+  if(boxes == this->HierarchyBoxes &&
+     this->ExportedDataset.GetPointer() == dataset)
+    {
+    return false;
+    }
+  this->HierarchyBoxes.swap(boxes);
+  this->ExportedDataset = dataset;
+
+  int pressureIdx =
+    VariableDatabase<3>::getDatabase()->mapVariableAndContextToIndex(
+      this->NavierStokesIntegrator->getPressureVariable(),
+      this->NavierStokesIntegrator->getCurrentContext());
+
+  dataset->Initialize();
   dataset->SetNumberOfLevels(numLevels);
 
   Pointer<CartesianGridGeometryType> gridGeometry =
@@ -175,11 +246,14 @@ void msvFluidSimulator::vtkInternal::SetDataset(
 
   const double * X0 = gridGeometry->getXLower();
 
+  this->PatchGrids.clear();
+  this->PatchGrids.resize(numLevels);
   for (int level_num = 0; level_num < numLevels; ++level_num)
     {
     Pointer<PatchLevel<3> > level = this->HierarchyPatch->getPatchLevel(
       level_num);
-    dataset->SetRefinementRatio(level_num,4);
+    dataset->SetRefinementRatio(level_num,this->External->RefinamentRatio);
+    this->PatchGrids[level_num].resize(level->getNumberOfPatches());
 
     for(PatchLevel<3>::Iterator p(level); p; p++)
       {
@@ -194,24 +268,43 @@ void msvFluidSimulator::vtkInternal::SetDataset(
       const int *    hi  = patch_box.upper();
       vtkAMRBox      box = this->GetAMRBox(lo,hi,X0,dx);
 
+      // The grid covers the ghost cells of the pressure so that its
+      // cell data can be mapped without copy
+      int ghosts[3] = {0, 0, 0};
+      Pointer<PatchData<3> > pressure_data = patch->getPatchData(pressureIdx);
+      if(!pressure_data.isNull())
+        {
+        const IntVector<3> &ghost_width = pressure_data->getGhostCellWidth();
+        for (int d = 0; d < 3; ++d)
+          {
+          ghosts[d] = ghost_width(d);
+          }
+        }
 
       vtkSmartPointer<vtkUniformGrid> grid =
         vtkSmartPointer<vtkUniformGrid>::New();
-      grid->Initialize(&box);
+      grid->Initialize(&box,ghosts);
+
+      PatchGrid &patch_grid = this->PatchGrids[level_num][p()];
+      patch_grid.Grid     = grid;
+      patch_grid.GhostBox = patch_box;
+      patch_grid.GhostBox.grow(IntVector<3>(ghosts[0],ghosts[1],ghosts[2]));
 
       int id          = patch->getPatchNumber();
       int patch_level = patch->getPatchLevelNumber();
       dataset->SetDataSet(patch_level,id,box,grid);
       }
     }
+  return true;
 }
 
 // -----------------------------------------------------------------------------
-void msvFluidSimulator::vtkInternal::SetPointData(
+void msvFluidSimulator::vtkInternal::SetCellData(
   vtkHierarchicalBoxDataSet* dataset)
 {
   if(this->HierarchyPatch.isNull() || this->NavierStokesIntegrator.isNull() ||
-     this->GridGeometry.isNull() || !dataset)
+     this->GridGeometry.isNull() || !dataset ||
+     this->ExportedDataset.GetPointer() != dataset)
     {
     return;
     }
@@ -233,65 +326,172 @@ void msvFluidSimulator::vtkInternal::SetPointData(
     variableDatabase->mapVariableAndContextToIndex(pressureVariable,
       this->NavierStokesIntegrator->getCurrentContext());
 
-  int num_levels = this->HierarchyPatch->getFinestLevelNumber();
+  const char *velocityNames[] =
+    {
+    "velocity_x",
+    "velocity_y",
+    "velocity_z"
+    };
 
-  vtkCompositeDataIterator *datasetIterator = dataset->NewIterator();
+  int num_levels = static_cast<int>(this->PatchGrids.size());
   for (int level_num = 0; level_num < num_levels; ++level_num)
     {
     Pointer<PatchLevel<3> > level = HierarchyPatch->getPatchLevel(level_num);
     for(PatchLevel<3>::Iterator p(level); p; p++)
       {
       Pointer<Patch<3> > patch = level->getPatch(p());
+      const PatchGrid &patch_grid = this->PatchGrids[level_num][p()];
+      vtkUniformGrid * grid = patch_grid.Grid;
+      if(!grid)
+        {
+        continue;
+        }
 
-      Box<3>                              patch_box      = patch->getBox();
-      Pointer<CartesianPatchGeometry<3> > patch_geometry =
-        patch->getPatchGeometry();
-
-      vtkAMRBox        box;
-      vtkUniformGrid * grid =
-        dataset->GetDataSet(level,patch->getPatchNumber(),box);
-
-      ArrayData<3,double> &velocity_data =
-        static_cast<CellData<3,
-                             double>*>(patch->getPatchData(velocityIdx).
-                                         getPointer())->getArrayData();
-      ArrayData<3,double> &pressure_data =
-        static_cast<CellData<3,
-                             double>*>(patch->getPatchData(pressureIdx).
-                                         getPointer())->getArrayData();
-
-      // Set pressure array
-      vtkNew<vtkDoubleArray> pressure;
-      pressure->SetArray(pressure_data.getPointer(),
-        pressure_data.getDepth()*pressure_data.getOffset(),1);
-      pressure->SetNumberOfComponents(pressure_data.getDepth());
-      pressure->SetName("pressure");
-      grid->GetPointData()->AddArray(pressure.GetPointer());
-
-      // Set velocity arrays
-      const int ncomponents = velocity_data.getDepth();
-
-      std::string name[] =
+      Pointer<CellData<3,double> > pressure_data =
+        patch->getPatchData(pressureIdx);
+      if(!pressure_data.isNull())
         {
-        "velocity_x",
-        "velocity_y",
-        "velocity_z"
-        };
+        this->MapCellArray(grid,patch_grid.GhostBox,
+          pressure_data->getArrayData(),0,"pressure");
+        }
 
-      for (int i = 0; i < ncomponents; ++i)
+      // The velocity is cell-centered for the collocated integrator and
+      // side-centered for the staggered one
+      Pointer<PatchData<3> > velocity_data = patch->getPatchData(velocityIdx);
+      Pointer<CellData<3,double> > velocity_cell_data = velocity_data;
+      Pointer<SideData<3,double> > velocity_side_data = velocity_data;
+      for (int i = 0; i < 3; ++i)
         {
-        int                    offset = velocity_data.getOffset();
-        vtkNew<vtkDoubleArray> velocities;
-        velocities->SetArray(velocity_data.getPointer(), offset,1);
-        velocities->SetNumberOfComponents(ncomponents);
-        velocities->SetName(name[i].c_str());
-        grid->GetPointData()->AddArray(velocities.GetPointer());
+        if(!velocity_cell_data.isNull() && i < velocity_cell_data->getDepth())
+          {
+          this->MapCellArray(grid,patch_grid.GhostBox,
+            velocity_cell_data->getArrayData(),i,velocityNames[i]);
+          }
+        else if(!velocity_side_data.isNull())
+          {
+          this->AverageSideArray(grid,patch_grid.GhostBox,
+            *velocity_side_data,i,velocityNames[i]);
+          }
         }
+      }
+    }
+}
+
+// -----------------------------------------------------------------------------
+void msvFluidSimulator::vtkInternal::MapCellArray(vtkUniformGrid *grid,
+                                                  const Box<3> &ghostBox,
+                                                  ArrayData<3,double> &data,
+                                                  int depth,
+                                                  const char *name)
+{
+  double *values = data.getPointer(depth);
+  vtkDoubleArray *array =
+    vtkDoubleArray::SafeDownCast(grid->GetCellData()->GetArray(name));
+
+  // SAMRAI stores each depth component contiguously over the data box with
+  // the first index varying fastest, like the cells of a vtkUniformGrid
+  if(data.getBox() == ghostBox)
+    {
+    if(array && array->GetNumberOfTuples() == data.getOffset() &&
+       array->GetPointer(0) == values)
+      {
+      array->Modified();
+      return;
+      }
+    vtkNew<vtkDoubleArray> mapped;
+    mapped->SetName(name);
+    mapped->SetArray(values,data.getOffset(),1);
+    grid->GetCellData()->AddArray(mapped.GetPointer());
+    return;
+    }
 
+  // Otherwise copy the cells the data covers, e.g. with fewer ghost cells
+  vtkSmartPointer<vtkDoubleArray> copy = array;
+  if(!copy || copy->GetNumberOfTuples() != ghostBox.size())
+    {
+    copy = vtkSmartPointer<vtkDoubleArray>::New();
+    copy->SetName(name);
+    copy->SetNumberOfTuples(ghostBox.size());
+    grid->GetCellData()->AddArray(copy);
+    }
+  const Box<3> &dataBox = data.getBox();
+  double *output = copy->GetPointer(0);
+  for (int k = ghostBox.lower(2); k <= ghostBox.upper(2); ++k)
+    {
+    for (int j = ghostBox.lower(1); j <= ghostBox.upper(1); ++j)
+      {
+      for (int i = ghostBox.lower(0); i <= ghostBox.upper(0); ++i, ++output)
+        {
+        const bool inside =
+          dataBox.lower(0) <= i && i <= dataBox.upper(0) &&
+          dataBox.lower(1) <= j && j <= dataBox.upper(1) &&
+          dataBox.lower(2) <= k && k <= dataBox.upper(2);
+        *output = inside ? values[
+          (i-dataBox.lower(0)) + dataBox.numberCells(0)*(
+          (j-dataBox.lower(1)) + dataBox.numberCells(1)*
+          (k-dataBox.lower(2)))] : 0.0;
+        }
       }
     }
+  copy->Modified();
 }
 
+// -----------------------------------------------------------------------------
+void msvFluidSimulator::vtkInternal::AverageSideArray(vtkUniformGrid *grid,
+                                                      const Box<3> &ghostBox,
+                                                      SideData<3,double> &data,
+                                                      int axis,
+                                                      const char *name)
+{
+  vtkSmartPointer<vtkDoubleArray> average =
+    vtkDoubleArray::SafeDownCast(grid->GetCellData()->GetArray(name));
+  if(!average || average->GetNumberOfTuples() != ghostBox.size())
+    {
+    average = vtkSmartPointer<vtkDoubleArray>::New();
+    average->SetName(name);
+    average->SetNumberOfTuples(ghostBox.size());
+    grid->GetCellData()->AddArray(average);
+    }
+
+  // The sides normal to axis of cell (i,j,k) are side (i,j,k) and the next
+  // one along axis
+  ArrayData<3,double> &side_data = data.getArrayData(axis);
+  const Box<3> &sideBox = side_data.getBox();
+  const double *values = side_data.getPointer(0);
+  const int stride[3] =
+    {
+    1,
+    sideBox.numberCells(0),
+    sideBox.numberCells(0)*sideBox.numberCells(1)
+    };
+  double *output = average->GetPointer(0);
+  for (int k = ghostBox.lower(2); k <= ghostBox.upper(2); ++k)
+    {
+    for (int j = ghostBox.lower(1); j <= ghostBox.upper(1); ++j)
+      {
+      for (int i = ghostBox.lower(0); i <= ghostBox.upper(0); ++i, ++output)
+        {
+        const int index[3] = {i, j, k};
+        bool inside = true;
+        for (int d = 0; d < 3; ++d)
+          {
+          inside = inside && sideBox.lower(d) <= index[d] &&
+            index[d] + (d == axis ? 1 : 0) <= sideBox.upper(d);
+          }
+        if(!inside)
+          {
+          *output = 0.0;
+          continue;
+          }
+        const double *side = values +
+          (i-sideBox.lower(0))*stride[0] + (j-sideBox.lower(1))*stride[1] +
+          (k-sideBox.lower(2))*stride[2];
+        *output = 0.5*(side[0] + side[stride[axis]]);
+        }
+      }
+    }
+  average->Modified();
+}
 
 // -----------------------------------------------------------------------------
 void msvFluidSimulator::vtkInternal::Clear()
@@ -319,38 +519,8 @@ void msvFluidSimulator::vtkInternal::SetPointData(vtkPolyData *polydata)
     return;
     }
 
-  const double *X0         = this->GridGeometry->getXLower();
-  int           num_levels = this->HierarchyPatch->getFinestLevelNumber();
-
-  this->External->AMRDataset->SetNumberOfLevels(num_levels);
-
-  for (int level_num = 0; level_num < num_levels; ++level_num)
-    {
-    Pointer<PatchLevel<3> > level =
-      HierarchyPatch->getPatchLevel(level_num);
-    this->External->AMRDataset->SetRefinementRatio(level_num,4);
-
-    for(PatchLevel<3>::Iterator p(level); p; p++)
-      {
-      Pointer<Patch<3> > patch = level->getPatch(p());
-
-      Pointer<CartesianPatchGeometry<3> > patch_geometry =
-        patch->getPatchGeometry();
-      Box<3> patch_box = patch->getBox();
-
-      const double * dx  = patch_geometry->getDx();
-      const int *    lo  = patch_box.lower();
-      const int *    hi  = patch_box.upper();
-      vtkAMRBox      box = this->GetAMRBox(lo,hi,X0,dx);
-
-      vtkNew<vtkUniformGrid> grid;
-      grid->Initialize(&box);
-      int id          = patch->getPatchNumber();
-      int patch_level = patch->getPatchLevelNumber();
-      this->External->AMRDataset->SetDataSet(patch_level,id,box,
-        grid.GetPointer());
-      }
-    }
+  this->SetDataset(this->External->AMRDataset);
+  this->SetCellData(this->External->AMRDataset);
   this->GetLagrangianDataSet(polydata);
 }
 
@@ -517,6 +687,8 @@ void msvFluidSimulator::vtkInternal::InitializeImmersedBoundaryMethod(
   this->IbMethod->registerLInitStrategy(this->IbInitializer);
 
   this->IbSourceFcn = new msvVTKIBSourceGenType;
+  this->IbSourceFcn->setLogging(this->IBDatabase->getDatabase("IBMethod")->
+    getBoolWithDefault("enable_logging", false));
   this->IbMethod->registerIBLagrangianSourceFunction(this->IbSourceFcn);
   this->IbForceFcn = new IBStandardForceGen(true);
   this->IbMethod->registerIBLagrangianForceFunction(this->IbForceFcn);
@@ -721,6 +893,7 @@ msvFluidSimulator::msvFluidSimulator()
   this->FluidDensity        = 1.0;
   this->FluidViscosity      = 0.005;
   this->CFLCondition        = 0.975;
+  this->NumberOfHierarchyUpdates = 0;
 
   PetscInitializeNoArguments();
   SAMRAI_MPI::setCommunicator(PETSC_COMM_WORLD);
@@ -824,12 +997,22 @@ void msvFluidSimulator::Run()
 {
   double dt = this->Internal->TimeIntegrator->getTimeStepSize();
   this->Internal->TimeIntegrator->advanceHierarchy(dt);
+  this->SetDataSet();
 }
 
 // -----------------------------------------------------------------------------
 void msvFluidSimulator::SetDataSet()
 {
-  this->Internal->SetDataset(this->AMRDataset);
+  if(!this->AMRDataset)
+    {
+    return;
+    }
+  if(this->Internal->SetDataset(this->AMRDataset))
+    {
+    ++this->NumberOfHierarchyUpdates;
+    }
+  this->Internal->SetCellData(this->AMRDataset);
+  this->AMRDataset->Modified();
 }
 
 // -----------------------------------------------------------------------------
@@ -841,4 +1024,6 @@ void msvFluidSimulator::PrintSelf(ostream& os, vtkIndent indent)
   os << indent << "CoarsestGridSpacing: " << this->CoarsestGridSpacing << "\n";
   os << indent << "MaxLevels: " << this->MaxLevels << "\n";
   os << indent << "AMRDataset: " << this->AMRDataset << "\n";
+  os << indent << "NumberOfHierarchyUpdates: "
+     << this->NumberOfHierarchyUpdates << "\n";
 }
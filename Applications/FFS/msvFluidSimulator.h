@@ -92,23 +92,33 @@ public:
   vtkGetVector3Macro(SmallestPatch,int);
 
   // Description:
-  // Set / Get the internal vtk AMR dataset
+  // Set / Get the internal vtk AMR dataset. Its grids cover the local
+  // patches with their ghost cells, and their "pressure" and "velocity_x",
+  // "velocity_y" and "velocity_z" cell arrays point into the SAMRAI patch
+  // data whenever the layout allows it (cell-centered data whose ghost
+  // cells match the grid), and are copied otherwise.
   virtual void SetAMRDataset(vtkHierarchicalBoxDataSet*);
   vtkGetMacro(AMRDataset,vtkHierarchicalBoxDataSet*);
+
+  // Description:
+  // Number of times the grids of the AMR dataset have been created, i.e.
+  // after Init() and after each time step that regridded the hierarchy.
+  vtkGetMacro(NumberOfHierarchyUpdates,int);
   
   // Description:
   // Initialize AMR data structure, solver and main algorithms
   virtual void Init(vtkPolyData *polydata);
 
   // Description:
-  // Run one time-step of the fluid solver
+  // Run one time-step of the fluid solver and update the AMR dataset
   virtual void Run();
 
 protected:
   msvFluidSimulator();
   virtual ~msvFluidSimulator();
 
-  // Set hierarchical dataset
+  // Set hierarchical dataset, only recreating its grids when the
+  // hierarchy was regridded
   virtual void SetDataSet();
 
   char* InitFile;
@@ -122,6 +132,7 @@ protected:
   double FluidDensity;
   double FluidViscosity;
   double CFLCondition;
+  int    NumberOfHierarchyUpdates;
 
   class vtkInternal;
   vtkInternal * Internal;
@@ -25,6 +25,7 @@
 #include "msvGridViewerPipeline.h"
 #include "msvVTKDataFileSeriesReader.h"
 #include "msvVTKEmbeddedProbeFilter.h"
+#include "msvVTKTemporalDataSetCache.h"
 
 // VTK includes
 #include "vtkActor.h"
@@ -401,6 +402,41 @@ int msvGridViewerPipeline::readGridFile(const char *gridFileName)
         }
       }
 
+    else if (command == "msvVTKTemporalDataSetCache")
+      {
+      vtkNew<msvVTKTemporalDataSetCache> temporalCache;
+      object = temporalCache.GetPointer();
+      while (optionIndex < options.size())
+        {
+        vtkAlgorithm *inputAlgorithm = 0;
+        if (0 != (inputAlgorithm = this->checkAlgorithmOption("INPUT", name, options, optionIndex, objects)))
+          {
+          temporalCache->SetInputConnection(inputAlgorithm->GetOutputPort());
+          }
+        else if (this->checkOption("MEMORYBUDGET", name, options, optionIndex, /*minArgs*/1))
+          {
+          // in kibibytes
+          unsigned long budget = strtoul(options[optionIndex].c_str(), 0, 10);
+          ++optionIndex;
+          temporalCache->SetMemoryBudget(budget);
+          }
+        else if (this->checkOption("PINNEDNEIGHBORS", name, options, optionIndex, /*minArgs*/1))
+          {
+          int neighbors = atoi(options[optionIndex].c_str());
+          ++optionIndex;
+          temporalCache->SetNumberOfPinnedNeighbors(neighbors);
+          }
+        else
+          {
+          if (optionIndex < options.size())
+            {
+            cerr << "'" << name << "' has unrecognised token '" << options[optionIndex] << "'\n";
+            return 0;
+            }
+          }
+        }
+      }
+
     else if (command == "vtkActor")
       {
       vtkNew<vtkActor> actor;
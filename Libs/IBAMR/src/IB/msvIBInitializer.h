@@ -271,7 +271,36 @@ private:
     readVertexDataset();
 
     /*!
-     * \brief Read the spring data from one or more input files.
+     * \brief Sort the vertices of the specified level into a uniform grid of
+     * bins covering their bounding box, so that getPatchVertices() only visits
+     * the vertices in the bins overlapping a patch.
+     */
+    void
+    binVertices(
+        int level_number);
+
+    /*!
+     * \brief Broadcast the vertex positions of the specified dataset from MPI
+     * process 0 to the other MPI processes.
+     */
+    void
+    broadcastVertexData(
+        int level_number,
+        int j);
+
+    /*!
+     * \brief Broadcast the springs of the specified dataset from MPI process 0
+     * to the other MPI processes, which only compute the uniform spring
+     * properties default_spec.
+     */
+    void
+    broadcastSpringData(
+        int level_number,
+        int j,
+        const SpringSpec& default_spec);
+
+    /*!
+     * \brief Build the springs along the cell edges of one or more datasets.
      */
     void
     readSpringDataset();
@@ -443,10 +472,25 @@ private:
     /*
      * The boolean value determines whether file read batons are employed to
      * prevent multiple MPI processes from accessing the same input files
-     * simultaneously.
+     * simultaneously.  The datasets are already in memory when they are
+     * processed, so the batons are off by default and all MPI processes
+     * process the datasets concurrently.
      */
     bool d_use_file_batons;
 
+    /*
+     * The boolean value determines whether only MPI process 0 processes the
+     * datasets and broadcasts the vertex positions and springs to the other
+     * MPI processes, in which case the file read batons are not used.
+     */
+    bool d_broadcast_datasets;
+
+    /*
+     * The number of threads used to build the springs of each dataset (the
+     * VTK default if not positive).
+     */
+    int d_num_threads;
+
     /*
      * The maximum number of levels in the Cartesian grid patch hierarchy and a
      * vector of boolean values indicating whether a particular level has been
@@ -492,6 +536,21 @@ private:
     std::vector<std::vector<int> > d_num_vertex, d_vertex_offset;
     std::vector<std::vector<std::vector<blitz::TinyVector<double,NDIM> > > > d_vertex_posn;
 
+    /*
+     * Uniform grid of bins over the vertices of each level.  The vertices of
+     * bin b are vertices[offsets[b]] ... vertices[offsets[b+1]-1], where the
+     * bins are numbered with the first dimension varying fastest.  The
+     * vertices on x_upper fall in the last bin along each dimension.
+     */
+    struct VertexBins
+    {
+        blitz::TinyVector<double,NDIM> x_lower, x_upper, dx;
+        blitz::TinyVector<int,NDIM> num_bins;
+        std::vector<int> offsets;
+        std::vector<std::pair<int,int> > vertices;
+    };
+    std::vector<VertexBins> d_vertex_bins;
+
     /*
      * Edge data structures.
      */
@@ -513,8 +572,6 @@ private:
      */
     std::vector<std::vector<bool> > d_enable_springs;
 
-    std::vector<std::vector<std::multimap<int,Edge> > > d_spring_edge_map;
-
     struct SpringSpec
     {
         double stiffness, rest_length;
@@ -523,7 +580,20 @@ private:
         int subdomain_idx;
 #endif
     };
-    std::vector<std::vector<std::map<Edge,SpringSpec,EdgeComp> > > d_spring_spec_data;
+
+    /*
+     * The springs of each dataset, sorted by master vertex.  Each spring is
+     * associated with only its lower (master) vertex: the springs of local
+     * vertex k connect canonical index d_vertex_offset+k to slave_idxs[i] and
+     * have properties specs[i], for offsets[k] <= i < offsets[k+1].
+     */
+    struct SpringEdges
+    {
+        std::vector<int> offsets;
+        std::vector<int> slave_idxs;
+        std::vector<SpringSpec> specs;
+    };
+    std::vector<std::vector<SpringEdges> > d_spring_edges;
 
     std::vector<std::vector<bool> > d_using_uniform_spring_stiffness;
     std::vector<std::vector<double> > d_uniform_spring_stiffness;
@@ -62,6 +62,10 @@
 /////////////////////////////// CLASS DEFINITION /////////////////////////////
 
 class vtkDataSet;
+class vtkDoubleArray;
+class vtkPoints;
+class vtkPolyData;
+class msvVTKBoundaryEdgeSources;
 
 namespace IBAMR
 {
@@ -148,6 +152,14 @@ public:
     getSourcePressures(
         int ln) const;
 
+    /*!
+     * \brief Enable or disable logging of the source location timings to
+     * plog.  Logging is disabled by default.
+     */
+    void
+    setLogging(
+        bool enable_logging = true);
+
     /*!
      * \brief Set VTK dataset
      */
@@ -267,6 +279,31 @@ private:
     void
     getFromRestart();
 
+    /*!
+     * \brief Lagrangian coordinates of a level wrapped as VTK points: the
+     * scattered vector and the VTK arrays are kept from one time step to the
+     * next and updated in place.
+     */
+    struct LagrangianPointsBridge
+    {
+        LagrangianPointsBridge();
+
+        Vec X_lag;
+        int size;
+        vtkSmartPointer<vtkDoubleArray> coords;
+        vtkSmartPointer<vtkPoints> points;
+    };
+
+    /*!
+     * \brief Return the bridge of the specified level, set as the points of
+     * data, (re)allocating it only when the size of X_vec changed.
+     */
+    LagrangianPointsBridge&
+    getPointsBridge(
+        int level_number,
+        Vec X_vec,
+        vtkPolyData* data);
+
     /*!
      * The numbers of sources/sinks on each level of the patch hierarchy.
      */
@@ -278,6 +315,13 @@ private:
     static std::vector<std::vector<double> > s_source_radii;
 
     static std::vector<vtkSmartPointer<vtkDataSet> > polyData;
+
+    /*!
+     * \brief Boundary edge source filters of each level, kept across time
+     * steps to reuse the boundary loops of the fixed surface topology.
+     */
+    static std::vector<vtkSmartPointer<msvVTKBoundaryEdgeSources> > sourceFilters;
+
     /*
      * Source/sink data.
      */
@@ -286,6 +330,16 @@ private:
     std::vector<std::vector<double> > d_r_src;
     std::vector<std::vector<double> > d_Q_src, d_P_src;
 
+    /*
+     * Lagrangian coordinates of each level.
+     */
+    std::vector<LagrangianPointsBridge> d_X_bridge;
+
+    /*
+     * Whether to log the source location timings.
+     */
+    bool d_do_log;
+
 };
 }// namespace IBAMR
 
@@ -0,0 +1,142 @@
+/*==============================================================================
+
+  Library: MSVTK
+
+  Copyright (c) Kitware Inc.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0.txt
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// MSVTK
+#include "msvVTKBoundaryEdgeSources.h"
+
+// VTK includes
+#include "vtkCylinderSource.h"
+#include "vtkDataArray.h"
+#include "vtkNew.h"
+#include "vtkPointData.h"
+#include "vtkPoints.h"
+#include "vtkPolyData.h"
+
+// STD includes
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+
+// -----------------------------------------------------------------------------
+// An open cylinder has two boundary loops, whose sources are at the center
+// of the loops with 30% of the cylinder radius.
+int msvVTKBoundaryEdgeSourcesTest1(int, char*[])
+{
+  vtkNew<vtkCylinderSource> cylinder;
+  cylinder->SetResolution(16);
+  cylinder->SetHeight(2.);
+  cylinder->SetRadius(1.);
+  cylinder->CappingOff();
+
+  cylinder->Update();
+  vtkNew<vtkPolyData> surface;
+  surface->DeepCopy(cylinder->GetOutput());
+
+  vtkNew<msvVTKBoundaryEdgeSources> sources;
+  sources->SetInput(surface.GetPointer());
+  sources->Update();
+
+  vtkPolyData *output = sources->GetOutput();
+  if (output->GetNumberOfPoints() != 2 ||
+      output->GetNumberOfVerts() != 2 ||
+      sources->GetRadii().size() != 2)
+    {
+    std::cerr << "Error: " << output->GetNumberOfPoints()
+              << " sources found; expected 2" << std::endl;
+    return EXIT_FAILURE;
+    }
+  vtkDataArray *radii = output->GetPointData()->GetArray("radii");
+  if (!radii || radii->GetNumberOfTuples() != 2)
+    {
+    std::cerr << "Error: Missing 'radii' array" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  const double tol = 1e-6;
+  bool top = false, bottom = false;
+  for (vtkIdType i = 0; i < 2; ++i)
+    {
+    double center[3];
+    output->GetPoint(i, center);
+    top = top || fabs(center[1] - 1.) < tol;
+    bottom = bottom || fabs(center[1] + 1.) < tol;
+    if (fabs(center[0]) > tol || fabs(center[2]) > tol ||
+        fabs(sources->GetRadius(i) - .3) > tol ||
+        fabs(radii->GetTuple1(i) - .3) > tol)
+      {
+      std::cerr << "Error: Wrong source " << i << " at (" << center[0] << ","
+                << center[1] << "," << center[2] << ") of radius "
+                << sources->GetRadius(i) << std::endl;
+      return EXIT_FAILURE;
+      }
+    }
+  if (!top || !bottom)
+    {
+    std::cerr << "Error: Sources are not at both ends" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // Moving the points only recomputes the sources from the cached loops
+  vtkPoints *points = surface->GetPoints();
+  for (vtkIdType i = 0; i < points->GetNumberOfPoints(); ++i)
+    {
+    double p[3];
+    points->GetPoint(i, p);
+    points->SetPoint(i, 2. * p[0] + 1., p[1], 2. * p[2]);
+    }
+  points->Modified();
+  sources->Update();
+  output = sources->GetOutput();
+  if (sources->GetNumberOfTopologyUpdates() != 1 ||
+      output->GetNumberOfPoints() != 2)
+    {
+    std::cerr << "Error: Boundary loops extracted "
+              << sources->GetNumberOfTopologyUpdates()
+              << " times; expected 1" << std::endl;
+    return EXIT_FAILURE;
+    }
+  for (vtkIdType i = 0; i < 2; ++i)
+    {
+    double center[3];
+    output->GetPoint(i, center);
+    if (fabs(center[0] - 1.) > tol || fabs(center[2]) > tol ||
+        fabs(sources->GetRadius(i) - .6) > tol)
+      {
+      std::cerr << "Error: Wrong moved source " << i << " at (" << center[0]
+                << "," << center[1] << "," << center[2] << ") of radius "
+                << sources->GetRadius(i) << std::endl;
+      return EXIT_FAILURE;
+      }
+    }
+
+  // Changing the polygons extracts the loops again
+  surface->GetPolys()->Modified();
+  surface->Modified();
+  sources->Update();
+  if (sources->GetNumberOfTopologyUpdates() != 2)
+    {
+    std::cerr << "Error: Boundary loops extracted "
+              << sources->GetNumberOfTopologyUpdates()
+              << " times; expected 2" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+}
@@ -19,11 +19,11 @@
 ==============================================================================*/
 
 // STD INCLUDES
+#include <algorithm>
+#include <cmath>
 #include <vector>
 
 // VTK INCLUDES
-#include <vtkCleanPolyData.h>
-#include <vtkFeatureEdges.h>
 #include <vtkType.h>
 #include <vtkInformation.h>
 #include <vtkInformationVector.h>
@@ -33,13 +33,70 @@
 #include <vtkDoubleArray.h>
 #include <vtkPolyData.h>
 #include <vtkCellArray.h>
+#include <vtkIdTypeArray.h>
 #include <vtkPointData.h>
-#include <vtkPolyDataConnectivityFilter.h>
-#include <vtkSelectPolyData.h>
 
 // MSV INCLUDES
 #include "msvVTKBoundaryEdgeSources.h"
 
+namespace
+{
+
+// ----------------------------------------------------------------------------
+// Polygon edge from point A to point B (A < B), Order is the rank of the
+// edge in the traversal of the input cells.
+struct msvEdge
+{
+  vtkIdType A;
+  vtkIdType B;
+  vtkIdType Order;
+
+  bool operator<(const msvEdge &other) const
+  {
+    return this->A < other.A || (this->A == other.A && this->B < other.B);
+  }
+};
+
+// ----------------------------------------------------------------------------
+bool msvEdgeOrderLess(const msvEdge &a, const msvEdge &b)
+{
+  return a.Order < b.Order;
+}
+
+// ----------------------------------------------------------------------------
+void msvAddEdge(std::vector<msvEdge> &edges, vtkIdType a, vtkIdType b)
+{
+  if (a == b)
+    {
+    return;
+    }
+  msvEdge edge;
+  edge.A = std::min(a, b);
+  edge.B = std::max(a, b);
+  edge.Order = static_cast<vtkIdType>(edges.size());
+  edges.push_back(edge);
+}
+
+// ----------------------------------------------------------------------------
+unsigned long msvGetCellArrayMTime(vtkCellArray *cells)
+{
+  return std::max(cells->GetMTime(), cells->GetData()->GetMTime());
+}
+
+// ----------------------------------------------------------------------------
+// Union-find root of point id, with path halving.
+vtkIdType msvFindRoot(std::vector<vtkIdType> &parents, vtkIdType id)
+{
+  while (parents[id] != id)
+    {
+    parents[id] = parents[parents[id]];
+    id = parents[id];
+    }
+  return id;
+}
+
+}
+
 // ----------------------------------------------------------------------------
 class msvVTKBoundaryEdgeSources::vtkInternal
 {
@@ -53,8 +110,217 @@ public:
     return radii;
   }
 
+  // Boundary loops: the points of region i are
+  // RegionPointIds[RegionOffsets[i]..RegionOffsets[i+1][.
+  std::vector<vtkIdType> RegionOffsets;
+  std::vector<vtkIdType> RegionPointIds;
+
+  // Topology the loops were extracted from.
+  vtkCellArray *Polys;
+  vtkCellArray *Strips;
+  unsigned long TopologyMTime;
+  vtkIdType NumberOfPoints;
+
+  vtkInternal()
+    : Polys(0), Strips(0), TopologyMTime(0), NumberOfPoints(-1)
+  {
+  }
+
+  bool IsTopologyUpToDate(vtkPolyData *input);
+
+  void ExtractBoundaryLoops(vtkPolyData *input);
+  void ComputeSources(vtkPoints *inputPoints, vtkPoints *centers,
+                      vtkDoubleArray *sourceRadii);
 };
 
+// ----------------------------------------------------------------------------
+// Return true if the loops were extracted from the polygons and strips of
+// input, as they are now: only its points may have changed since.
+bool msvVTKBoundaryEdgeSources::vtkInternal
+::IsTopologyUpToDate(vtkPolyData *input)
+{
+  return this->Polys == input->GetPolys() &&
+    this->Strips == input->GetStrips() &&
+    this->NumberOfPoints == input->GetNumberOfPoints() &&
+    this->TopologyMTime == std::max(msvGetCellArrayMTime(input->GetPolys()),
+                                    msvGetCellArrayMTime(input->GetStrips()));
+}
+
+// ----------------------------------------------------------------------------
+// Label the connected loops of boundary edges (edges of a single polygon or
+// strip triangle) with a union-find over their points. Regions are numbered
+// in the order their first boundary edge is met in the input cells.
+void msvVTKBoundaryEdgeSources::vtkInternal
+::ExtractBoundaryLoops(vtkPolyData *input)
+{
+  std::vector<msvEdge> edges;
+  vtkIdType npts = 0;
+  vtkIdType *pts = 0;
+  vtkCellArray *polys = input->GetPolys();
+  edges.reserve(polys->GetNumberOfConnectivityEntries());
+  for (polys->InitTraversal(); polys->GetNextCell(npts, pts);)
+    {
+    for (vtkIdType i = 0; i < npts; ++i)
+      {
+      msvAddEdge(edges, pts[i], pts[(i + 1) % npts]);
+      }
+    }
+  vtkCellArray *strips = input->GetStrips();
+  for (strips->InitTraversal(); strips->GetNextCell(npts, pts);)
+    {
+    for (vtkIdType i = 0; i + 2 < npts; ++i)
+      {
+      msvAddEdge(edges, pts[i], pts[i + 1]);
+      msvAddEdge(edges, pts[i + 1], pts[i + 2]);
+      msvAddEdge(edges, pts[i + 2], pts[i]);
+      }
+    }
+
+  // Boundary edges are the edges used once.
+  std::sort(edges.begin(), edges.end());
+  std::vector<msvEdge> boundaryEdges;
+  for (size_t i = 0; i < edges.size();)
+    {
+    size_t j = i + 1;
+    while (j < edges.size() &&
+           edges[j].A == edges[i].A && edges[j].B == edges[i].B)
+      {
+      ++j;
+      }
+    if (j == i + 1)
+      {
+      boundaryEdges.push_back(edges[i]);
+      }
+    i = j;
+    }
+  std::vector<msvEdge>().swap(edges);
+  std::sort(boundaryEdges.begin(), boundaryEdges.end(), msvEdgeOrderLess);
+
+  // Union the end points of the boundary edges.
+  const vtkIdType numPts = input->GetNumberOfPoints();
+  std::vector<vtkIdType> parents(numPts, -1);
+  for (size_t i = 0; i < boundaryEdges.size(); ++i)
+    {
+    const msvEdge &edge = boundaryEdges[i];
+    if (parents[edge.A] < 0)
+      {
+      parents[edge.A] = edge.A;
+      }
+    if (parents[edge.B] < 0)
+      {
+      parents[edge.B] = edge.B;
+      }
+    vtkIdType rootA = msvFindRoot(parents, edge.A);
+    vtkIdType rootB = msvFindRoot(parents, edge.B);
+    if (rootA != rootB)
+      {
+      parents[std::max(rootA, rootB)] = std::min(rootA, rootB);
+      }
+    }
+
+  // Number the regions and list their points, each point once.
+  std::vector<vtkIdType> regions(numPts, -1);
+  std::vector<char> listed(numPts, 0);
+  std::vector<vtkIdType> pointIds;
+  std::vector<vtkIdType> pointRegions;
+  vtkIdType numRegions = 0;
+  for (size_t i = 0; i < boundaryEdges.size(); ++i)
+    {
+    const vtkIdType ends[2] = { boundaryEdges[i].A, boundaryEdges[i].B };
+    for (int e = 0; e < 2; ++e)
+      {
+      if (listed[ends[e]])
+        {
+        continue;
+        }
+      const vtkIdType root = msvFindRoot(parents, ends[e]);
+      if (regions[root] < 0)
+        {
+        regions[root] = numRegions++;
+        }
+      listed[ends[e]] = 1;
+      pointIds.push_back(ends[e]);
+      pointRegions.push_back(regions[root]);
+      }
+    }
+
+  // Group the points by region.
+  this->RegionOffsets.assign(numRegions + 1, 0);
+  for (size_t i = 0; i < pointRegions.size(); ++i)
+    {
+    ++this->RegionOffsets[pointRegions[i] + 1];
+    }
+  for (vtkIdType r = 0; r < numRegions; ++r)
+    {
+    this->RegionOffsets[r + 1] += this->RegionOffsets[r];
+    }
+  this->RegionPointIds.resize(pointIds.size());
+  std::vector<vtkIdType> fill(this->RegionOffsets.begin(),
+                              this->RegionOffsets.end() - 1);
+  for (size_t i = 0; i < pointIds.size(); ++i)
+    {
+    this->RegionPointIds[fill[pointRegions[i]]++] = pointIds[i];
+    }
+
+  this->Polys = polys;
+  this->Strips = strips;
+  this->NumberOfPoints = numPts;
+  this->TopologyMTime = std::max(msvGetCellArrayMTime(polys),
+                                 msvGetCellArrayMTime(strips));
+}
+
+// ----------------------------------------------------------------------------
+// Source of each boundary loop: the center of the bounds of its points,
+// with 30% of the largest distance of its points to that center as radius.
+void msvVTKBoundaryEdgeSources::vtkInternal
+::ComputeSources(vtkPoints *inputPoints, vtkPoints *centers,
+                 vtkDoubleArray *sourceRadii)
+{
+  const vtkIdType numRegions =
+    static_cast<vtkIdType>(this->RegionOffsets.size()) - 1;
+  this->radii.resize(numRegions, 0);
+  centers->SetNumberOfPoints(numRegions);
+  sourceRadii->SetNumberOfValues(numRegions);
+  for (vtkIdType r = 0; r < numRegions; ++r)
+    {
+    const vtkIdType begin = this->RegionOffsets[r];
+    const vtkIdType end = this->RegionOffsets[r + 1];
+    double bounds[6] = { VTK_DOUBLE_MAX, -VTK_DOUBLE_MAX,
+                         VTK_DOUBLE_MAX, -VTK_DOUBLE_MAX,
+                         VTK_DOUBLE_MAX, -VTK_DOUBLE_MAX };
+    double u[3];
+    for (vtkIdType k = begin; k < end; ++k)
+      {
+      inputPoints->GetPoint(this->RegionPointIds[k], u);
+      for (int c = 0; c < 3; ++c)
+        {
+        bounds[2 * c] = std::min(bounds[2 * c], u[c]);
+        bounds[2 * c + 1] = std::max(bounds[2 * c + 1], u[c]);
+        }
+      }
+
+    double center[] =
+      {
+      .5*(bounds[0]+bounds[1]),
+      .5*(bounds[2]+bounds[3]),
+      .5*(bounds[4]+bounds[5])
+      };
+
+    //  Compute approximate radius
+    double radius2 = 0;
+    for (vtkIdType k = begin; k < end; ++k)
+      {
+      inputPoints->GetPoint(this->RegionPointIds[k], u);
+      radius2 = std::max(radius2, vtkMath::Distance2BetweenPoints(u, center));
+      }
+
+    // The source radius is 30% of entire radius
+    this->radii[r] = .3*sqrt(radius2);
+    sourceRadii->SetValue(r, this->radii[r]);
+    centers->SetPoint(r, center);
+    }
+}
+
 // ----------------------------------------------------------------------------
 vtkStandardNewMacro ( msvVTKBoundaryEdgeSources );
 
@@ -62,6 +328,7 @@ vtkStandardNewMacro ( msvVTKBoundaryEdgeSources );
 msvVTKBoundaryEdgeSources::msvVTKBoundaryEdgeSources()
 {
   this->Internal = new vtkInternal;
+  this->NumberOfTopologyUpdates = 0;
 }
 
 // ----------------------------------------------------------------------------
@@ -96,72 +363,22 @@ int msvVTKBoundaryEdgeSources::RequestData(
     return 1;
     }
 
-  // Extract boundary edges
-  vtkNew<vtkFeatureEdges> boundaryEdges;
-  boundaryEdges->SetInput ( input );
-  boundaryEdges->FeatureEdgesOff();
-  boundaryEdges->NonManifoldEdgesOff();
-  boundaryEdges->ColoringOff();
-  boundaryEdges->Update();
-  // Extract individual connected regions
-  vtkNew<vtkPolyDataConnectivityFilter> boundaryEdgesConnectivity;
-  boundaryEdgesConnectivity->SetInput( boundaryEdges->GetOutput() );
-  boundaryEdgesConnectivity->SetExtractionModeToSpecifiedRegions();
-  boundaryEdgesConnectivity->Update();
-
-  vtkNew<vtkMath>   math;
-  vtkNew<vtkPoints> points;
-
-  // Loop over connected regions
-  int numRegions = boundaryEdgesConnectivity->GetNumberOfExtractedRegions();
-  this->Internal->radii.resize(numRegions,0);
+  // Label the boundary edge loops in a single pass over the polygons,
+  // unless only the points moved since the last execution
+  if (!this->Internal->IsTopologyUpToDate(input))
+    {
+    this->Internal->ExtractBoundaryLoops(input);
+    ++this->NumberOfTopologyUpdates;
+    }
 
+  vtkNew<vtkPoints> points;
   vtkNew<vtkDoubleArray> radii;
   radii->SetName("radii");
-  radii->SetNumberOfValues(numRegions);
-  for ( int i = 0; i < numRegions; ++i )
-    {
-    boundaryEdgesConnectivity->AddSpecifiedRegion(i);
-    boundaryEdgesConnectivity->Update();
-    // Get rid of orphan nodes
-    vtkNew<vtkCleanPolyData> region;
-    region->CreateDefaultLocator();
-    region->SetInputConnection(boundaryEdgesConnectivity->GetOutputPort());
-    region->Update();
-
-    vtkPoints *boundaryPoints = region->GetOutput()->GetPoints();
-
-    double bounds[6] = {0};
-    boundaryPoints->GetBounds(bounds);
-
-    double center[] =
-      {
-      .5*(bounds[0]+bounds[1]),
-      .5*(bounds[2]+bounds[3]),
-      .5*(bounds[4]+bounds[5])
-      };
-
-    //  Compute approximate radius
-    double radius = 0;
-    for(vtkIdType k = 0; k < boundaryPoints->GetNumberOfPoints(); ++k)
-      {
-      double v[3] = {0}, u[3] = {0};
-      boundaryPoints->GetPoint(k,u);
-      math->Subtract(u,center,v);
-      double r = math->Norm(v);
-      if (radius < r)
-        radius = r;
-      }
-     radii->SetValue(i,.3*radius);
-
-    // The source radius is 30% of entire radius
-    this->Internal->radii[i] = .3*radius;
-    points->InsertNextPoint(center);
-
-    boundaryEdgesConnectivity->DeleteSpecifiedRegion(i);
-    }
+  this->Internal->ComputeSources(input->GetPoints(), points.GetPointer(),
+                                 radii.GetPointer());
 
   vtkNew<vtkCellArray> vertices;
+  vertices->Allocate(2 * points->GetNumberOfPoints());
   for ( vtkIdType i = 0; i < points->GetNumberOfPoints(); ++i )
     {
     vertices->InsertNextCell(1);
@@ -187,5 +404,6 @@ std::vector<double> &msvVTKBoundaryEdgeSources::GetRadii()
 void msvVTKBoundaryEdgeSources::PrintSelf(ostream& os, vtkIndent indent)
 {
   this->Superclass::PrintSelf(os,indent);
-
+  os << indent << "NumberOfTopologyUpdates: "
+     << this->NumberOfTopologyUpdates << "\n";
 }
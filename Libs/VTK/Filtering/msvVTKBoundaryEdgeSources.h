@@ -39,6 +39,13 @@ public:
   double GetRadius(unsigned int i);
   std::vector<double> &GetRadii();
 
+  // Description:
+  // Number of times the boundary loops have been extracted from the input
+  // polygons. The loops are kept while the polygons and strips of the input
+  // are unchanged, so that an input whose points move only costs a pass
+  // over the boundary points.
+  vtkGetMacro(NumberOfTopologyUpdates, int);
+
 protected:
   msvVTKBoundaryEdgeSources();
   ~msvVTKBoundaryEdgeSources();
@@ -47,6 +54,8 @@ protected:
   int RequestData(vtkInformation *, vtkInformationVector **,
                   vtkInformationVector *);
 
+  int NumberOfTopologyUpdates;
+
 private:
 
   class vtkInternal;
@@ -0,0 +1,179 @@
+/*==============================================================================
+
+  Library: MSVTK
+
+  Copyright (c) The University of Auckland
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0.txt
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+// MSVTK
+#include "msvVTKEmbeddedProbeFilter.h"
+
+// VTK includes
+#include "vtkCellData.h"
+#include "vtkDataArray.h"
+#include "vtkDoubleArray.h"
+#include "vtkIdTypeArray.h"
+#include "vtkImageData.h"
+#include "vtkNew.h"
+#include "vtkPointData.h"
+#include "vtkPoints.h"
+#include "vtkPolyData.h"
+#include "vtkPolyDataReader.h"
+#include "vtkTestUtilities.h"
+#include "vtkTimerLog.h"
+
+// STD includes
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+
+// -----------------------------------------------------------------------------
+// Time the structured fast path against the generic path on a large input:
+// the parametric coordinates of the msv.vtp embedding are replicated in
+// every voxel of an image. Only added to ctest with MSVTK_BUILD_BENCHMARKS.
+int msvVTKEmbeddedProbeFilterBenchmark1(int argc, char* argv[])
+{
+  const char* file =
+    vtkTestUtilities::ExpandDataFileName(argc,argv,"msv.vtp");
+  vtkNew<vtkPolyDataReader> msvReader;
+  msvReader->SetFileName(file);
+  msvReader->Update();
+  delete [] file;
+  vtkDataArray* msvPCoords =
+    msvReader->GetOutput()->GetPointData()->GetArray("pcoord");
+  if (!msvPCoords || msvPCoords->GetNumberOfTuples() == 0)
+    {
+    std::cerr << "Error: Missing 'pcoord' array in msv.vtp" << std::endl;
+    return EXIT_FAILURE;
+    }
+  const vtkIdType numMsvPoints = msvPCoords->GetNumberOfTuples();
+
+  // Source: a linear point field is interpolated exactly in voxels
+  const int cellDim = 30;
+  vtkNew<vtkImageData> image;
+  image->SetDimensions(cellDim + 1, cellDim + 1, cellDim + 1);
+  image->SetOrigin(0.0, 0.0, 0.0);
+  image->SetSpacing(1.0, 1.0, 1.0);
+  vtkNew<vtkDoubleArray> pointTestVal;
+  pointTestVal->SetName("PointTestVal");
+  pointTestVal->SetNumberOfTuples(image->GetNumberOfPoints());
+  for (vtkIdType i = 0; i < image->GetNumberOfPoints(); ++i)
+    {
+    double x[3];
+    image->GetPoint(i, x);
+    pointTestVal->SetValue(i, x[0] + 2.0 * x[1] + 3.0 * x[2]);
+    }
+  image->GetPointData()->AddArray(pointTestVal.GetPointer());
+  vtkNew<vtkDoubleArray> cellTestVal;
+  cellTestVal->SetName("CellTestVal");
+  cellTestVal->SetNumberOfTuples(image->GetNumberOfCells());
+  for (vtkIdType i = 0; i < image->GetNumberOfCells(); ++i)
+    {
+    cellTestVal->SetValue(i, static_cast<double>(i));
+    }
+  image->GetCellData()->AddArray(cellTestVal.GetPointer());
+
+  // Input: the msv.vtp embedding in every voxel
+  const vtkIdType numPts = image->GetNumberOfCells() * numMsvPoints;
+  vtkNew<vtkPolyData> embedded;
+  vtkNew<vtkPoints> points;
+  points->SetNumberOfPoints(numPts);
+  vtkNew<vtkIdTypeArray> cellIds;
+  cellIds->SetName("cellId");
+  cellIds->SetNumberOfTuples(numPts);
+  vtkNew<vtkDoubleArray> pcoords;
+  pcoords->SetName("pcoord");
+  pcoords->SetNumberOfComponents(3);
+  pcoords->SetNumberOfTuples(numPts);
+  for (vtkIdType i = 0; i < numPts; ++i)
+    {
+    points->SetPoint(i, 0.0, 0.0, 0.0);
+    cellIds->SetValue(i, i / numMsvPoints);
+    pcoords->SetTuple(i, msvPCoords->GetTuple(i % numMsvPoints));
+    }
+  embedded->SetPoints(points.GetPointer());
+  embedded->GetPointData()->AddArray(cellIds.GetPointer());
+  embedded->GetPointData()->AddArray(pcoords.GetPointer());
+
+  vtkNew<msvVTKEmbeddedProbeFilter> fastProbe;
+  fastProbe->SetInput(embedded.GetPointer());
+  fastProbe->SetInput(1, image.GetPointer());
+  fastProbe->SetCellIdArrayName("cellId");
+  fastProbe->SetParametricCoordinateArrayName("pcoord");
+  fastProbe->CacheWeightsOff();
+
+  vtkNew<msvVTKEmbeddedProbeFilter> genericProbe;
+  genericProbe->SetInput(embedded.GetPointer());
+  genericProbe->SetInput(1, image.GetPointer());
+  genericProbe->SetCellIdArrayName("cellId");
+  genericProbe->SetParametricCoordinateArrayName("pcoord");
+  genericProbe->CacheWeightsOff();
+  genericProbe->StructuredFastPathOff();
+
+  vtkNew<vtkTimerLog> timer;
+  timer->StartTimer();
+  fastProbe->Update();
+  timer->StopTimer();
+  const double fastTime = timer->GetElapsedTime();
+  timer->StartTimer();
+  genericProbe->Update();
+  timer->StopTimer();
+  const double genericTime = timer->GetElapsedTime();
+  std::cout << numPts << " points probed in " << image->GetNumberOfCells()
+            << " voxels: structured " << fastTime << "s, generic "
+            << genericTime << "s" << std::endl;
+
+  vtkDataSet* fastOutput = fastProbe->GetOutput();
+  vtkDataSet* genericOutput = genericProbe->GetOutput();
+  if (fastOutput->GetNumberOfPoints() != numPts ||
+      genericOutput->GetNumberOfPoints() != numPts)
+    {
+    std::cerr << "Error: Wrong number of output points" << std::endl;
+    return EXIT_FAILURE;
+    }
+  vtkDataArray* fastPointVal =
+    fastOutput->GetPointData()->GetArray("PointTestVal");
+  vtkDataArray* fastCellVal =
+    fastOutput->GetPointData()->GetArray("CellTestVal");
+  vtkDataArray* genericPointVal =
+    genericOutput->GetPointData()->GetArray("PointTestVal");
+  if (!fastPointVal || !fastCellVal || !genericPointVal)
+    {
+    std::cerr << "Error: Missing output arrays" << std::endl;
+    return EXIT_FAILURE;
+    }
+  const double tol = 1E-8;
+  for (vtkIdType i = 0; i < numPts; ++i)
+    {
+    double fastCoord[3], genericCoord[3];
+    fastOutput->GetPoint(i, fastCoord);
+    genericOutput->GetPoint(i, genericCoord);
+    const double expected =
+      fastCoord[0] + 2.0 * fastCoord[1] + 3.0 * fastCoord[2];
+    if (fabs(fastCoord[0] - genericCoord[0]) > tol ||
+        fabs(fastCoord[1] - genericCoord[1]) > tol ||
+        fabs(fastCoord[2] - genericCoord[2]) > tol ||
+        fabs(fastPointVal->GetTuple1(i) - expected) > tol ||
+        fabs(genericPointVal->GetTuple1(i) - expected) > tol ||
+        fastCellVal->GetTuple1(i) != static_cast<double>(i / numMsvPoints))
+      {
+      std::cerr << "Error: Structured and generic paths differ at point "
+                << i << std::endl;
+      return EXIT_FAILURE;
+      }
+    }
+
+  return EXIT_SUCCESS;
+}
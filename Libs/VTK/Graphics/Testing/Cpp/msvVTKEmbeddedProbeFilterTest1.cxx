@@ -26,7 +26,10 @@
 #include "vtkDataSet.h"
 #include "vtkNew.h"
 #include "vtkPointData.h"
+#include "vtkPoints.h"
+#include "vtkPointSet.h"
 #include "vtkPolyDataReader.h"
+#include "vtkSmartPointer.h"
 #include "vtkTestUtilities.h"
 #include "vtkUnstructuredGridReader.h"
 
@@ -197,6 +200,207 @@ int msvVTKEmbeddedProbeFilterTest1(int argc, char* argv[])
     return EXIT_FAILURE;
     }
 
+  // check probing on several threads gives the same output as on one thread
+
+  vtkNew<msvVTKEmbeddedProbeFilter> serialProbe;
+  serialProbe->SetInputConnection(msvReader->GetOutputPort());
+  serialProbe->SetSourceConnection(blockReader->GetOutputPort());
+  serialProbe->SetCellIdArrayName("cellId");
+  serialProbe->SetParametricCoordinateArrayName("pcoord");
+  serialProbe->SetNumberOfThreads(1);
+  serialProbe->Update();
+  embeddedProbe->SetNumberOfThreads(3);
+  embeddedProbe->Update();
+  vtkDataSet *serialOutput = vtkDataSet::SafeDownCast(
+    serialProbe->GetOutputDataObject(0));
+  output = vtkDataSet::SafeDownCast(embeddedProbe->GetOutputDataObject(0));
+  if (!serialOutput || !output ||
+      serialOutput->GetNumberOfPoints() != output->GetNumberOfPoints())
+    {
+    std::cerr << "Error: Serial and threaded outputs differ" << std::endl;
+    return EXIT_FAILURE;
+    }
+  const char *arrayNames[2] = { "PointTestVal", "CellTestVal" };
+  for (vtkIdType ptId = 0; ptId < output->GetNumberOfPoints(); ++ptId)
+    {
+    double serialCoord[3];
+    serialOutput->GetPoint(ptId, serialCoord);
+    output->GetPoint(ptId, coord);
+    if (!checkValues(3, coord, serialCoord, valueTol, "Threaded point"))
+      {
+      return EXIT_FAILURE;
+      }
+    for (int i = 0; i < 2; ++i)
+      {
+      double serialVal =
+        serialOutput->GetPointData()->GetArray(arrayNames[i])->GetTuple1(ptId);
+      TestVal = output->GetPointData()->GetArray(arrayNames[i])->GetTuple1(ptId);
+      if (!checkValues(1, &TestVal, &serialVal, valueTol, arrayNames[i]))
+        {
+        return EXIT_FAILURE;
+        }
+      }
+    }
+
+  // check weights are reused while the embedding and source are unchanged,
+  // and recomputed when the source topology is read again
+
+  if (embeddedProbe->GetNumberOfWeightComputations() != 1)
+    {
+    std::cerr << "Error: Weights computed "
+              << embeddedProbe->GetNumberOfWeightComputations()
+              << " times; expected 1" << std::endl;
+    return EXIT_FAILURE;
+    }
+  blockReader->Modified();
+  embeddedProbe->Update();
+  if (embeddedProbe->GetNumberOfWeightComputations() != 2)
+    {
+    std::cerr << "Error: Weights computed "
+              << embeddedProbe->GetNumberOfWeightComputations()
+              << " times; expected 2" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // check probing in chunks of points gives the same output
+
+  embeddedProbe->SetStreamingChunkSize(5);
+  embeddedProbe->Update();
+  output = vtkDataSet::SafeDownCast(embeddedProbe->GetOutputDataObject(0));
+  for (vtkIdType ptId = 0; ptId < output->GetNumberOfPoints(); ++ptId)
+    {
+    double serialCoord[3];
+    serialOutput->GetPoint(ptId, serialCoord);
+    output->GetPoint(ptId, coord);
+    if (!checkValues(3, coord, serialCoord, valueTol, "Streamed point"))
+      {
+      return EXIT_FAILURE;
+      }
+    double serialVal =
+      serialOutput->GetPointData()->GetArray("PointTestVal")->GetTuple1(ptId);
+    TestVal = output->GetPointData()->GetArray("PointTestVal")->GetTuple1(ptId);
+    if (!checkValues(1, &TestVal, &serialVal, valueTol, "Streamed value"))
+      {
+      return EXIT_FAILURE;
+      }
+    }
+  if (embeddedProbe->GetMemoryFootprint() == 0)
+    {
+    std::cerr << "Error: Memory footprint not reported" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // check points located in the source by AutoEmbed are probed in place
+
+  vtkNew<msvVTKEmbeddedProbeFilter> autoProbe;
+  autoProbe->SetInputConnection(serialProbe->GetOutputPort());
+  autoProbe->SetSourceConnection(blockReader->GetOutputPort());
+  autoProbe->SetCellIdArrayName("autoCellId");
+  autoProbe->SetParametricCoordinateArrayName("autoPCoord");
+  autoProbe->AutoEmbedOn();
+  autoProbe->Update();
+  vtkDataSet *autoOutput =
+    vtkDataSet::SafeDownCast(autoProbe->GetOutputDataObject(0));
+  if (!autoOutput || !autoOutput->GetPointData()->GetArray("autoCellId") ||
+      !autoOutput->GetPointData()->GetArray("autoPCoord") ||
+      autoOutput->GetNumberOfPoints() != serialOutput->GetNumberOfPoints())
+    {
+    std::cerr << "Error: AutoEmbed output is missing the embedding"
+              << std::endl;
+    return EXIT_FAILURE;
+    }
+  for (vtkIdType ptId = 0; ptId < autoOutput->GetNumberOfPoints(); ++ptId)
+    {
+    double serialCoord[3];
+    serialOutput->GetPoint(ptId, serialCoord);
+    autoOutput->GetPoint(ptId, coord);
+    if (!checkValues(3, coord, serialCoord, valueTol, "AutoEmbed point"))
+      {
+      return EXIT_FAILURE;
+      }
+    double serialVal =
+      serialOutput->GetPointData()->GetArray("PointTestVal")->GetTuple1(ptId);
+    TestVal =
+      autoOutput->GetPointData()->GetArray("PointTestVal")->GetTuple1(ptId);
+    if (!checkValues(1, &TestVal, &serialVal, valueTol, "AutoEmbed value"))
+      {
+      return EXIT_FAILURE;
+      }
+    }
+  blockReader->Modified();
+  autoProbe->Update();
+  if (autoProbe->GetNumberOfEmbeddings() != 1)
+    {
+    std::cerr << "Error: Points located "
+              << autoProbe->GetNumberOfEmbeddings()
+              << " times; expected 1" << std::endl;
+    return EXIT_FAILURE;
+    }
+  // the output holds copies of the cached embedding
+  autoOutput = vtkDataSet::SafeDownCast(autoProbe->GetOutputDataObject(0));
+  vtkDataArray *autoCellIds =
+    autoOutput->GetPointData()->GetArray("autoCellId");
+  const double autoCellId = autoCellIds->GetTuple1(0);
+  autoCellIds->SetTuple1(0, -1);
+  autoProbe->Modified();
+  autoProbe->Update();
+  autoOutput = vtkDataSet::SafeDownCast(autoProbe->GetOutputDataObject(0));
+  if (autoOutput->GetPointData()->GetArray("autoCellId")->GetTuple1(0) !=
+      autoCellId || autoProbe->GetNumberOfEmbeddings() != 1)
+    {
+    std::cerr << "Error: Output changes altered the cached embedding"
+              << std::endl;
+    return EXIT_FAILURE;
+    }
+  // the embedding added by AutoEmbed is stale downstream once points move
+  vtkPointSet *autoPointSet = vtkPointSet::SafeDownCast(autoOutput);
+  vtkSmartPointer<vtkPointSet> moved;
+  moved.TakeReference(autoPointSet->NewInstance());
+  moved->ShallowCopy(autoPointSet);
+  vtkNew<vtkPoints> movedPoints;
+  movedPoints->DeepCopy(autoPointSet->GetPoints());
+  double point0[3], point1[3];
+  movedPoints->GetPoint(0, point0);
+  movedPoints->GetPoint(1, point1);
+  movedPoints->SetPoint(0, point1);
+  movedPoints->SetPoint(1, point0);
+  moved->SetPoints(movedPoints.GetPointer());
+  vtkNew<msvVTKEmbeddedProbeFilter> movedProbe;
+  movedProbe->SetInput(moved);
+  movedProbe->SetSourceConnection(blockReader->GetOutputPort());
+  movedProbe->SetCellIdArrayName("autoCellId");
+  movedProbe->SetParametricCoordinateArrayName("autoPCoord");
+  movedProbe->AutoEmbedOn();
+  movedProbe->Update();
+  if (movedProbe->GetNumberOfEmbeddings() != 1)
+    {
+    std::cerr << "Error: Stale embedding located "
+              << movedProbe->GetNumberOfEmbeddings()
+              << " times; expected 1" << std::endl;
+    return EXIT_FAILURE;
+    }
+  vtkDataSet *movedOutput =
+    vtkDataSet::SafeDownCast(movedProbe->GetOutputDataObject(0));
+  for (vtkIdType ptId = 0; ptId < 2; ++ptId)
+    {
+    double autoVal = autoOutput->GetPointData()->GetArray("PointTestVal")
+      ->GetTuple1(1 - ptId);
+    TestVal =
+      movedOutput->GetPointData()->GetArray("PointTestVal")->GetTuple1(ptId);
+    if (!checkValues(1, &TestVal, &autoVal, valueTol, "Moved point value"))
+      {
+      return EXIT_FAILURE;
+      }
+    }
+  // the embedding of the unmoved points is current and used as is
+  movedProbe->SetInput(autoPointSet);
+  movedProbe->Update();
+  if (movedProbe->GetNumberOfEmbeddings() != 1)
+    {
+    std::cerr << "Error: Current embedding located again" << std::endl;
+    return EXIT_FAILURE;
+    }
+
   embeddedProbe->Print(std::cout);
 
   return EXIT_SUCCESS;
@@ -19,34 +19,1035 @@
 ==============================================================================*/
 #include "msvVTKEmbeddedProbeFilter.h"
 
+#include "vtkCellArray.h"
 #include "vtkCellData.h"
 #include "vtkCell.h"
 #include "vtkDoubleArray.h"
+#include "vtkGenericCell.h"
+#include "vtkIdList.h"
 #include "vtkImageData.h"
 #include "vtkIdTypeArray.h"
 #include "vtkInformation.h"
+#include "vtkInformationIntegerVectorKey.h"
 #include "vtkInformationVector.h"
+#include "vtkMultiThreader.h"
+#include "vtkNew.h"
 #include "vtkObjectFactory.h"
 #include "vtkPointData.h"
+#include "vtkPoints.h"
 #include "vtkPointSet.h"
+#include "vtkPolyData.h"
+#include "vtkSmartPointer.h"
+#include "vtkRectilinearGrid.h"
 #include "vtkStreamingDemandDrivenPipeline.h"
+#include "vtkStructuredGrid.h"
+#include "vtkUniformGrid.h"
+#include "vtkUnstructuredGrid.h"
 
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <utility>
 #include <vector>
 
 vtkStandardNewMacro(msvVTKEmbeddedProbeFilter);
+vtkInformationKeyRestrictedMacro(msvVTKEmbeddedProbeFilter,
+                                 EMBEDDED_POINTS_HASH, IntegerVector, 2);
 
 class msvVTKEmbeddedProbeFilter::vtkVectorOfArrays : 
   public std::vector<vtkDataArray*>
 {
 };
 
+//----------------------------------------------------------------------------
+// What the interpolation weights depend on: the cell id and parametric
+// coordinate arrays of the input and the topology of the source. Arrays are
+// identified by address and modification time; structured sources by their
+// dimensions only, so that new time steps of the same grid still match.
+struct msvVTKEmbeddedProbeFilterWeightsKey
+{
+  msvVTKEmbeddedProbeFilterWeightsKey()
+  {
+    this->CellIds = this->PCoords = 0;
+    this->CellIdsMTime = this->PCoordsMTime = this->TopologyMTime = 0;
+    this->NumberOfPoints = this->NumberOfCells = 0;
+    this->SourceType = -1;
+    this->Dimensions[0] = this->Dimensions[1] = this->Dimensions[2] = 0;
+    this->Topology = 0;
+    this->EvaluateLocation = false;
+  }
+
+  bool operator==(const msvVTKEmbeddedProbeFilterWeightsKey& other)const
+  {
+    return this->CellIds == other.CellIds &&
+      this->CellIdsMTime == other.CellIdsMTime &&
+      this->PCoords == other.PCoords &&
+      this->PCoordsMTime == other.PCoordsMTime &&
+      this->NumberOfPoints == other.NumberOfPoints &&
+      this->NumberOfCells == other.NumberOfCells &&
+      this->SourceType == other.SourceType &&
+      this->Dimensions[0] == other.Dimensions[0] &&
+      this->Dimensions[1] == other.Dimensions[1] &&
+      this->Dimensions[2] == other.Dimensions[2] &&
+      this->Topology == other.Topology &&
+      this->TopologyMTime == other.TopologyMTime &&
+      this->EvaluateLocation == other.EvaluateLocation;
+  }
+
+  vtkDataArray* CellIds;
+  unsigned long CellIdsMTime;
+  vtkDataArray* PCoords;
+  unsigned long PCoordsMTime;
+  vtkIdType NumberOfPoints;
+  vtkIdType NumberOfCells;
+  int SourceType;
+  int Dimensions[3];
+  vtkObject* Topology;
+  unsigned long TopologyMTime;
+  bool EvaluateLocation;
+};
+
+//----------------------------------------------------------------------------
+// Sparse interpolation weights of the embedded points FirstPoint + i: the
+// value at point FirstPoint + i is the weighted sum of the values at the
+// source points PointIds[Offsets[i]..Offsets[i+1][ with the matching Weights.
+struct msvVTKEmbeddedProbeFilterWeights
+{
+  msvVTKEmbeddedProbeFilterWeights()
+  {
+    this->Valid = false;
+    this->FirstPoint = 0;
+  }
+
+  void Initialize(vtkIdType firstPoint, vtkIdType numPts)
+  {
+    this->FirstPoint = firstPoint;
+    this->CellIds.assign(numPts, -1);
+    this->Offsets.assign(numPts + 1, 0);
+    this->PointIds.clear();
+    this->Weights.clear();
+    this->Valid = false;
+  }
+
+  // Release the memory of the table.
+  void Clear()
+  {
+    std::vector<vtkIdType>().swap(this->CellIds);
+    std::vector<vtkIdType>().swap(this->Offsets);
+    std::vector<vtkIdType>().swap(this->PointIds);
+    std::vector<double>().swap(this->Weights);
+    this->FirstPoint = 0;
+    this->Valid = false;
+  }
+
+  // Allocated size of the table in bytes.
+  size_t GetMemorySize()const
+  {
+    return (this->CellIds.capacity() + this->Offsets.capacity() +
+            this->PointIds.capacity()) * sizeof(vtkIdType) +
+      this->Weights.capacity() * sizeof(double);
+  }
+
+  // Weights are valid for Key only if Valid is true.
+  bool Valid;
+  msvVTKEmbeddedProbeFilterWeightsKey Key;
+
+  vtkIdType FirstPoint;
+  std::vector<vtkIdType> CellIds;
+  std::vector<vtkIdType> Offsets;
+  std::vector<vtkIdType> PointIds;
+  std::vector<double> Weights;
+};
+
+namespace
+{
+
+//----------------------------------------------------------------------------
+// Weights computed by one thread over the point range [Begin, End[.
+struct msvVTKEmbeddedProbeFilterWeightsChunk
+{
+  vtkIdType Begin;
+  std::vector<vtkIdType> CellIds;
+  std::vector<vtkIdType> Sizes;
+  std::vector<vtkIdType> PointIds;
+  std::vector<double> Weights;
+  vtkIdType FailedPoint;
+  vtkIdType FailedCellId;
+};
+
+struct msvVTKEmbeddedProbeFilterWeightsJob
+{
+  vtkIdTypeArray *CellIdArray;
+  vtkDataArray *PCoordArray;
+  vtkIdType FirstPoint;
+  vtkIdType NumberOfPoints;
+  vtkDataSet *Source;
+  bool EvaluateLocation;
+  std::vector<msvVTKEmbeddedProbeFilterWeightsChunk> Chunks;
+};
+
+//----------------------------------------------------------------------------
+unsigned long msvGetCellArrayMTime(vtkCellArray* cells)
+{
+  if (!cells)
+    {
+    return 0;
+    }
+  return std::max(cells->GetMTime(), cells->GetData()->GetMTime());
+}
+
+//----------------------------------------------------------------------------
+msvVTKEmbeddedProbeFilterWeightsKey msvGetWeightsKey(vtkDataArray* cellIds,
+  vtkDataArray* pcoords, vtkIdType numPts, vtkDataSet* source,
+  bool evaluateLocation)
+{
+  msvVTKEmbeddedProbeFilterWeightsKey key;
+  key.CellIds = cellIds;
+  key.CellIdsMTime = cellIds ? cellIds->GetMTime() : 0;
+  key.PCoords = pcoords;
+  key.PCoordsMTime = pcoords->GetMTime();
+  key.NumberOfPoints = numPts;
+  key.NumberOfCells = source->GetNumberOfCells();
+  key.SourceType = source->GetDataObjectType();
+  key.EvaluateLocation = evaluateLocation;
+  if (vtkImageData* image = vtkImageData::SafeDownCast(source))
+    {
+    image->GetDimensions(key.Dimensions);
+    }
+  else if (vtkRectilinearGrid* grid = vtkRectilinearGrid::SafeDownCast(source))
+    {
+    grid->GetDimensions(key.Dimensions);
+    }
+  else if (vtkStructuredGrid* grid = vtkStructuredGrid::SafeDownCast(source))
+    {
+    grid->GetDimensions(key.Dimensions);
+    }
+  else if (vtkUnstructuredGrid* grid =
+           vtkUnstructuredGrid::SafeDownCast(source))
+    {
+    key.Topology = grid->GetCells();
+    key.TopologyMTime = msvGetCellArrayMTime(grid->GetCells());
+    if (grid->GetCellTypesArray())
+      {
+      key.TopologyMTime = std::max(key.TopologyMTime,
+        grid->GetCellTypesArray()->GetMTime());
+      }
+    }
+  else if (vtkPolyData* polyData = vtkPolyData::SafeDownCast(source))
+    {
+    key.Topology = polyData;
+    key.TopologyMTime = std::max(
+      std::max(msvGetCellArrayMTime(polyData->GetVerts()),
+               msvGetCellArrayMTime(polyData->GetLines())),
+      std::max(msvGetCellArrayMTime(polyData->GetPolys()),
+               msvGetCellArrayMTime(polyData->GetStrips())));
+    }
+  else
+    {
+    key.Topology = source;
+    key.TopologyMTime = source->GetMTime();
+    }
+  return key;
+}
+
+//----------------------------------------------------------------------------
+// Contiguous range of items processed by a thread.
+void msvThreadRange(vtkMultiThreader::ThreadInfo *threadInfo,
+                    vtkIdType numItems, vtkIdType &begin, vtkIdType &end)
+{
+  begin = numItems * threadInfo->ThreadID / threadInfo->NumberOfThreads;
+  end = numItems * (threadInfo->ThreadID + 1) / threadInfo->NumberOfThreads;
+}
+
+//----------------------------------------------------------------------------
+VTK_THREAD_RETURN_TYPE msvComputeWeightsThread(void *arg)
+{
+  vtkMultiThreader::ThreadInfo *threadInfo =
+    static_cast<vtkMultiThreader::ThreadInfo*>(arg);
+  msvVTKEmbeddedProbeFilterWeightsJob *job =
+    static_cast<msvVTKEmbeddedProbeFilterWeightsJob*>(threadInfo->UserData);
+  msvVTKEmbeddedProbeFilterWeightsChunk &chunk =
+    job->Chunks[threadInfo->ThreadID];
+  vtkIdType begin, end;
+  msvThreadRange(threadInfo, job->NumberOfPoints, begin, end);
+  begin += job->FirstPoint;
+  end += job->FirstPoint;
+  chunk.Begin = begin;
+  chunk.FailedPoint = -1;
+  chunk.FailedCellId = -1;
+
+  vtkDataSet *source = job->Source;
+  const vtkIdType numCells = source->GetNumberOfCells();
+  const vtkIdType *cellIds =
+    job->CellIdArray ? job->CellIdArray->GetPointer(0) : 0;
+  const vtkIdType numCellIds =
+    job->CellIdArray ? job->CellIdArray->GetNumberOfTuples() : 0;
+  std::vector<double> weights(std::max(source->GetMaxCellSize(), 1));
+  vtkGenericCell *cell = vtkGenericCell::New();
+  double pcoords[3] = { 0.0, 0.0, 0.0 };
+  double coords[3];
+  int subId = 0;
+  chunk.CellIds.reserve(end - begin);
+  chunk.Sizes.reserve(end - begin);
+  for (vtkIdType ptId = begin; ptId < end; ++ptId)
+    {
+    // The last cell id stands for all the points after the end of the array.
+    vtkIdType cellId = 0;
+    if (cellIds)
+      {
+      cellId = cellIds[std::min(ptId, numCellIds - 1)];
+      }
+    if (cellId < 0 || cellId >= numCells)
+      {
+      chunk.FailedPoint = ptId;
+      chunk.FailedCellId = cellId;
+      break;
+      }
+    source->GetCell(cellId, cell);
+    if (cell->GetCellType() == VTK_EMPTY_CELL)
+      {
+      chunk.FailedPoint = ptId;
+      chunk.FailedCellId = cellId;
+      break;
+      }
+    job->PCoordArray->GetTuple(ptId, pcoords);
+    if (job->EvaluateLocation)
+      {
+      cell->EvaluateLocation(subId, pcoords, coords, &weights[0]);
+      }
+    else
+      {
+      cell->InterpolateFunctions(pcoords, &weights[0]);
+      }
+    vtkIdType numCellPts = cell->GetNumberOfPoints();
+    chunk.CellIds.push_back(cellId);
+    chunk.Sizes.push_back(numCellPts);
+    for (vtkIdType i = 0; i < numCellPts; ++i)
+      {
+      chunk.PointIds.push_back(cell->GetPointId(i));
+      chunk.Weights.push_back(weights[i]);
+      }
+    }
+  cell->Delete();
+  return VTK_THREAD_RETURN_VALUE;
+}
+
+//----------------------------------------------------------------------------
+// Return true and the point dimensions of source if its cells are the
+// voxels, pixels, lines or vertices of a regular lattice of points without
+// blanking, whose interpolation weights can be computed arithmetically.
+bool msvGetStructuredDimensions(vtkDataSet *source, int dims[3])
+{
+  if (vtkUniformGrid *uniformGrid = vtkUniformGrid::SafeDownCast(source))
+    {
+    if (uniformGrid->GetPointBlanking() || uniformGrid->GetCellBlanking())
+      {
+      return false;
+      }
+    uniformGrid->GetDimensions(dims);
+    }
+  else if (vtkImageData *image = vtkImageData::SafeDownCast(source))
+    {
+    image->GetDimensions(dims);
+    }
+  else if (vtkRectilinearGrid *grid = vtkRectilinearGrid::SafeDownCast(source))
+    {
+    grid->GetDimensions(dims);
+    }
+  else if (vtkStructuredGrid *grid = vtkStructuredGrid::SafeDownCast(source))
+    {
+    if (grid->GetPointBlanking() || grid->GetCellBlanking())
+      {
+      return false;
+      }
+    grid->GetDimensions(dims);
+    }
+  else
+    {
+    return false;
+    }
+  return dims[0] > 0 && dims[1] > 0 && dims[2] > 0;
+}
+
+//----------------------------------------------------------------------------
+// Weights of points embedded in a structured source, written directly in
+// the weights table: every cell has the same number of points.
+struct msvVTKEmbeddedProbeFilterStructuredJob
+{
+  const vtkIdType *CellIds;
+  vtkIdType NumberOfCellIds;
+  vtkDataArray *PCoordArray;
+  vtkIdType FirstPoint;
+  vtkIdType NumberOfPoints;
+  int Dimensions[3];
+  msvVTKEmbeddedProbeFilterWeights *Weights;
+  // First failing point and its cell id, per thread, -1 if none.
+  std::vector<vtkIdType> FailedPoints;
+  std::vector<vtkIdType> FailedCellIds;
+};
+
+//----------------------------------------------------------------------------
+// The cell points are the corners of a cell of the lattice along its axes
+// of more than one point. Parametric coordinate a runs along the a-th of
+// these axes, so the weight of a corner is the product of r[a] or
+// 1 - r[a] depending on its side along each axis, as in vtkVoxel,
+// vtkPixel and vtkLine (vtkHexahedron and vtkQuad only differ by the
+// order of their points).
+template <class T>
+void msvComputeStructuredWeights(msvVTKEmbeddedProbeFilterStructuredJob *job,
+  int threadId, const T *pcoords, int numComp, vtkIdType begin, vtkIdType end)
+{
+  const int *dims = job->Dimensions;
+  const vtkIdType strides[3] =
+    { 1, dims[0], static_cast<vtkIdType>(dims[0]) * dims[1] };
+  const vtkIdType cellDims[3] =
+    { std::max(dims[0] - 1, 1), std::max(dims[1] - 1, 1),
+      std::max(dims[2] - 1, 1) };
+  const vtkIdType numCells = cellDims[0] * cellDims[1] * cellDims[2];
+  int axes[3];
+  int numAxes = 0;
+  for (int a = 0; a < 3; ++a)
+    {
+    if (dims[a] > 1)
+      {
+      axes[numAxes++] = a;
+      }
+    }
+  const int numCorners = 1 << numAxes;
+  vtkIdType cornerOffsets[8];
+  for (int c = 0; c < numCorners; ++c)
+    {
+    cornerOffsets[c] = 0;
+    for (int a = 0; a < numAxes; ++a)
+      {
+      cornerOffsets[c] += ((c >> a) & 1) * strides[axes[a]];
+      }
+    }
+  const int numPCoords = std::min(numComp, numAxes);
+
+  msvVTKEmbeddedProbeFilterWeights *weights = job->Weights;
+  vtkIdType *cellIds = weights->CellIds.empty() ? 0 : &weights->CellIds[0];
+  vtkIdType *offsets = &weights->Offsets[0];
+  vtkIdType *pointIds =
+    weights->PointIds.empty() ? 0 : &weights->PointIds[0];
+  double *w = weights->Weights.empty() ? 0 : &weights->Weights[0];
+  for (vtkIdType ptId = begin; ptId < end; ++ptId)
+    {
+    const vtkIdType inputPtId = job->FirstPoint + ptId;
+    // The last cell id stands for all the points after the end of the array.
+    vtkIdType cellId = 0;
+    if (job->CellIds)
+      {
+      cellId = job->CellIds[std::min(inputPtId, job->NumberOfCellIds - 1)];
+      }
+    if (cellId < 0 || cellId >= numCells)
+      {
+      job->FailedPoints[threadId] = inputPtId;
+      job->FailedCellIds[threadId] = cellId;
+      return;
+      }
+    const vtkIdType ijk[3] =
+      { cellId % cellDims[0], (cellId / cellDims[0]) % cellDims[1],
+        cellId / (cellDims[0] * cellDims[1]) };
+    const vtkIdType base =
+      ijk[0] + ijk[1] * strides[1] + ijk[2] * strides[2];
+    double r[3] = { 0.0, 0.0, 0.0 };
+    const T *pc = pcoords + inputPtId * numComp;
+    for (int a = 0; a < numPCoords; ++a)
+      {
+      r[a] = static_cast<double>(pc[a]);
+      }
+    const vtkIdType offset = ptId * numCorners;
+    cellIds[ptId] = cellId;
+    offsets[ptId] = offset;
+    for (int c = 0; c < numCorners; ++c)
+      {
+      double cornerWeight = 1.0;
+      for (int a = 0; a < numAxes; ++a)
+        {
+        cornerWeight *= ((c >> a) & 1) ? r[a] : 1.0 - r[a];
+        }
+      pointIds[offset + c] = base + cornerOffsets[c];
+      w[offset + c] = cornerWeight;
+      }
+    }
+}
+
+//----------------------------------------------------------------------------
+VTK_THREAD_RETURN_TYPE msvComputeStructuredWeightsThread(void *arg)
+{
+  vtkMultiThreader::ThreadInfo *threadInfo =
+    static_cast<vtkMultiThreader::ThreadInfo*>(arg);
+  msvVTKEmbeddedProbeFilterStructuredJob *job =
+    static_cast<msvVTKEmbeddedProbeFilterStructuredJob*>(
+      threadInfo->UserData);
+  vtkIdType begin, end;
+  msvThreadRange(threadInfo, job->NumberOfPoints, begin, end);
+  vtkDataArray *pcoordArray = job->PCoordArray;
+  switch (pcoordArray->GetDataType())
+    {
+    vtkTemplateMacro(msvComputeStructuredWeights(job, threadInfo->ThreadID,
+      static_cast<const VTK_TT*>(pcoordArray->GetVoidPointer(0)),
+      pcoordArray->GetNumberOfComponents(), begin, end));
+    }
+  return VTK_THREAD_RETURN_VALUE;
+}
+
+}
+
+//----------------------------------------------------------------------------
+// Arrays filled from the weights by the gather threads.
+struct msvVTKEmbeddedProbeFilterGatherJob
+{
+  typedef std::vector<std::pair<vtkAbstractArray*, vtkAbstractArray*> >
+    ArrayPairs;
+  const msvVTKEmbeddedProbeFilterWeights *Weights;
+  vtkDataSet *Source;
+  // Point coordinates, NULL if not probed. Without source points array,
+  // coordinates are taken from Source->GetPoint().
+  vtkDataArray *SourcePoints;
+  vtkDataArray *OutputPoints;
+  // (source, output) arrays, interpolated for point data and copied from
+  // the embedding cell for cell data.
+  ArrayPairs PointArrays;
+  ArrayPairs CellArrays;
+};
+
+namespace
+{
+
+//----------------------------------------------------------------------------
+// Round like vtkDataArrayTemplate::InterpolateTuple does for integer types.
+template <class T>
+inline T msvRoundIfNecessary(double value)
+{
+  if (std::numeric_limits<T>::is_integer)
+    {
+    return static_cast<T>((value >= 0.0) ? (value + 0.5) : (value - 0.5));
+    }
+  return static_cast<T>(value);
+}
+
+//----------------------------------------------------------------------------
+template <class T>
+void msvInterpolateTuples(const msvVTKEmbeddedProbeFilterWeights *weights,
+  const T *in, T *out, int numComp, vtkIdType begin, vtkIdType end)
+{
+  const vtkIdType *offsets = &weights->Offsets[0];
+  const vtkIdType *ids = weights->PointIds.empty() ? 0 : &weights->PointIds[0];
+  const double *w = weights->Weights.empty() ? 0 : &weights->Weights[0];
+  std::vector<double> sum(numComp);
+  for (vtkIdType ptId = begin; ptId < end; ++ptId)
+    {
+    std::fill(sum.begin(), sum.end(), 0.0);
+    for (vtkIdType k = offsets[ptId]; k < offsets[ptId + 1]; ++k)
+      {
+      const T *tuple = in + ids[k] * numComp;
+      for (int c = 0; c < numComp; ++c)
+        {
+        sum[c] += w[k] * static_cast<double>(tuple[c]);
+        }
+      }
+    T *outTuple = out + (weights->FirstPoint + ptId) * numComp;
+    for (int c = 0; c < numComp; ++c)
+      {
+      outTuple[c] = msvRoundIfNecessary<T>(sum[c]);
+      }
+    }
+}
+
+//----------------------------------------------------------------------------
+// Return true for the arrays the gather threads access directly.
+bool msvHasDirectAccess(vtkAbstractArray *array)
+{
+  vtkDataArray *dataArray = vtkDataArray::SafeDownCast(array);
+  return dataArray && dataArray->GetDataType() != VTK_BIT &&
+    dataArray->GetDataTypeSize() > 0;
+}
+
+//----------------------------------------------------------------------------
+void msvInterpolateArray(const msvVTKEmbeddedProbeFilterWeights *weights,
+  vtkDataArray *in, vtkDataArray *out, vtkIdType begin, vtkIdType end)
+{
+  int numComp = in->GetNumberOfComponents();
+  switch (in->GetDataType())
+    {
+    vtkTemplateMacro(msvInterpolateTuples(weights,
+      static_cast<const VTK_TT*>(in->GetVoidPointer(0)),
+      static_cast<VTK_TT*>(out->GetVoidPointer(0)), numComp, begin, end));
+    }
+}
+
+//----------------------------------------------------------------------------
+VTK_THREAD_RETURN_TYPE msvGatherThread(void *arg)
+{
+  vtkMultiThreader::ThreadInfo *threadInfo =
+    static_cast<vtkMultiThreader::ThreadInfo*>(arg);
+  msvVTKEmbeddedProbeFilterGatherJob *job =
+    static_cast<msvVTKEmbeddedProbeFilterGatherJob*>(threadInfo->UserData);
+  const msvVTKEmbeddedProbeFilterWeights *weights = job->Weights;
+  vtkIdType begin, end;
+  msvThreadRange(threadInfo,
+    static_cast<vtkIdType>(weights->CellIds.size()), begin, end);
+
+  if (job->OutputPoints)
+    {
+    if (job->SourcePoints &&
+        job->SourcePoints->GetDataType() == job->OutputPoints->GetDataType())
+      {
+      msvInterpolateArray(weights, job->SourcePoints, job->OutputPoints,
+                          begin, end);
+      }
+    else
+      {
+      double p[3];
+      for (vtkIdType ptId = begin; ptId < end; ++ptId)
+        {
+        double x[3] = { 0.0, 0.0, 0.0 };
+        for (vtkIdType k = weights->Offsets[ptId];
+             k < weights->Offsets[ptId + 1]; ++k)
+          {
+          job->Source->GetPoint(weights->PointIds[k], p);
+          x[0] += weights->Weights[k] * p[0];
+          x[1] += weights->Weights[k] * p[1];
+          x[2] += weights->Weights[k] * p[2];
+          }
+        job->OutputPoints->SetTuple(weights->FirstPoint + ptId, x);
+        }
+      }
+    }
+
+  for (size_t a = 0; a < job->PointArrays.size(); ++a)
+    {
+    vtkAbstractArray *in = job->PointArrays[a].first;
+    vtkAbstractArray *out = job->PointArrays[a].second;
+    if (msvHasDirectAccess(in))
+      {
+      msvInterpolateArray(weights, static_cast<vtkDataArray*>(in),
+                          static_cast<vtkDataArray*>(out), begin, end);
+      }
+    }
+
+  for (size_t a = 0; a < job->CellArrays.size(); ++a)
+    {
+    vtkAbstractArray *in = job->CellArrays[a].first;
+    vtkAbstractArray *out = job->CellArrays[a].second;
+    if (!msvHasDirectAccess(in))
+      {
+      continue;
+      }
+    const size_t tupleSize =
+      in->GetNumberOfComponents() * in->GetDataTypeSize();
+    const char *inData = static_cast<const char*>(in->GetVoidPointer(0));
+    char *outData = static_cast<char*>(out->GetVoidPointer(0));
+    for (vtkIdType ptId = begin; ptId < end; ++ptId)
+      {
+      memcpy(outData + (weights->FirstPoint + ptId) * tupleSize,
+             inData + weights->CellIds[ptId] * tupleSize, tupleSize);
+      }
+    }
+  return VTK_THREAD_RETURN_VALUE;
+}
+
+//----------------------------------------------------------------------------
+// Fill serially the arrays the gather threads can't access directly.
+void msvGatherGeneric(msvVTKEmbeddedProbeFilterGatherJob &job)
+{
+  const msvVTKEmbeddedProbeFilterWeights *weights = job.Weights;
+  const vtkIdType numPts = static_cast<vtkIdType>(weights->CellIds.size());
+  vtkNew<vtkIdList> ptIds;
+  std::vector<double> w;
+  for (size_t a = 0; a < job.PointArrays.size(); ++a)
+    {
+    vtkAbstractArray *in = job.PointArrays[a].first;
+    vtkAbstractArray *out = job.PointArrays[a].second;
+    if (msvHasDirectAccess(in))
+      {
+      continue;
+      }
+    for (vtkIdType ptId = 0; ptId < numPts; ++ptId)
+      {
+      vtkIdType first = weights->Offsets[ptId];
+      vtkIdType size = weights->Offsets[ptId + 1] - first;
+      ptIds->SetNumberOfIds(size);
+      w.resize(std::max(size, static_cast<vtkIdType>(1)));
+      for (vtkIdType k = 0; k < size; ++k)
+        {
+        ptIds->SetId(k, weights->PointIds[first + k]);
+        w[k] = weights->Weights[first + k];
+        }
+      out->InterpolateTuple(weights->FirstPoint + ptId, ptIds.GetPointer(),
+                            in, &w[0]);
+      }
+    }
+  for (size_t a = 0; a < job.CellArrays.size(); ++a)
+    {
+    vtkAbstractArray *in = job.CellArrays[a].first;
+    vtkAbstractArray *out = job.CellArrays[a].second;
+    if (msvHasDirectAccess(in))
+      {
+      continue;
+      }
+    for (vtkIdType ptId = 0; ptId < numPts; ++ptId)
+      {
+      out->SetTuple(weights->FirstPoint + ptId, weights->CellIds[ptId], in);
+      }
+    }
+}
+
+}
+
+//----------------------------------------------------------------------------
+// Cell ids and parametric coordinates of the input points located in the
+// source cells by AutoEmbed, with what they were computed for.
+struct msvVTKEmbeddedProbeFilterEmbedding
+{
+  msvVTKEmbeddedProbeFilterEmbedding()
+  {
+    this->Points = 0;
+    this->PointsMTime = 0;
+    this->PointsHash = 0;
+    this->NumberOfPoints = 0;
+    this->NumberOfCells = 0;
+    this->SourceType = -1;
+    this->Valid = false;
+    this->CheckedArray = 0;
+    this->CheckedArrayMTime = 0;
+    this->CheckedPoints = 0;
+    this->CheckedPointsMTime = 0;
+  }
+
+  vtkSmartPointer<vtkIdTypeArray> CellIds;
+  vtkSmartPointer<vtkDoubleArray> PCoords;
+  bool Valid;
+  // Not dereferenced, only compared along with its modification time to
+  // skip the hash of unchanged points.
+  vtkDataArray* Points;
+  unsigned long PointsMTime;
+  vtkTypeUInt64 PointsHash;
+  vtkIdType NumberOfPoints;
+  vtkIdType NumberOfCells;
+  int SourceType;
+  // Input parametric coordinate array last found current for the input
+  // points, not dereferenced either.
+  vtkAbstractArray* CheckedArray;
+  unsigned long CheckedArrayMTime;
+  vtkDataArray* CheckedPoints;
+  unsigned long CheckedPointsMTime;
+};
+
+namespace
+{
+
+//----------------------------------------------------------------------------
+// 64 bits FNV-1a hash of the coordinates of the input points, so that an
+// embedding is reused for the same points held by new arrays, e.g. when an
+// upstream filter executes again.
+vtkTypeUInt64 msvHashPoints(vtkDataSet *input, vtkDataArray *points)
+{
+  vtkTypeUInt64 hash = 14695981039346656037ULL;
+  if (points)
+    {
+    const unsigned char *bytes =
+      static_cast<const unsigned char*>(points->GetVoidPointer(0));
+    const size_t size = static_cast<size_t>(points->GetNumberOfTuples()) *
+      points->GetNumberOfComponents() * points->GetDataTypeSize();
+    for (size_t i = 0; i < size; ++i)
+      {
+      hash ^= bytes[i];
+      hash *= 1099511628211ULL;
+      }
+    return hash;
+    }
+  const vtkIdType numPts = input->GetNumberOfPoints();
+  for (vtkIdType ptId = 0; ptId < numPts; ++ptId)
+    {
+    double x[3];
+    input->GetPoint(ptId, x);
+    const unsigned char *bytes = reinterpret_cast<const unsigned char*>(x);
+    for (size_t i = 0; i < sizeof(x); ++i)
+      {
+      hash ^= bytes[i];
+      hash *= 1099511628211ULL;
+      }
+    }
+  return hash;
+}
+
+//----------------------------------------------------------------------------
+void msvSetEmbeddedPointsHash(vtkAbstractArray *array, vtkTypeUInt64 hash)
+{
+  int halves[2];
+  halves[0] = static_cast<int>(static_cast<vtkTypeUInt32>(hash >> 32));
+  halves[1] = static_cast<int>(static_cast<vtkTypeUInt32>(hash));
+  array->GetInformation()->Set(
+    msvVTKEmbeddedProbeFilter::EMBEDDED_POINTS_HASH(), halves, 2);
+}
+
+//----------------------------------------------------------------------------
+// Return false if array was added by AutoEmbed for other point coordinates
+// than the ones of input. Arrays not added by AutoEmbed are trusted.
+bool msvIsEmbeddingCurrent(vtkDataSet *input, vtkAbstractArray *array,
+                           msvVTKEmbeddedProbeFilterEmbedding *embedding)
+{
+  vtkInformation *info = array->GetInformation();
+  if (!info->Has(msvVTKEmbeddedProbeFilter::EMBEDDED_POINTS_HASH()))
+    {
+    return true;
+    }
+  vtkPointSet *inputPointSet = vtkPointSet::SafeDownCast(input);
+  vtkDataArray *points = (inputPointSet && inputPointSet->GetPoints()) ?
+    inputPointSet->GetPoints()->GetData() : 0;
+  const unsigned long pointsMTime =
+    points ? points->GetMTime() : input->GetMTime();
+  if (embedding->CheckedArray == array &&
+      embedding->CheckedArrayMTime == array->GetMTime() &&
+      embedding->CheckedPoints == points &&
+      embedding->CheckedPointsMTime == pointsMTime)
+    {
+    return true;
+    }
+  const int *halves =
+    info->Get(msvVTKEmbeddedProbeFilter::EMBEDDED_POINTS_HASH());
+  const vtkTypeUInt64 hash =
+    (static_cast<vtkTypeUInt64>(static_cast<vtkTypeUInt32>(halves[0])) << 32) |
+    static_cast<vtkTypeUInt32>(halves[1]);
+  if (hash != msvHashPoints(input, points))
+    {
+    return false;
+    }
+  embedding->CheckedArray = array;
+  embedding->CheckedArrayMTime = array->GetMTime();
+  embedding->CheckedPoints = points;
+  embedding->CheckedPointsMTime = pointsMTime;
+  return true;
+}
+
+//----------------------------------------------------------------------------
+// Uniform bins over the source bounds, each listing the cells whose bounds
+// overlap it, stored as CellIds[Offsets[bin]..Offsets[bin+1][.
+struct msvCellBins
+{
+  double Origin[3];
+  double BinSize[3];
+  int Divisions[3];
+  std::vector<vtkIdType> Offsets;
+  std::vector<vtkIdType> CellIds;
+
+  // Bin index along axis of coordinate x, clamped to the bins.
+  int GetBin(int axis, double x)const
+  {
+    int bin = this->BinSize[axis] > 0. ?
+      static_cast<int>((x - this->Origin[axis]) / this->BinSize[axis]) : 0;
+    return std::min(std::max(bin, 0), this->Divisions[axis] - 1);
+  }
+};
+
+//----------------------------------------------------------------------------
+// Bin ranges of the cells [Begin, End[ of the source, computed on threads.
+struct msvCellBinsJob
+{
+  vtkDataSet *Source;
+  msvCellBins *Bins;
+  // 6 bin indices (min/max along x, y, z) per cell.
+  std::vector<int> CellRanges;
+};
+
+//----------------------------------------------------------------------------
+VTK_THREAD_RETURN_TYPE msvCellBinsThread(void *arg)
+{
+  vtkMultiThreader::ThreadInfo *threadInfo =
+    static_cast<vtkMultiThreader::ThreadInfo*>(arg);
+  msvCellBinsJob *job = static_cast<msvCellBinsJob*>(threadInfo->UserData);
+  vtkIdType begin, end;
+  msvThreadRange(threadInfo, job->Source->GetNumberOfCells(), begin, end);
+  double bounds[6];
+  for (vtkIdType cellId = begin; cellId < end; ++cellId)
+    {
+    job->Source->GetCellBounds(cellId, bounds);
+    int *range = &job->CellRanges[6 * cellId];
+    for (int axis = 0; axis < 3; ++axis)
+      {
+      range[2 * axis] = job->Bins->GetBin(axis, bounds[2 * axis]);
+      range[2 * axis + 1] = job->Bins->GetBin(axis, bounds[2 * axis + 1]);
+      }
+    }
+  return VTK_THREAD_RETURN_VALUE;
+}
+
+//----------------------------------------------------------------------------
+// Bin the cells of source, about one cell per bin. The cell bounds are
+// computed on numThreads threads.
+void msvBuildCellBins(vtkDataSet *source, int numThreads, msvCellBins &bins)
+{
+  const vtkIdType numCells = source->GetNumberOfCells();
+  double bounds[6];
+  source->GetBounds(bounds);
+  double lengths[3];
+  int numAxes = 0;
+  for (int axis = 0; axis < 3; ++axis)
+    {
+    lengths[axis] = bounds[2 * axis + 1] - bounds[2 * axis];
+    numAxes += lengths[axis] > 0. ? 1 : 0;
+    }
+  double volume = 1.0;
+  for (int axis = 0; axis < 3; ++axis)
+    {
+    volume *= lengths[axis] > 0. ? lengths[axis] : 1.0;
+    }
+  // Cubic bins of the size giving about numCells bins.
+  const double binLength = numAxes ?
+    pow(volume / std::max(numCells, static_cast<vtkIdType>(1)),
+        1.0 / numAxes) : 1.0;
+  vtkIdType numBins = 1;
+  for (int axis = 0; axis < 3; ++axis)
+    {
+    bins.Origin[axis] = bounds[2 * axis];
+    bins.Divisions[axis] = lengths[axis] > 0. ? std::min(std::max(
+      static_cast<int>(lengths[axis] / binLength), 1), 1024) : 1;
+    bins.BinSize[axis] = lengths[axis] / bins.Divisions[axis];
+    numBins *= bins.Divisions[axis];
+    }
+
+  if (numCells > 0)
+    {
+    // Make sure the source builds its cell structures before it is accessed
+    // from several threads.
+    vtkNew<vtkGenericCell> cell;
+    source->GetCell(0, cell.GetPointer());
+    }
+  msvCellBinsJob job;
+  job.Source = source;
+  job.Bins = &bins;
+  job.CellRanges.resize(6 * numCells);
+  vtkNew<vtkMultiThreader> threader;
+  threader->SetNumberOfThreads(static_cast<int>(std::min(
+    static_cast<vtkIdType>(numThreads),
+    std::max(numCells, static_cast<vtkIdType>(1)))));
+  threader->SetSingleMethod(msvCellBinsThread, &job);
+  threader->SingleMethodExecute();
+
+  // Count, then fill the cells of each bin.
+  const vtkIdType sliceSize =
+    static_cast<vtkIdType>(bins.Divisions[0]) * bins.Divisions[1];
+  bins.Offsets.assign(numBins + 1, 0);
+  for (vtkIdType cellId = 0; cellId < numCells; ++cellId)
+    {
+    const int *range = &job.CellRanges[6 * cellId];
+    for (int k = range[4]; k <= range[5]; ++k)
+      {
+      for (int j = range[2]; j <= range[3]; ++j)
+        {
+        for (int i = range[0]; i <= range[1]; ++i)
+          {
+          ++bins.Offsets[i + j * bins.Divisions[0] + k * sliceSize + 1];
+          }
+        }
+      }
+    }
+  for (vtkIdType bin = 0; bin < numBins; ++bin)
+    {
+    bins.Offsets[bin + 1] += bins.Offsets[bin];
+    }
+  bins.CellIds.resize(bins.Offsets[numBins]);
+  std::vector<vtkIdType> fill(bins.Offsets.begin(), bins.Offsets.end() - 1);
+  for (vtkIdType cellId = 0; cellId < numCells; ++cellId)
+    {
+    const int *range = &job.CellRanges[6 * cellId];
+    for (int k = range[4]; k <= range[5]; ++k)
+      {
+      for (int j = range[2]; j <= range[3]; ++j)
+        {
+        for (int i = range[0]; i <= range[1]; ++i)
+          {
+          bins.CellIds[fill[i + j * bins.Divisions[0] + k * sliceSize]++] =
+            cellId;
+          }
+        }
+      }
+    }
+}
+
+//----------------------------------------------------------------------------
+// Input points located in the source cells on threads.
+struct msvLocatePointsJob
+{
+  vtkDataSet *Input;
+  vtkDataSet *Source;
+  const msvCellBins *Bins;
+  vtkIdType *CellIds;
+  double *PCoords;
+  // First point not found, per thread, -1 if none.
+  std::vector<vtkIdType> FailedPoints;
+};
+
+//----------------------------------------------------------------------------
+VTK_THREAD_RETURN_TYPE msvLocatePointsThread(void *arg)
+{
+  vtkMultiThreader::ThreadInfo *threadInfo =
+    static_cast<vtkMultiThreader::ThreadInfo*>(arg);
+  msvLocatePointsJob *job =
+    static_cast<msvLocatePointsJob*>(threadInfo->UserData);
+  const msvCellBins *bins = job->Bins;
+  vtkIdType begin, end;
+  msvThreadRange(threadInfo, job->Input->GetNumberOfPoints(), begin, end);
+  std::vector<double> weights(std::max(job->Source->GetMaxCellSize(), 1));
+  vtkGenericCell *cell = vtkGenericCell::New();
+  const vtkIdType sliceSize =
+    static_cast<vtkIdType>(bins->Divisions[0]) * bins->Divisions[1];
+  double x[3], closestPoint[3], pcoords[3], dist2;
+  int subId;
+  for (vtkIdType ptId = begin; ptId < end; ++ptId)
+    {
+    job->Input->GetPoint(ptId, x);
+    const vtkIdType bin = bins->GetBin(0, x[0]) +
+      bins->GetBin(1, x[1]) * bins->Divisions[0] +
+      bins->GetBin(2, x[2]) * sliceSize;
+    vtkIdType found = -1;
+    for (vtkIdType c = bins->Offsets[bin]; c < bins->Offsets[bin + 1]; ++c)
+      {
+      const vtkIdType cellId = bins->CellIds[c];
+      job->Source->GetCell(cellId, cell);
+      if (cell->EvaluatePosition(x, closestPoint, subId, pcoords, dist2,
+                                 &weights[0]) == 1)
+        {
+        found = cellId;
+        break;
+        }
+      }
+    if (found < 0)
+      {
+      job->FailedPoints[threadInfo->ThreadID] = ptId;
+      break;
+      }
+    job->CellIds[ptId] = found;
+    std::copy(pcoords, pcoords + 3, job->PCoords + 3 * ptId);
+    }
+  cell->Delete();
+  return VTK_THREAD_RETURN_VALUE;
+}
+
+}
+
 //----------------------------------------------------------------------------
 msvVTKEmbeddedProbeFilter::msvVTKEmbeddedProbeFilter()
 {
   this->SetNumberOfInputPorts(2);
   this->CellIdArrayName = 0;
   this->ParametricCoordinateArrayName = 0;
+  this->PassPiecesToSource = 0;
   this->CellArrays = new vtkVectorOfArrays();
+  this->Weights = new msvVTKEmbeddedProbeFilterWeights;
+  this->NumberOfThreads = vtkMultiThreader::GetGlobalDefaultNumberOfThreads();
+  this->CacheWeights = 1;
+  this->NumberOfWeightComputations = 0;
+  this->StreamingChunkSize = 0;
+  this->MemoryFootprint = 0;
+  this->StructuredFastPath = 1;
+  this->AutoEmbed = 0;
+  this->NumberOfEmbeddings = 0;
+  this->Embedding = new msvVTKEmbeddedProbeFilterEmbedding;
   this->PointList = 0;
   this->CellList = 0;
 }
@@ -55,6 +1056,8 @@ msvVTKEmbeddedProbeFilter::msvVTKEmbeddedProbeFilter()
 msvVTKEmbeddedProbeFilter::~msvVTKEmbeddedProbeFilter()
 {
   delete this->CellArrays;
+  delete this->Weights;
+  delete this->Embedding;
   delete this->PointList;
   delete this->CellList;
 }
@@ -125,12 +1128,13 @@ void msvVTKEmbeddedProbeFilter::InitializeForProbing(vtkDataSet* input,
   output->GetFieldData()->PassData(input->GetFieldData());
 
   // vtkPointSet-derived outputs have points coordinates probed,
-  // so allocate and replace the referenced ones set by CopyStructure()
+  // so allocate and replace the referenced ones set by CopyStructure().
+  // All the coordinates are overwritten, there is no need to copy them.
   vtkPointSet *pointSet = vtkPointSet::SafeDownCast(output);
-  if (pointSet)
+  if (pointSet && pointSet->GetPoints())
     {
-    vtkPoints *points = vtkPoints::New();
-    points->DeepCopy(pointSet->GetPoints());
+    vtkPoints *points = vtkPoints::New(pointSet->GetPoints()->GetDataType());
+    points->SetNumberOfPoints(numPts);
     pointSet->SetPoints(points);
     points->Delete();
     }
@@ -174,25 +1178,21 @@ int msvVTKEmbeddedProbeFilter::Probe(vtkDataSet *input, vtkDataSet *source,
 }
 
 //----------------------------------------------------------------------------
-int msvVTKEmbeddedProbeFilter::PerformProbe(vtkDataSet *input, 
-  int srcIdx, vtkDataSet *source, vtkDataSet *output)
+int msvVTKEmbeddedProbeFilter::GetEmbeddingArrays(vtkPointData *inputPD,
+  vtkIdType numPts, vtkIdTypeArray *&cellIdArray, vtkDataArray *&pcoordArray,
+  bool reportErrors)
 {
-  vtkDebugMacro(<<"Probing data");
-
-  int numPts = input->GetNumberOfPoints();
-  vtkPointData *inputPD = input->GetPointData();
-  vtkPointData *sourcePD = source->GetPointData();
-  vtkCellData *sourceCD = source->GetCellData();
-  vtkPointData *outputPD = output->GetPointData();
-
-  vtkIdTypeArray *cellIdArray = 0;
-  int cellIdArrayNumberOfTuples = 0;
+  cellIdArray = 0;
+  pcoordArray = 0;
   if (this->CellIdArrayName)
     {
     vtkDataArray *cellIdDataArray = inputPD->GetArray(this->CellIdArrayName);
     if (!cellIdDataArray)
       {
-      vtkErrorMacro(<<"Cell Id array not found or non-numeric.");
+      if (reportErrors)
+        {
+        vtkErrorMacro(<<"Cell Id array not found or non-numeric.");
+        }
       return 0;
       }
     const int cellIdArrayNumberOfComponents =
@@ -200,107 +1200,443 @@ int msvVTKEmbeddedProbeFilter::PerformProbe(vtkDataSet *input,
     cellIdArray = vtkIdTypeArray::SafeDownCast(cellIdDataArray);
     if ((cellIdArrayNumberOfComponents != 1) || (!cellIdArray))
       {
-      vtkErrorMacro(<<"Cell Id array is not scalar vtkIdType.");
+      if (reportErrors)
+        {
+        vtkErrorMacro(<<"Cell Id array is not scalar vtkIdType.");
+        }
       return 0;
       }
-    cellIdArrayNumberOfTuples = cellIdArray->GetNumberOfTuples();
-    if (cellIdArrayNumberOfTuples < 1)
+    if (cellIdArray->GetNumberOfTuples() < 1)
       {
-      vtkErrorMacro(<<"Cell Id array must have at least 1 value.");
+      if (reportErrors)
+        {
+        vtkErrorMacro(<<"Cell Id array must have at least 1 value.");
+        }
       return 0;
       }
     }
 
   if (!this->ParametricCoordinateArrayName)
     {
-    vtkErrorMacro(<<"Parametric coordinate array not set.");
+    if (reportErrors)
+      {
+      vtkErrorMacro(<<"Parametric coordinate array not set.");
+      }
     return 0;
     }
-  vtkDataArray *pcoordArray =
-    inputPD->GetArray(this->ParametricCoordinateArrayName);
+  pcoordArray = inputPD->GetArray(this->ParametricCoordinateArrayName);
   if (!pcoordArray)
     {
-    vtkErrorMacro(<<"Parametric coordinate array not found or non-numeric.");
+    if (reportErrors)
+      {
+      vtkErrorMacro(<<"Parametric coordinate array not found or non-numeric.");
+      }
     return 0;
     }
   const int pcoordArrayNumberOfComponents =
     pcoordArray->GetNumberOfComponents();
   if (pcoordArrayNumberOfComponents > 3)
     {
-    vtkErrorMacro(<<"Parametric coordinate array has more than 3 components.");
+    if (reportErrors)
+      {
+      vtkErrorMacro(<<"Parametric coordinate array has more than 3"
+        " components.");
+      }
     return 0;
     }
-  const int pcoordArrayNumberOfTuples = pcoordArray->GetNumberOfTuples();
-  if (pcoordArrayNumberOfTuples < numPts)
+  if (pcoordArray->GetNumberOfTuples() < numPts)
     {
-    vtkErrorMacro(<<"Parametric coordinate array has fewer tuples than number"
-      " of points in dataset.");
+    if (reportErrors)
+      {
+      vtkErrorMacro(<<"Parametric coordinate array has fewer tuples than"
+        " number of points in dataset.");
+      }
     return 0;
     }
 
-  double *weights = new double[source->GetMaxCellSize()];
-  double pcoords[3] = { 0.0, 0.0, 0.0 };
-  vtkIdType cellId = 0;
-  vtkCell *cell = 0;
+  return 1;
+}
+
+//----------------------------------------------------------------------------
+int msvVTKEmbeddedProbeFilter::PerformProbe(vtkDataSet *input,
+  int vtkNotUsed(srcIdx), vtkDataSet *source, vtkDataSet *output)
+{
+  vtkDebugMacro(<<"Probing data");
+
+  vtkIdType numPts = input->GetNumberOfPoints();
+  vtkPointData *inputPD = input->GetPointData();
+  vtkPointData *sourcePD = source->GetPointData();
+  vtkCellData *sourceCD = source->GetCellData();
+  vtkPointData *outputPD = output->GetPointData();
+
+  vtkIdTypeArray *cellIdArray = 0;
+  vtkDataArray *pcoordArray = 0;
+  int embedded = this->GetEmbeddingArrays(inputPD, numPts, cellIdArray,
+                                          pcoordArray, !this->AutoEmbed);
+  // Arrays added by AutoEmbed upstream are stale once the points move.
+  if (embedded && this->AutoEmbed &&
+      !msvIsEmbeddingCurrent(input, pcoordArray, this->Embedding))
+    {
+    embedded = 0;
+    }
+  vtkSmartPointer<vtkIdTypeArray> autoCellIds;
+  vtkSmartPointer<vtkDoubleArray> autoPCoords;
+  if (!embedded)
+    {
+    // Locate the input points in the source cells once, and reuse the
+    // embedding until the input points or the source cells change.
+    if (!this->AutoEmbed || !this->UpdateEmbedding(input, source))
+      {
+      return 0;
+      }
+    // The weights are computed from the cached embedding, which keeps the
+    // cached weights valid, and the output gets copies of it, so that
+    // downstream changes can't alter the cache.
+    cellIdArray = this->Embedding->CellIds;
+    pcoordArray = this->Embedding->PCoords;
+    autoCellIds = vtkSmartPointer<vtkIdTypeArray>::New();
+    autoCellIds->DeepCopy(cellIdArray);
+    autoCellIds->SetName(cellIdArray->GetName());
+    autoPCoords = vtkSmartPointer<vtkDoubleArray>::New();
+    autoPCoords->DeepCopy(pcoordArray);
+    autoPCoords->SetName(pcoordArray->GetName());
+    outputPD->AddArray(autoCellIds);
+    outputPD->AddArray(autoPCoords);
+    }
+
   // vtkPointSet-derived outputs have point coordinates probed
   vtkPointSet *pointSet = vtkPointSet::SafeDownCast(output);
-  int subId = 0;
-  double coords[3];
-  vtkPoints *points = 0;
-  if (pointSet)
+
+  // Resolve the arrays once: source point data arrays are interpolated into
+  // the output arrays of the same name, source cell data arrays are copied.
+  msvVTKEmbeddedProbeFilterGatherJob job;
+  job.Weights = this->Weights;
+  job.Source = source;
+  job.SourcePoints = 0;
+  job.OutputPoints = 0;
+  if (pointSet && pointSet->GetPoints())
+    {
+    job.OutputPoints = pointSet->GetPoints()->GetData();
+    vtkPointSet *sourcePointSet = vtkPointSet::SafeDownCast(source);
+    if (sourcePointSet && sourcePointSet->GetPoints())
+      {
+      job.SourcePoints = sourcePointSet->GetPoints()->GetData();
+      }
+    }
+  int numSourcePointArrays = sourcePD->GetNumberOfArrays();
+  for (int i = 0; i < numSourcePointArrays; ++i)
     {
-    points = pointSet->GetPoints();
+    vtkAbstractArray *inArray = sourcePD->GetAbstractArray(i);
+    vtkAbstractArray *outArray = (inArray && inArray->GetName()) ?
+      outputPD->GetAbstractArray(inArray->GetName()) : 0;
+    if (outArray && outArray->GetDataType() == inArray->GetDataType() &&
+        outArray->GetNumberOfComponents() == inArray->GetNumberOfComponents())
+      {
+      outArray->SetNumberOfTuples(numPts);
+      job.PointArrays.push_back(std::make_pair(inArray, outArray));
+      }
     }
-  int result = 1;
-  for (vtkIdType ptId = 0; ptId < numPts; ++ptId)
+  vtkVectorOfArrays::iterator iter;
+  for (iter = this->CellArrays->begin(); iter != this->CellArrays->end();
+    ++iter)
     {
-    if (ptId < cellIdArrayNumberOfTuples)
+    vtkDataArray* inArray = sourceCD->GetArray((*iter)->GetName());
+    if (inArray && inArray->GetDataType() == (*iter)->GetDataType() &&
+        inArray->GetNumberOfComponents() == (*iter)->GetNumberOfComponents())
       {
-      cellId = cellIdArray->GetValue(ptId);
+      (*iter)->SetNumberOfTuples(numPts);
+      job.CellArrays.push_back(std::make_pair(inArray, *iter));
       }
-    if (cellId >= 0)
+    }
+
+  size_t peakWeightsSize = 0;
+  if (this->StreamingChunkSize > 0 && numPts > this->StreamingChunkSize)
+    {
+    // Streaming: the weights of each chunk of points are computed, gathered
+    // and dropped before the next chunk, so the weights table never grows
+    // beyond StreamingChunkSize points.
+    ++this->NumberOfWeightComputations;
+    for (vtkIdType firstPoint = 0; firstPoint < numPts;
+         firstPoint += this->StreamingChunkSize)
       {
-      cell = source->GetCell(cellId);
+      vtkIdType chunkSize =
+        std::min(this->StreamingChunkSize, numPts - firstPoint);
+      if (!this->ComputeWeights(cellIdArray, pcoordArray, firstPoint,
+                                chunkSize, source, pointSet != 0))
+        {
+        this->Weights->Clear();
+        return 0;
+        }
+      peakWeightsSize =
+        std::max(peakWeightsSize, this->Weights->GetMemorySize());
+      this->GatherWeights(&job, chunkSize);
       }
-    else
+    this->Weights->Clear();
+    }
+  else
+    {
+    // The weights only depend on the embedding, so they are reused from the
+    // previous time step as long as the embedding and source topology match.
+    msvVTKEmbeddedProbeFilterWeightsKey key = msvGetWeightsKey(
+      cellIdArray, pcoordArray, numPts, source, pointSet != 0);
+    if (!this->CacheWeights || !this->Weights->Valid ||
+        !(this->Weights->Key == key))
       {
-      cell = 0;
+      if (!this->ComputeWeights(cellIdArray, pcoordArray, 0, numPts, source,
+                                pointSet != 0))
+        {
+        return 0;
+        }
+      this->Weights->Key = key;
+      this->Weights->Valid = true;
+      ++this->NumberOfWeightComputations;
       }
-    if (!cell)
+    peakWeightsSize = this->Weights->GetMemorySize();
+    this->GatherWeights(&job, numPts);
+    if (!this->CacheWeights)
       {
-      vtkErrorMacro(<<"No cell found with ID "<<cellId);
-      result = 0;
-      break;
+      this->Weights->Clear();
       }
-    pcoordArray->GetTuple(ptId, pcoords);
+    }
+
+  if (job.OutputPoints)
+    {
+    job.OutputPoints->Modified();
+    }
+  for (size_t a = 0; a < job.PointArrays.size(); ++a)
+    {
+    job.PointArrays[a].second->Modified();
+    }
+  for (size_t a = 0; a < job.CellArrays.size(); ++a)
+    {
+    job.CellArrays[a].second->Modified();
+    }
+  // Tag the added arrays with the output points they embed, i.e. the probed
+  // coordinates, for a downstream AutoEmbed to detect that they are stale.
+  if (autoPCoords)
+    {
+    const vtkTypeUInt64 hash = msvHashPoints(output, job.OutputPoints);
+    msvSetEmbeddedPointsHash(autoCellIds, hash);
+    msvSetEmbeddedPointsHash(autoPCoords, hash);
+    }
+  this->MemoryFootprint = input->GetActualMemorySize() +
+    source->GetActualMemorySize() + output->GetActualMemorySize() +
+    static_cast<unsigned long>((peakWeightsSize + 1023) / 1024);
+  return 1;
+}
 
-    if (points)
+//----------------------------------------------------------------------------
+void msvVTKEmbeddedProbeFilter::GatherWeights(
+  msvVTKEmbeddedProbeFilterGatherJob *job, vtkIdType numPts)
+{
+  // Interpolate on NumberOfThreads threads over contiguous point ranges.
+  // Arrays without direct typed access are filled serially afterwards.
+  vtkNew<vtkMultiThreader> threader;
+  threader->SetNumberOfThreads(static_cast<int>(std::min(
+    static_cast<vtkIdType>(this->NumberOfThreads),
+    std::max(numPts, static_cast<vtkIdType>(1)))));
+  threader->SetSingleMethod(msvGatherThread, job);
+  threader->SingleMethodExecute();
+  msvGatherGeneric(*job);
+}
+
+//----------------------------------------------------------------------------
+int msvVTKEmbeddedProbeFilter::ComputeWeights(vtkIdTypeArray *cellIdArray,
+  vtkDataArray *pcoordArray, vtkIdType firstPoint, vtkIdType numPts,
+  vtkDataSet *source, bool evaluateLocation)
+{
+  int dims[3];
+  if (this->StructuredFastPath && pcoordArray->GetDataType() != VTK_BIT &&
+      msvGetStructuredDimensions(source, dims))
+    {
+    return this->ComputeStructuredWeights(cellIdArray, pcoordArray,
+                                          firstPoint, numPts, dims);
+    }
+
+  if (numPts > 0 && source->GetNumberOfCells() > 0)
+    {
+    // Make sure the source builds its cell structures before it is accessed
+    // from several threads.
+    vtkNew<vtkGenericCell> cell;
+    source->GetCell(0, cell.GetPointer());
+    }
+
+  msvVTKEmbeddedProbeFilterWeightsJob job;
+  job.CellIdArray = cellIdArray;
+  job.PCoordArray = pcoordArray;
+  job.FirstPoint = firstPoint;
+  job.NumberOfPoints = numPts;
+  job.Source = source;
+  job.EvaluateLocation = evaluateLocation;
+
+  vtkNew<vtkMultiThreader> threader;
+  int numThreads = static_cast<int>(std::min(
+    static_cast<vtkIdType>(this->NumberOfThreads),
+    std::max(numPts, static_cast<vtkIdType>(1))));
+  threader->SetNumberOfThreads(numThreads);
+  job.Chunks.resize(threader->GetNumberOfThreads());
+  threader->SetSingleMethod(msvComputeWeightsThread, &job);
+  threader->SingleMethodExecute();
+
+  // Concatenate the chunks in point order, reporting the first failure.
+  msvVTKEmbeddedProbeFilterWeights *weights = this->Weights;
+  weights->Initialize(firstPoint, numPts);
+  vtkIdType numWeights = 0;
+  for (size_t c = 0; c < job.Chunks.size(); ++c)
+    {
+    msvVTKEmbeddedProbeFilterWeightsChunk &chunk = job.Chunks[c];
+    if (chunk.FailedPoint >= 0)
       {
-      cell->EvaluateLocation(subId, pcoords, coords, weights);
-      points->SetPoint(ptId, coords);
+      vtkErrorMacro(<<"No cell found with ID "<<chunk.FailedCellId);
+      weights->Initialize(0, 0);
+      return 0;
       }
-    else
+    numWeights += static_cast<vtkIdType>(chunk.Weights.size());
+    }
+  weights->PointIds.reserve(numWeights);
+  weights->Weights.reserve(numWeights);
+  vtkIdType offset = 0;
+  for (size_t c = 0; c < job.Chunks.size(); ++c)
+    {
+    msvVTKEmbeddedProbeFilterWeightsChunk &chunk = job.Chunks[c];
+    for (size_t i = 0; i < chunk.Sizes.size(); ++i)
       {
-      cell->InterpolateFunctions(pcoords, weights);
+      weights->CellIds[chunk.Begin - firstPoint + i] = chunk.CellIds[i];
+      weights->Offsets[chunk.Begin - firstPoint + i] = offset;
+      offset += chunk.Sizes[i];
       }
+    weights->PointIds.insert(weights->PointIds.end(),
+                             chunk.PointIds.begin(), chunk.PointIds.end());
+    weights->Weights.insert(weights->Weights.end(),
+                            chunk.Weights.begin(), chunk.Weights.end());
+    }
+  weights->Offsets[numPts] = offset;
+  return 1;
+}
+
+//----------------------------------------------------------------------------
+int msvVTKEmbeddedProbeFilter::ComputeStructuredWeights(
+  vtkIdTypeArray *cellIdArray, vtkDataArray *pcoordArray,
+  vtkIdType firstPoint, vtkIdType numPts, const int dims[3])
+{
+  const int numCorners = 1 << ((dims[0] > 1) + (dims[1] > 1) + (dims[2] > 1));
+  msvVTKEmbeddedProbeFilterWeights *weights = this->Weights;
+  weights->Initialize(firstPoint, numPts);
+  weights->PointIds.resize(numPts * numCorners);
+  weights->Weights.resize(numPts * numCorners);
+  weights->Offsets[numPts] = numPts * numCorners;
 
-    // Interpolate the point data
-    outputPD->InterpolatePoint((*this->PointList), sourcePD, srcIdx, ptId,
-      cell->PointIds, weights);
-    vtkVectorOfArrays::iterator iter;
-    for (iter = this->CellArrays->begin(); iter != this->CellArrays->end();
-      ++iter)
+  msvVTKEmbeddedProbeFilterStructuredJob job;
+  job.CellIds = cellIdArray ? cellIdArray->GetPointer(0) : 0;
+  job.NumberOfCellIds = cellIdArray ? cellIdArray->GetNumberOfTuples() : 0;
+  job.PCoordArray = pcoordArray;
+  job.FirstPoint = firstPoint;
+  job.NumberOfPoints = numPts;
+  job.Dimensions[0] = dims[0];
+  job.Dimensions[1] = dims[1];
+  job.Dimensions[2] = dims[2];
+  job.Weights = weights;
+
+  vtkNew<vtkMultiThreader> threader;
+  threader->SetNumberOfThreads(static_cast<int>(std::min(
+    static_cast<vtkIdType>(this->NumberOfThreads),
+    std::max(numPts, static_cast<vtkIdType>(1)))));
+  job.FailedPoints.assign(threader->GetNumberOfThreads(), -1);
+  job.FailedCellIds.assign(threader->GetNumberOfThreads(), -1);
+  threader->SetSingleMethod(msvComputeStructuredWeightsThread, &job);
+  threader->SingleMethodExecute();
+
+  for (size_t t = 0; t < job.FailedPoints.size(); ++t)
+    {
+    if (job.FailedPoints[t] >= 0)
       {
-      vtkDataArray* inArray = sourceCD->GetArray((*iter)->GetName());
-      if (inArray)
-        {
-        outputPD->CopyTuple(inArray, *iter, cellId, ptId);
-        }
+      vtkErrorMacro(<<"No cell found with ID "<<job.FailedCellIds[t]);
+      weights->Initialize(0, 0);
+      return 0;
+      }
+    }
+  return 1;
+}
+
+//----------------------------------------------------------------------------
+int msvVTKEmbeddedProbeFilter::UpdateEmbedding(vtkDataSet *input,
+  vtkDataSet *source)
+{
+  msvVTKEmbeddedProbeFilterEmbedding *embedding = this->Embedding;
+  vtkPointSet *inputPointSet = vtkPointSet::SafeDownCast(input);
+  vtkDataArray *points = (inputPointSet && inputPointSet->GetPoints()) ?
+    inputPointSet->GetPoints()->GetData() : 0;
+  const unsigned long pointsMTime =
+    points ? points->GetMTime() : input->GetMTime();
+  if (embedding->Valid &&
+      embedding->NumberOfPoints == input->GetNumberOfPoints() &&
+      embedding->NumberOfCells == source->GetNumberOfCells() &&
+      embedding->SourceType == source->GetDataObjectType())
+    {
+    if (embedding->Points == points && embedding->PointsMTime == pointsMTime)
+      {
+      return 1;
+      }
+    // Same points in a new or modified array: compare their content.
+    const vtkTypeUInt64 pointsHash = msvHashPoints(input, points);
+    if (embedding->PointsHash == pointsHash)
+      {
+      embedding->Points = points;
+      embedding->PointsMTime = pointsMTime;
+      return 1;
       }
     }
-  delete[] weights;
+  embedding->Valid = false;
 
-  return result;
+  const vtkIdType numPts = input->GetNumberOfPoints();
+  vtkSmartPointer<vtkIdTypeArray> cellIds =
+    vtkSmartPointer<vtkIdTypeArray>::New();
+  cellIds->SetName(this->CellIdArrayName ? this->CellIdArrayName : "cellId");
+  cellIds->SetNumberOfTuples(numPts);
+  vtkSmartPointer<vtkDoubleArray> pcoords =
+    vtkSmartPointer<vtkDoubleArray>::New();
+  pcoords->SetName(this->ParametricCoordinateArrayName ?
+    this->ParametricCoordinateArrayName : "pcoord");
+  pcoords->SetNumberOfComponents(3);
+  pcoords->SetNumberOfTuples(numPts);
+
+  msvCellBins bins;
+  msvBuildCellBins(source, this->NumberOfThreads, bins);
+
+  msvLocatePointsJob job;
+  job.Input = input;
+  job.Source = source;
+  job.Bins = &bins;
+  job.CellIds = cellIds->GetPointer(0);
+  job.PCoords = pcoords->GetPointer(0);
+  vtkNew<vtkMultiThreader> threader;
+  threader->SetNumberOfThreads(static_cast<int>(std::min(
+    static_cast<vtkIdType>(this->NumberOfThreads),
+    std::max(numPts, static_cast<vtkIdType>(1)))));
+  job.FailedPoints.assign(threader->GetNumberOfThreads(), -1);
+  threader->SetSingleMethod(msvLocatePointsThread, &job);
+  threader->SingleMethodExecute();
+  for (size_t t = 0; t < job.FailedPoints.size(); ++t)
+    {
+    if (job.FailedPoints[t] >= 0)
+      {
+      vtkErrorMacro(<<"Point "<<job.FailedPoints[t]
+                    <<" is not inside any Source cell.");
+      return 0;
+      }
+    }
+
+  embedding->CellIds = cellIds;
+  embedding->PCoords = pcoords;
+  embedding->Points = points;
+  embedding->PointsMTime = pointsMTime;
+  embedding->PointsHash = msvHashPoints(input, points);
+  embedding->NumberOfPoints = numPts;
+  embedding->NumberOfCells = source->GetNumberOfCells();
+  embedding->SourceType = source->GetDataObjectType();
+  embedding->Valid = true;
+  ++this->NumberOfEmbeddings;
+  return 1;
 }
 
 //----------------------------------------------------------------------------
@@ -322,9 +1658,8 @@ int msvVTKEmbeddedProbeFilter::RequestInformation(
   outInfo->Set(vtkStreamingDemandDrivenPipeline::WHOLE_EXTENT(),
                inInfo->Get(vtkStreamingDemandDrivenPipeline::WHOLE_EXTENT()),
                6);
-  outInfo->Set(vtkStreamingDemandDrivenPipeline::MAXIMUM_NUMBER_OF_PIECES(),
-               inInfo->Get(
-                 vtkStreamingDemandDrivenPipeline::MAXIMUM_NUMBER_OF_PIECES()));
+  outInfo->CopyEntry(inInfo,
+    vtkStreamingDemandDrivenPipeline::MAXIMUM_NUMBER_OF_PIECES());
 
   return 1;
 }
@@ -341,12 +1676,24 @@ int msvVTKEmbeddedProbeFilter::RequestUpdateExtent(
   vtkInformation *outInfo = outputVector->GetInformationObject(0);
   
   inInfo->Set(vtkStreamingDemandDrivenPipeline::EXACT_EXTENT(), 1);
-  sourceInfo->Set(
-    vtkStreamingDemandDrivenPipeline::UPDATE_PIECE_NUMBER(), 0);
-  sourceInfo->Set(
-    vtkStreamingDemandDrivenPipeline::UPDATE_NUMBER_OF_PIECES(), 1);
-  sourceInfo->Set(
-    vtkStreamingDemandDrivenPipeline::UPDATE_NUMBER_OF_GHOST_LEVELS(), 0);
+  if (this->PassPiecesToSource)
+    {
+    sourceInfo->CopyEntry(outInfo,
+      vtkStreamingDemandDrivenPipeline::UPDATE_PIECE_NUMBER());
+    sourceInfo->CopyEntry(outInfo,
+      vtkStreamingDemandDrivenPipeline::UPDATE_NUMBER_OF_PIECES());
+    sourceInfo->CopyEntry(outInfo,
+      vtkStreamingDemandDrivenPipeline::UPDATE_NUMBER_OF_GHOST_LEVELS());
+    }
+  else
+    {
+    sourceInfo->Set(
+      vtkStreamingDemandDrivenPipeline::UPDATE_PIECE_NUMBER(), 0);
+    sourceInfo->Set(
+      vtkStreamingDemandDrivenPipeline::UPDATE_NUMBER_OF_PIECES(), 1);
+    sourceInfo->Set(
+      vtkStreamingDemandDrivenPipeline::UPDATE_NUMBER_OF_GHOST_LEVELS(), 0);
+    }
   inInfo->Set(
     vtkStreamingDemandDrivenPipeline::UPDATE_EXTENT(),
     outInfo->Get(vtkStreamingDemandDrivenPipeline::UPDATE_EXTENT()), 6);
@@ -369,4 +1716,14 @@ void msvVTKEmbeddedProbeFilter::PrintSelf(ostream& os, vtkIndent indent)
   os << indent << "ParametricCoordinateArrayName: " <<
     (this->ParametricCoordinateArrayName ?
     this->ParametricCoordinateArrayName : "<none>") << "\n";
+  os << indent << "PassPiecesToSource: " << this->PassPiecesToSource << "\n";
+  os << indent << "NumberOfThreads: " << this->NumberOfThreads << "\n";
+  os << indent << "CacheWeights: " << this->CacheWeights << "\n";
+  os << indent << "NumberOfWeightComputations: "
+     << this->NumberOfWeightComputations << "\n";
+  os << indent << "StreamingChunkSize: " << this->StreamingChunkSize << "\n";
+  os << indent << "MemoryFootprint: " << this->MemoryFootprint << "\n";
+  os << indent << "StructuredFastPath: " << this->StructuredFastPath << "\n";
+  os << indent << "AutoEmbed: " << this->AutoEmbed << "\n";
+  os << indent << "NumberOfEmbeddings: " << this->NumberOfEmbeddings << "\n";
 }
@@ -53,9 +53,15 @@
 #include "vtkDataSetAlgorithm.h"
 #include "vtkDataSetAttributes.h" // needed for vtkDataSetAttributes::FieldList
 
+class vtkDataArray;
 class vtkIdTypeArray;
+class vtkInformationIntegerVectorKey;
 class vtkCharArray;
 class vtkMaskPoints;
+class vtkPointData;
+struct msvVTKEmbeddedProbeFilterEmbedding;
+struct msvVTKEmbeddedProbeFilterGatherJob;
+struct msvVTKEmbeddedProbeFilterWeights;
 
 class MSV_VTK_GRAPHICS_EXPORT msvVTKEmbeddedProbeFilter :
   public vtkDataSetAlgorithm
@@ -89,6 +95,85 @@ public:
   vtkSetStringMacro(ParametricCoordinateArrayName)
   vtkGetStringMacro(ParametricCoordinateArrayName)
 
+  // Description:
+  // Specify whether the Source is requested with the same piece, number of
+  // pieces and ghost levels as the output. This requires the cell ids of
+  // each Input piece to refer to the cells of the matching Source piece,
+  // e.g. when both are partitioned together. When off, the whole Source is
+  // requested for every piece of the Input. Off by default.
+  vtkSetMacro(PassPiecesToSource, int);
+  vtkGetMacro(PassPiecesToSource, int);
+  vtkBooleanMacro(PassPiecesToSource, int);
+
+  // Description:
+  // Number of threads the points are probed on. Defaults to
+  // vtkMultiThreader::GetGlobalDefaultNumberOfThreads().
+  vtkSetClampMacro(NumberOfThreads, int, 1, VTK_MAX_THREADS);
+  vtkGetMacro(NumberOfThreads, int);
+
+  // Description:
+  // Reuse the interpolation weights of the previous update while the cell
+  // id and parametric coordinate arrays of the input and the topology of
+  // the source are unchanged, e.g. when only the time step of the source
+  // changes. On by default.
+  vtkSetMacro(CacheWeights, int);
+  vtkGetMacro(CacheWeights, int);
+  vtkBooleanMacro(CacheWeights, int);
+
+  // Description:
+  // Number of times the interpolation weights have been computed.
+  vtkGetMacro(NumberOfWeightComputations, int);
+
+  // Description:
+  // Maximum number of points whose interpolation weights are held at once.
+  // When the input has more points, they are probed chunk by chunk and the
+  // weights are not cached across updates. The output arrays still hold all
+  // the points of the Input: downstream piece requests (e.g. a writer
+  // streaming pieces), which are forwarded to the Input, bound them.
+  // 0 (no chunking) by default.
+  vtkSetClampMacro(StreamingChunkSize, vtkIdType, 0, VTK_LARGE_ID);
+  vtkGetMacro(StreamingChunkSize, vtkIdType);
+
+  // Description:
+  // Memory footprint of the last update, in kibibytes: Input, Source and
+  // output actual memory sizes once the output is filled, plus the largest
+  // weights table held during the update.
+  vtkGetMacro(MemoryFootprint, unsigned long);
+
+  // Description:
+  // Compute the interpolation weights arithmetically from the lattice
+  // indices of the cells when the Source is a vtkImageData, a
+  // vtkRectilinearGrid or a vtkStructuredGrid without blanking, instead of
+  // going through vtkDataSet::GetCell(). On by default.
+  vtkSetMacro(StructuredFastPath, int);
+  vtkGetMacro(StructuredFastPath, int);
+  vtkBooleanMacro(StructuredFastPath, int);
+
+  // Description:
+  // When the cell id or parametric coordinate arrays are missing from the
+  // Input point data, locate the Input points in the Source cells and add
+  // the resulting arrays, named CellIdArrayName and
+  // ParametricCoordinateArrayName ("cellId" and "pcoord" if unset), to the
+  // output point data. The embedding is computed once on NumberOfThreads
+  // threads and reused until the coordinates of the Input points or the
+  // number of Source cells change, so later time steps of a deforming Source
+  // keep the embedding of the first one. The added arrays are tagged with
+  // EMBEDDED_POINTS_HASH, and tagged Input arrays computed for other point
+  // coordinates are considered missing. Off by default.
+  vtkSetMacro(AutoEmbed, int);
+  vtkGetMacro(AutoEmbed, int);
+  vtkBooleanMacro(AutoEmbed, int);
+
+  // Description:
+  // Number of times the Input points have been located by AutoEmbed.
+  vtkGetMacro(NumberOfEmbeddings, int);
+
+  // Description:
+  // Key set on the information of the cell id and parametric coordinate
+  // arrays added by AutoEmbed: the hash of the coordinates of the output
+  // points they were computed for, as two 32 bits halves.
+  static vtkInformationIntegerVectorKey* EMBEDDED_POINTS_HASH();
+
 //BTX 
 protected:
   msvVTKEmbeddedProbeFilter();
@@ -96,6 +181,15 @@ protected:
 
   char *CellIdArrayName;
   char *ParametricCoordinateArrayName;
+  int PassPiecesToSource;
+  int NumberOfThreads;
+  int CacheWeights;
+  int NumberOfWeightComputations;
+  vtkIdType StreamingChunkSize;
+  unsigned long MemoryFootprint;
+  int StructuredFastPath;
+  int AutoEmbed;
+  int NumberOfEmbeddings;
 
   virtual int RequestData(vtkInformation *, vtkInformationVector **, 
     vtkInformationVector *);
@@ -124,6 +218,41 @@ protected:
   int PerformProbe(vtkDataSet *input, int srcIdx, vtkDataSet *source, 
     vtkDataSet *output);
 
+  // Description:
+  // Get the cell id (NULL if CellIdArrayName is not set) and parametric
+  // coordinate arrays of the numPts points of inputPD. Return 0 if they
+  // are missing or invalid, reporting why if reportErrors is true.
+  int GetEmbeddingArrays(vtkPointData *inputPD, vtkIdType numPts,
+    vtkIdTypeArray *&cellIdArray, vtkDataArray *&pcoordArray,
+    bool reportErrors);
+
+  // Description:
+  // Locate the Input points in the Source cells for AutoEmbed, unless the
+  // current embedding still applies.
+  int UpdateEmbedding(vtkDataSet *input, vtkDataSet *source);
+
+  // Description:
+  // Compute the interpolation weights of the numPts embedded points starting
+  // at firstPoint in the source cells given by cellIdArray (cell 0 if NULL)
+  // at the parametric coordinates pcoordArray. evaluateLocation selects the
+  // weights of vtkCell::EvaluateLocation() instead of
+  // vtkCell::InterpolateFunctions().
+  int ComputeWeights(vtkIdTypeArray *cellIdArray, vtkDataArray *pcoordArray,
+    vtkIdType firstPoint, vtkIdType numPts, vtkDataSet *source,
+    bool evaluateLocation);
+
+  // Description:
+  // ComputeWeights() for a structured source of point dimensions dims.
+  int ComputeStructuredWeights(vtkIdTypeArray *cellIdArray,
+    vtkDataArray *pcoordArray, vtkIdType firstPoint, vtkIdType numPts,
+    const int dims[3]);
+
+  // Description:
+  // Fill the output arrays of job for the numPts points of the current
+  // weights table.
+  void GatherWeights(msvVTKEmbeddedProbeFilterGatherJob *job,
+    vtkIdType numPts);
+
   vtkDataSetAttributes::FieldList* CellList;
   vtkDataSetAttributes::FieldList* PointList;
 private:
@@ -133,6 +262,8 @@ private:
 
   class vtkVectorOfArrays;
   vtkVectorOfArrays* CellArrays;
+  msvVTKEmbeddedProbeFilterWeights* Weights;
+  msvVTKEmbeddedProbeFilterEmbedding* Embedding;
 //ETX
 };
 
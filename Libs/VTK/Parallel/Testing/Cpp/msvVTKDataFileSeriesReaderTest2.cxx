@@ -0,0 +1,120 @@
+/*==============================================================================
+
+  Library: MSVTK
+
+  Copyright (c) Kitware Inc.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0.txt
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// MSVTK
+#include "msvVTKDataFileSeriesReader.h"
+
+// VTK includes
+#include "vtkNew.h"
+#include "vtkPolyData.h"
+#include "vtkPolyDataReader.h"
+#include "vtkStreamingDemandDrivenPipeline.h"
+#include "vtkTestUtilities.h"
+
+// STD includes
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+// -----------------------------------------------------------------------------
+// Read the series forward then backward with prefetching on and check the
+// outputs against the ones read without cache.
+int msvVTKDataFileSeriesReaderTest2(int argc, char* argv[])
+{
+  char* file0 =
+    vtkTestUtilities::ExpandDataFileName(argc,argv,"Polydata00.vtk");
+  char* file1 =
+    vtkTestUtilities::ExpandDataFileName(argc,argv,"Polydata01.vtk");
+  const std::string fileNames[2] = {file0, file1};
+  delete [] file0;
+  delete [] file1;
+  const char* files[] = {fileNames[0].c_str(), fileNames[1].c_str(),
+                         fileNames[0].c_str(), fileNames[1].c_str(),
+                         fileNames[0].c_str(), fileNames[1].c_str()};
+  const int numberOfFiles = 6;
+
+  vtkNew<vtkPolyDataReader> polyDataReader;
+  vtkNew<msvVTKDataFileSeriesReader> fileSeriesReader;
+  fileSeriesReader->SetReader(polyDataReader.GetPointer());
+  for (int i = 0; i < numberOfFiles; ++i)
+    {
+    fileSeriesReader->AddFileName(files[i]);
+    }
+  fileSeriesReader->UsePrefetchOn();
+  fileSeriesReader->SetPrefetchDepth(2);
+  fileSeriesReader->SetCacheSize(4);
+  fileSeriesReader->UpdateInformation();
+
+  vtkStreamingDemandDrivenPipeline* executive =
+    vtkStreamingDemandDrivenPipeline::SafeDownCast(
+      fileSeriesReader->GetExecutive());
+
+  vtkIdType expectedPoints[2];
+  for (int i = 0; i < 2; ++i)
+    {
+    vtkNew<vtkPolyDataReader> referenceReader;
+    referenceReader->SetFileName(files[i]);
+    referenceReader->Update();
+    expectedPoints[i] = referenceReader->GetOutput()->GetNumberOfPoints();
+    }
+
+  for (int pass = 0; pass < 2; ++pass)
+    {
+    for (int step = 0; step < numberOfFiles; ++step)
+      {
+      int index = (pass == 0) ? step : numberOfFiles - 1 - step;
+      executive->SetUpdateTimeStep(0, static_cast<double>(index));
+      fileSeriesReader->Update();
+      vtkPolyData* output =
+        vtkPolyData::SafeDownCast(fileSeriesReader->GetOutputDataObject(0));
+      if (!output || output->GetNumberOfPoints() != expectedPoints[index % 2])
+        {
+        std::cerr << "Error: wrong output for time step " << index
+                  << std::endl;
+        return EXIT_FAILURE;
+        }
+      }
+    }
+
+  if (fileSeriesReader->GetCacheHits() + fileSeriesReader->GetCacheMisses()
+      != 2 * numberOfFiles)
+    {
+    std::cerr << "Error: every time step must be a cache hit or a miss."
+              << std::endl;
+    return EXIT_FAILURE;
+    }
+  if (fileSeriesReader->GetCacheHits() == 0)
+    {
+    std::cerr << "Error: read ahead time steps were not served from the cache."
+              << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  fileSeriesReader->ResetCacheStatistics();
+  if (fileSeriesReader->GetCacheHits() != 0 ||
+      fileSeriesReader->GetCacheMisses() != 0)
+    {
+    std::cerr << "Error: cache statistics not reset." << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  fileSeriesReader->Print(std::cout);
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,133 @@
+/*==============================================================================
+
+  Library: MSVTK
+
+  Copyright (c) Kitware Inc.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0.txt
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// MSVTK
+#include "msvVTKDataFileSeriesReader.h"
+
+// VTK includes
+#include "vtkInformation.h"
+#include "vtkInformationVector.h"
+#include "vtkNew.h"
+#include "vtkObjectFactory.h"
+#include "vtkPolyData.h"
+#include "vtkPolyDataReader.h"
+#include "vtkStreamingDemandDrivenPipeline.h"
+#include "vtkTestUtilities.h"
+
+// STD includes
+#include <cstdlib>
+#include <iostream>
+
+// -----------------------------------------------------------------------------
+// Polydata reader reporting every file as a partition of the time step 0.
+class msvVTKPartitionPolyDataReader : public vtkPolyDataReader
+{
+public:
+  static msvVTKPartitionPolyDataReader* New();
+  vtkTypeMacro(msvVTKPartitionPolyDataReader, vtkPolyDataReader);
+
+protected:
+  msvVTKPartitionPolyDataReader(){}
+
+  virtual int RequestInformation(vtkInformation* request,
+                                 vtkInformationVector** inputVector,
+                                 vtkInformationVector* outputVector)
+  {
+    double time = 0.;
+    double timeRange[2] = {0., 0.};
+    vtkInformation* outInfo = outputVector->GetInformationObject(0);
+    outInfo->Set(vtkStreamingDemandDrivenPipeline::TIME_STEPS(), &time, 1);
+    outInfo->Set(vtkStreamingDemandDrivenPipeline::TIME_RANGE(), timeRange, 2);
+    return this->Superclass::RequestInformation(request, inputVector,
+                                                outputVector);
+  }
+
+private:
+  msvVTKPartitionPolyDataReader(const msvVTKPartitionPolyDataReader&);
+  void operator=(const msvVTKPartitionPolyDataReader&);
+};
+
+vtkStandardNewMacro(msvVTKPartitionPolyDataReader);
+
+// -----------------------------------------------------------------------------
+// Read two partitions of a time step as 1, 2 and 3 pieces in SPLIT_FILES
+// mode and check that each piece gets its share of the files. A single piece
+// is read as usual, from the last file of the time step.
+int msvVTKDataFileSeriesReaderTest3(int argc, char* argv[])
+{
+  const char* files[2];
+  files[0] = vtkTestUtilities::ExpandDataFileName(argc,argv,"Polydata00.vtk");
+  files[1] = vtkTestUtilities::ExpandDataFileName(argc,argv,"Polydata01.vtk");
+
+  vtkIdType filePoints[2];
+  for (int i = 0; i < 2; ++i)
+    {
+    vtkNew<vtkPolyDataReader> referenceReader;
+    referenceReader->SetFileName(files[i]);
+    referenceReader->Update();
+    filePoints[i] = referenceReader->GetOutput()->GetNumberOfPoints();
+    }
+
+  vtkNew<msvVTKPartitionPolyDataReader> polyDataReader;
+  vtkNew<msvVTKDataFileSeriesReader> fileSeriesReader;
+  if (fileSeriesReader->GetPieceMode() !=
+      msvVTKFileSeriesReader::FORWARD_PIECES)
+    {
+    std::cerr << "Error: pieces must be forwarded by default." << std::endl;
+    return EXIT_FAILURE;
+    }
+  fileSeriesReader->SetPieceModeToSplitFiles();
+  fileSeriesReader->SetReader(polyDataReader.GetPointer());
+  fileSeriesReader->AddFileName(files[0]);
+  fileSeriesReader->AddFileName(files[1]);
+
+  vtkStreamingDemandDrivenPipeline* executive =
+    vtkStreamingDemandDrivenPipeline::SafeDownCast(
+      fileSeriesReader->GetExecutive());
+
+  // Expected number of points of each piece, for 1, 2 and 3 pieces.
+  const vtkIdType expectedPoints[3][3] = {
+    {filePoints[1], 0, 0},
+    {filePoints[0], filePoints[1], 0},
+    {0, filePoints[0], filePoints[1]}};
+  for (int numPieces = 1; numPieces <= 3; ++numPieces)
+    {
+    for (int piece = 0; piece < numPieces; ++piece)
+      {
+      fileSeriesReader->UpdateInformation();
+      executive->SetUpdateExtent(0, piece, numPieces, 0);
+      fileSeriesReader->Update();
+      vtkPolyData* output =
+        vtkPolyData::SafeDownCast(fileSeriesReader->GetOutputDataObject(0));
+      vtkIdType numPoints = output ? output->GetNumberOfPoints() : -1;
+      if (numPoints != expectedPoints[numPieces - 1][piece])
+        {
+        std::cerr << "Error: piece " << piece << " of " << numPieces
+                  << " has " << numPoints << " points instead of "
+                  << expectedPoints[numPieces - 1][piece] << std::endl;
+        return EXIT_FAILURE;
+        }
+      }
+    }
+
+  delete [] files[0];
+  delete [] files[1];
+  return EXIT_SUCCESS;
+}
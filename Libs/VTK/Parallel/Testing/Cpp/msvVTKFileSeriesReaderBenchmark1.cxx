@@ -0,0 +1,161 @@
+/*==============================================================================
+
+  Library: MSVTK
+
+  Copyright (c) Kitware Inc.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0.txt
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// MSVTK
+#include "msvVTKDataFileSeriesReader.h"
+
+// VTK includes
+#include "vtkExecutive.h"
+#include "vtkInformation.h"
+#include "vtkInformationVector.h"
+#include "vtkNew.h"
+#include "vtkObjectFactory.h"
+#include "vtkPolyDataReader.h"
+#include "vtkPolyDataWriter.h"
+#include "vtkSphereSource.h"
+#include "vtkStreamingDemandDrivenPipeline.h"
+#include "vtkTimerLog.h"
+
+// VTKSYS includes
+#include <vtksys/SystemTools.hxx>
+
+// STD includes
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// -----------------------------------------------------------------------------
+// Polydata reader reporting a time step equal to the file length, after
+// reading the file header.
+class msvVTKFileLengthPolyDataReader : public vtkPolyDataReader
+{
+public:
+  static msvVTKFileLengthPolyDataReader* New();
+  vtkTypeMacro(msvVTKFileLengthPolyDataReader, vtkPolyDataReader);
+
+protected:
+  msvVTKFileLengthPolyDataReader(){}
+
+  virtual int RequestInformation(vtkInformation* request,
+                                 vtkInformationVector** inputVector,
+                                 vtkInformationVector* outputVector)
+  {
+    if (!this->Superclass::RequestInformation(request, inputVector,
+                                              outputVector))
+      {
+      return 0;
+      }
+    if (!this->OpenVTKFile() || !this->ReadHeader())
+      {
+      this->CloseVTKFile();
+      return 0;
+      }
+    this->CloseVTKFile();
+    double time = static_cast<double>(
+      vtksys::SystemTools::FileLength(this->GetFileName()));
+    double timeRange[2] = {time, time};
+    vtkInformation* outInfo = outputVector->GetInformationObject(0);
+    outInfo->Set(vtkStreamingDemandDrivenPipeline::TIME_STEPS(), &time, 1);
+    outInfo->Set(vtkStreamingDemandDrivenPipeline::TIME_RANGE(), timeRange, 2);
+    return 1;
+  }
+
+private:
+  msvVTKFileLengthPolyDataReader(const msvVTKFileLengthPolyDataReader&);
+  void operator=(const msvVTKFileLengthPolyDataReader&);
+};
+
+vtkStandardNewMacro(msvVTKFileLengthPolyDataReader);
+
+// -----------------------------------------------------------------------------
+// Report the time taken to scan the headers of a long series of files with
+// an increasing number of threads. Only added to ctest with
+// MSVTK_BUILD_BENCHMARKS; msvVTKFileSeriesReaderTest2 checks the scan.
+int msvVTKFileSeriesReaderBenchmark1(int vtkNotUsed(argc),
+                                     char* vtkNotUsed(argv)[])
+{
+  const int numberOfFiles = 256;
+  const int numbersOfThreads[] = {1, 2, 4, 8, 16};
+
+  std::vector<std::string> files;
+  for (int i = 0; i < numberOfFiles; ++i)
+    {
+    std::stringstream fileName;
+    fileName << "msvVTKFileSeriesReaderBenchmark1_" << i << ".vtk";
+    vtkNew<vtkSphereSource> sphere;
+    sphere->SetThetaResolution(3 + i);
+    vtkNew<vtkPolyDataWriter> writer;
+    writer->SetInputConnection(sphere->GetOutputPort());
+    writer->SetFileName(fileName.str().c_str());
+    writer->Write();
+    files.push_back(fileName.str());
+    }
+
+  std::vector<double> expectedTimeSteps;
+  for (int t = 0; t < 5; ++t)
+    {
+    vtkNew<msvVTKFileLengthPolyDataReader> polyDataReader;
+    vtkNew<msvVTKDataFileSeriesReader> fileSeriesReader;
+    fileSeriesReader->SetReader(polyDataReader.GetPointer());
+    for (int i = 0; i < numberOfFiles; ++i)
+      {
+      fileSeriesReader->AddFileName(files[i].c_str());
+      }
+    fileSeriesReader->SetNumberOfScanThreads(numbersOfThreads[t]);
+
+    vtkNew<vtkTimerLog> timer;
+    timer->StartTimer();
+    fileSeriesReader->UpdateInformation();
+    timer->StopTimer();
+    std::cout << "Scanned " << numberOfFiles << " files with "
+              << numbersOfThreads[t] << " thread(s) in "
+              << timer->GetElapsedTime() << "s" << std::endl;
+
+    vtkInformation* outInfo =
+      fileSeriesReader->GetExecutive()->GetOutputInformation(0);
+    int numberOfTimeSteps =
+      outInfo->Length(vtkStreamingDemandDrivenPipeline::TIME_STEPS());
+    double* timeSteps =
+      outInfo->Get(vtkStreamingDemandDrivenPipeline::TIME_STEPS());
+    if (numberOfTimeSteps != numberOfFiles || !timeSteps)
+      {
+      std::cerr << "Error: " << numberOfTimeSteps << " time steps with "
+                << numbersOfThreads[t] << " thread(s), expected "
+                << numberOfFiles << "." << std::endl;
+      return EXIT_FAILURE;
+      }
+    std::vector<double> scannedTimeSteps(timeSteps,
+                                         timeSteps + numberOfTimeSteps);
+    if (t == 0)
+      {
+      expectedTimeSteps = scannedTimeSteps;
+      }
+    else if (scannedTimeSteps != expectedTimeSteps)
+      {
+      std::cerr << "Error: time steps scanned with " << numbersOfThreads[t]
+                << " threads differ from the serial scan." << std::endl;
+      return EXIT_FAILURE;
+      }
+    }
+
+  return EXIT_SUCCESS;
+}
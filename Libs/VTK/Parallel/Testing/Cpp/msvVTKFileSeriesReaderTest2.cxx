@@ -0,0 +1,178 @@
+/*==============================================================================
+
+  Library: MSVTK
+
+  Copyright (c) Kitware Inc.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0.txt
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// MSVTK
+#include "msvVTKDataFileSeriesReader.h"
+
+// VTK includes
+#include "vtkExecutive.h"
+#include "vtkInformation.h"
+#include "vtkInformationVector.h"
+#include "vtkNew.h"
+#include "vtkObjectFactory.h"
+#include "vtkPolyDataReader.h"
+#include "vtkPolyDataWriter.h"
+#include "vtkSphereSource.h"
+#include "vtkStreamingDemandDrivenPipeline.h"
+
+// VTKSYS includes
+#include <vtksys/SystemTools.hxx>
+
+// STD includes
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// -----------------------------------------------------------------------------
+// Polydata reader reporting a time step equal to the file length. It counts
+// its instances, i.e. the readers cloned to scan the files, and the files it
+// is queried for.
+class msvVTKTimePolyDataReader : public vtkPolyDataReader
+{
+public:
+  static msvVTKTimePolyDataReader* New();
+  vtkTypeMacro(msvVTKTimePolyDataReader, vtkPolyDataReader);
+
+  vtkGetMacro(NumberOfQueries, int);
+  static int NumberOfInstances;
+
+protected:
+  msvVTKTimePolyDataReader() : NumberOfQueries(0) { ++NumberOfInstances; }
+
+  virtual int RequestInformation(vtkInformation* request,
+                                 vtkInformationVector** inputVector,
+                                 vtkInformationVector* outputVector)
+  {
+    if (!this->Superclass::RequestInformation(request, inputVector,
+                                              outputVector))
+      {
+      return 0;
+      }
+    if (!this->OpenVTKFile() || !this->ReadHeader())
+      {
+      this->CloseVTKFile();
+      return 0;
+      }
+    this->CloseVTKFile();
+    ++this->NumberOfQueries;
+    double time = static_cast<double>(
+      vtksys::SystemTools::FileLength(this->GetFileName()));
+    double timeRange[2] = {time, time};
+    vtkInformation* outInfo = outputVector->GetInformationObject(0);
+    outInfo->Set(vtkStreamingDemandDrivenPipeline::TIME_STEPS(), &time, 1);
+    outInfo->Set(vtkStreamingDemandDrivenPipeline::TIME_RANGE(), timeRange, 2);
+    return 1;
+  }
+
+  int NumberOfQueries;
+
+private:
+  msvVTKTimePolyDataReader(const msvVTKTimePolyDataReader&);
+  void operator=(const msvVTKTimePolyDataReader&);
+};
+
+vtkStandardNewMacro(msvVTKTimePolyDataReader);
+int msvVTKTimePolyDataReader::NumberOfInstances = 0;
+
+// -----------------------------------------------------------------------------
+// Scan the time information of a long series of files of distinct lengths,
+// thus distinct time steps, with an increasing number of threads. Check that
+// the files are scanned by cloned readers and that the aggregated time steps
+// match the ones scanned serially.
+int msvVTKFileSeriesReaderTest2(int vtkNotUsed(argc), char* vtkNotUsed(argv)[])
+{
+  const int numberOfFiles = 64;
+  const int numbersOfThreads[] = {1, 2, 4, 8};
+
+  std::vector<std::string> files;
+  for (int i = 0; i < numberOfFiles; ++i)
+    {
+    std::stringstream fileName;
+    fileName << "msvVTKFileSeriesReaderTest2_" << i << ".vtk";
+    vtkNew<vtkSphereSource> sphere;
+    sphere->SetThetaResolution(3 + i);
+    vtkNew<vtkPolyDataWriter> writer;
+    writer->SetInputConnection(sphere->GetOutputPort());
+    writer->SetFileName(fileName.str().c_str());
+    writer->Write();
+    files.push_back(fileName.str());
+    }
+
+  std::vector<double> expectedTimeSteps;
+  for (int t = 0; t < 4; ++t)
+    {
+    msvVTKTimePolyDataReader::NumberOfInstances = 0;
+    vtkNew<msvVTKTimePolyDataReader> polyDataReader;
+    vtkNew<msvVTKDataFileSeriesReader> fileSeriesReader;
+    fileSeriesReader->SetReader(polyDataReader.GetPointer());
+    for (int i = 0; i < numberOfFiles; ++i)
+      {
+      fileSeriesReader->AddFileName(files[i].c_str());
+      }
+    fileSeriesReader->SetNumberOfScanThreads(numbersOfThreads[t]);
+    fileSeriesReader->UpdateInformation();
+
+    // Serially, every file is queried on the internal reader. Otherwise only
+    // the first one is, the others are scanned by a clone each.
+    int expectedClones = (t == 0) ? 0 : numberOfFiles - 1;
+    int expectedQueries = (t == 0) ? numberOfFiles : 1;
+    if (msvVTKTimePolyDataReader::NumberOfInstances - 1 != expectedClones ||
+        polyDataReader->GetNumberOfQueries() != expectedQueries)
+      {
+      std::cerr << "Error: " << numbersOfThreads[t] << " thread(s) cloned "
+                << msvVTKTimePolyDataReader::NumberOfInstances - 1
+                << " reader(s) and queried the internal reader "
+                << polyDataReader->GetNumberOfQueries() << " time(s), "
+                << "expected " << expectedClones << " and "
+                << expectedQueries << "." << std::endl;
+      return EXIT_FAILURE;
+      }
+
+    vtkInformation* outInfo =
+      fileSeriesReader->GetExecutive()->GetOutputInformation(0);
+    int numberOfTimeSteps =
+      outInfo->Length(vtkStreamingDemandDrivenPipeline::TIME_STEPS());
+    double* timeSteps =
+      outInfo->Get(vtkStreamingDemandDrivenPipeline::TIME_STEPS());
+    if (numberOfTimeSteps != numberOfFiles || !timeSteps)
+      {
+      std::cerr << "Error: " << numberOfTimeSteps << " time steps with "
+                << numbersOfThreads[t] << " thread(s), expected "
+                << numberOfFiles << "." << std::endl;
+      return EXIT_FAILURE;
+      }
+    std::vector<double> scannedTimeSteps(timeSteps,
+                                         timeSteps + numberOfTimeSteps);
+    if (t == 0)
+      {
+      expectedTimeSteps = scannedTimeSteps;
+      }
+    else if (scannedTimeSteps != expectedTimeSteps)
+      {
+      std::cerr << "Error: time steps scanned with " << numbersOfThreads[t]
+                << " threads differ from the serial scan." << std::endl;
+      return EXIT_FAILURE;
+      }
+    }
+
+  return EXIT_SUCCESS;
+}
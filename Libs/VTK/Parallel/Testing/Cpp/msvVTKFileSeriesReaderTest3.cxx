@@ -0,0 +1,300 @@
+/*==============================================================================
+
+  Library: MSVTK
+
+  Copyright (c) Kitware Inc.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0.txt
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// MSVTK
+#include "msvVTKDataFileSeriesReader.h"
+
+// VTK includes
+#include "vtkExecutive.h"
+#include "vtkInformation.h"
+#include "vtkInformationVector.h"
+#include "vtkNew.h"
+#include "vtkObjectFactory.h"
+#include "vtkPolyData.h"
+#include "vtkPolyDataReader.h"
+#include "vtkPolyDataWriter.h"
+#include "vtkSphereSource.h"
+#include "vtkStreamingDemandDrivenPipeline.h"
+#include "vtkTemporalDataSet.h"
+
+// STD includes
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// -----------------------------------------------------------------------------
+// Polydata reader reporting the time step written in the file header and
+// counting the files it is queried for.
+class msvVTKHeaderTimePolyDataReader : public vtkPolyDataReader
+{
+public:
+  static msvVTKHeaderTimePolyDataReader* New();
+  vtkTypeMacro(msvVTKHeaderTimePolyDataReader, vtkPolyDataReader);
+
+  vtkGetMacro(NumberOfQueries, int);
+
+protected:
+  msvVTKHeaderTimePolyDataReader() : NumberOfQueries(0) {}
+
+  virtual int RequestInformation(vtkInformation* request,
+                                 vtkInformationVector** inputVector,
+                                 vtkInformationVector* outputVector)
+  {
+    if (!this->Superclass::RequestInformation(request, inputVector,
+                                              outputVector))
+      {
+      return 0;
+      }
+    if (!this->OpenVTKFile() || !this->ReadHeader())
+      {
+      this->CloseVTKFile();
+      return 0;
+      }
+    this->CloseVTKFile();
+    ++this->NumberOfQueries;
+    double time = atof(this->GetHeader());
+    double timeRange[2] = {time, time};
+    vtkInformation* outInfo = outputVector->GetInformationObject(0);
+    outInfo->Set(vtkStreamingDemandDrivenPipeline::TIME_STEPS(), &time, 1);
+    outInfo->Set(vtkStreamingDemandDrivenPipeline::TIME_RANGE(), timeRange, 2);
+    return 1;
+  }
+
+  int NumberOfQueries;
+
+private:
+  msvVTKHeaderTimePolyDataReader(const msvVTKHeaderTimePolyDataReader&);
+  void operator=(const msvVTKHeaderTimePolyDataReader&);
+};
+
+vtkStandardNewMacro(msvVTKHeaderTimePolyDataReader);
+
+namespace
+{
+//------------------------------------------------------------------------------
+// Write the index-th polydata file of a series in the current directory, its
+// time step being the header of the file. Return the file name.
+std::string WriteFile(const char* prefix, int index, double time)
+{
+  std::stringstream fileName;
+  fileName << prefix << "_" << index << ".vtk";
+  std::stringstream header;
+  header << time;
+  vtkNew<vtkSphereSource> sphere;
+  sphere->SetThetaResolution(4 + index);
+  vtkNew<vtkPolyDataWriter> writer;
+  writer->SetInputConnection(sphere->GetOutputPort());
+  writer->SetFileName(fileName.str().c_str());
+  writer->SetHeader(header.str().c_str());
+  writer->Write();
+  return fileName.str();
+}
+
+//------------------------------------------------------------------------------
+std::vector<std::string> WriteSeries(const char* prefix,
+                                     const double times[], int numberOfFiles)
+{
+  std::vector<std::string> fileNames;
+  for (int i = 0; i < numberOfFiles; ++i)
+    {
+    fileNames.push_back(WriteFile(prefix, i, times[i]));
+    }
+  return fileNames;
+}
+
+//------------------------------------------------------------------------------
+bool CheckTimeSteps(msvVTKDataFileSeriesReader* reader,
+                    const double expectedTimeSteps[], int numberOfTimeSteps)
+{
+  vtkInformation* outInfo = reader->GetExecutive()->GetOutputInformation(0);
+  double* timeSteps =
+    outInfo->Get(vtkStreamingDemandDrivenPipeline::TIME_STEPS());
+  if (outInfo->Length(vtkStreamingDemandDrivenPipeline::TIME_STEPS()) !=
+      numberOfTimeSteps || !timeSteps)
+    {
+    std::cerr << "Wrong number of time steps" << std::endl;
+    return false;
+    }
+  for (int i = 0; i < numberOfTimeSteps; ++i)
+    {
+    if (timeSteps[i] != expectedTimeSteps[i])
+      {
+      std::cerr << "Time step " << i << " is " << timeSteps[i]
+                << ", expected " << expectedTimeSteps[i] << std::endl;
+      return false;
+      }
+    }
+  return true;
+}
+}
+
+// -----------------------------------------------------------------------------
+int msvVTKFileSeriesReaderTest3(int vtkNotUsed(argc),
+                                char* vtkNotUsed(argv)[])
+{
+  const int numberOfFiles = 5;
+  // The files in between are not evenly spaced in time.
+  const double times[numberOfFiles] = {0., 1., 2., 3., 16.};
+  std::vector<std::string> files =
+    WriteSeries("msvVTKFileSeriesReaderTest3", times, numberOfFiles);
+
+  // Lazy time discovery: only the first and the last files are queried, the
+  // others are assumed evenly spaced.
+  vtkNew<msvVTKHeaderTimePolyDataReader> polyDataReader;
+  vtkNew<msvVTKDataFileSeriesReader> fileSeriesReader;
+  fileSeriesReader->SetReader(polyDataReader.GetPointer());
+  for (int i = 0; i < numberOfFiles; ++i)
+    {
+    fileSeriesReader->AddFileName(files[i].c_str());
+    }
+  fileSeriesReader->LazyTimeDiscoveryOn();
+  fileSeriesReader->UpdateInformation();
+  const double assumedTimeSteps[numberOfFiles] = {0., 4., 8., 12., 16.};
+  if (polyDataReader->GetNumberOfQueries() != 2 ||
+      !CheckTimeSteps(fileSeriesReader.GetPointer(), assumedTimeSteps,
+                      numberOfFiles))
+    {
+    std::cerr << "Error: wrong lazy time discovery" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // Requesting an assumed time step validates the files around it until the
+  // file actually holding it is found, and corrects the published time steps
+  // without modifying the reader. The time 8 is assumed in the third file
+  // but is held by the fourth one, assumed at 12.
+  unsigned long mtime = fileSeriesReader->GetMTime();
+  vtkStreamingDemandDrivenPipeline* executive =
+    vtkStreamingDemandDrivenPipeline::SafeDownCast(
+      fileSeriesReader->GetExecutive());
+  executive->SetUpdateTimeStep(0, 8.);
+  fileSeriesReader->Update();
+  if (!CheckTimeSteps(fileSeriesReader.GetPointer(), times, numberOfFiles))
+    {
+    std::cerr << "Error: wrong time steps after validation" << std::endl;
+    return EXIT_FAILURE;
+    }
+  vtkNew<vtkPolyDataReader> expectedReader;
+  expectedReader->SetFileName(files[3].c_str());
+  expectedReader->Update();
+  vtkPolyData* output =
+    vtkPolyData::SafeDownCast(fileSeriesReader->GetOutputDataObject(0));
+  if (!output || output->GetNumberOfPoints() !=
+        expectedReader->GetOutput()->GetNumberOfPoints())
+    {
+    std::cerr << "Error: the requested time was read from the wrong file"
+              << std::endl;
+    return EXIT_FAILURE;
+    }
+  if (fileSeriesReader->GetMTime() != mtime)
+    {
+    std::cerr << "Error: the validation modified the reader" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // Time index round trip: the indexed files are not queried again, but
+  // the first one.
+  const char* indexFileName = "msvVTKFileSeriesReaderTest3.idx";
+  if (!fileSeriesReader->WriteTimeIndex(indexFileName))
+    {
+    std::cerr << "Error: the time index could not be written" << std::endl;
+    return EXIT_FAILURE;
+    }
+  vtkNew<msvVTKHeaderTimePolyDataReader> indexedPolyDataReader;
+  vtkNew<msvVTKDataFileSeriesReader> indexedReader;
+  indexedReader->SetReader(indexedPolyDataReader.GetPointer());
+  for (int i = 0; i < numberOfFiles; ++i)
+    {
+    indexedReader->AddFileName(files[i].c_str());
+    }
+  indexedReader->SetTimeIndexFileName(indexFileName);
+  indexedReader->UpdateInformation();
+  if (indexedPolyDataReader->GetNumberOfQueries() != 1 ||
+      !CheckTimeSteps(indexedReader.GetPointer(), times, numberOfFiles))
+    {
+    std::cerr << "Error: wrong time steps read from the index" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // A file rewritten since the index was written is queried again.
+  WriteFile("msvVTKFileSeriesReaderTest3", 3, 5.5);
+  vtkNew<msvVTKHeaderTimePolyDataReader> stalePolyDataReader;
+  vtkNew<msvVTKDataFileSeriesReader> staleReader;
+  staleReader->SetReader(stalePolyDataReader.GetPointer());
+  for (int i = 0; i < numberOfFiles; ++i)
+    {
+    staleReader->AddFileName(files[i].c_str());
+    }
+  staleReader->SetTimeIndexFileName(indexFileName);
+  staleReader->UpdateInformation();
+  const double staleTimeSteps[numberOfFiles] = {0., 1., 2., 5.5, 16.};
+  if (stalePolyDataReader->GetNumberOfQueries() != 2 ||
+      !CheckTimeSteps(staleReader.GetPointer(), staleTimeSteps,
+                      numberOfFiles))
+    {
+    std::cerr << "Error: wrong time steps with a stale index" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // Time steps spanning several files are read at once into the temporal
+  // output.
+  vtkNew<msvVTKHeaderTimePolyDataReader> temporalPolyDataReader;
+  vtkNew<msvVTKDataFileSeriesReader> temporalReader;
+  temporalReader->SetReader(temporalPolyDataReader.GetPointer());
+  for (int i = 0; i < numberOfFiles; ++i)
+    {
+    temporalReader->AddFileName(files[i].c_str());
+    }
+  temporalReader->TemporalOutputOn();
+  temporalReader->UpdateInformation();
+  const int numberOfRequestedSteps = 3;
+  double requestedSteps[numberOfRequestedSteps] = {1., 5.5, 16.};
+  const int requestedFiles[numberOfRequestedSteps] = {1, 3, 4};
+  vtkStreamingDemandDrivenPipeline::SafeDownCast(
+    temporalReader->GetExecutive())->SetUpdateTimeSteps(
+      0, requestedSteps, numberOfRequestedSteps);
+  temporalReader->Update();
+  vtkTemporalDataSet* temporalOutput =
+    vtkTemporalDataSet::SafeDownCast(temporalReader->GetOutputDataObject(0));
+  if (!temporalOutput ||
+      temporalOutput->GetNumberOfTimeSteps() != numberOfRequestedSteps)
+    {
+    std::cerr << "Error: wrong temporal output" << std::endl;
+    return EXIT_FAILURE;
+    }
+  for (int i = 0; i < numberOfRequestedSteps; ++i)
+    {
+    vtkNew<vtkPolyDataReader> referenceReader;
+    referenceReader->SetFileName(files[requestedFiles[i]].c_str());
+    referenceReader->Update();
+    vtkPolyData* timeStep =
+      vtkPolyData::SafeDownCast(temporalOutput->GetTimeStep(i));
+    if (!timeStep || timeStep->GetNumberOfPoints() !=
+          referenceReader->GetOutput()->GetNumberOfPoints())
+      {
+      std::cerr << "Error: wrong time step " << requestedSteps[i]
+                << " in the temporal output" << std::endl;
+      return EXIT_FAILURE;
+      }
+    }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,227 @@
+/*==============================================================================
+
+  Library: MSVTK
+
+  Copyright (c) Kitware Inc.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0.txt
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// MSVTK
+#include "msvVTKScreenSpaceLODController.h"
+#include "msvVTKXMLMultiblockLODReader.h"
+
+// VTK includes
+#include "vtkCamera.h"
+#include "vtkCommand.h"
+#include "vtkNew.h"
+#include "vtkPolyData.h"
+#include "vtkRenderer.h"
+#include "vtkRenderWindow.h"
+#include "vtkSphereSource.h"
+#include "vtkXMLPolyDataWriter.h"
+
+// STD includes
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+namespace
+{
+const int NumberOfPieces = 3;
+const int NumberOfLODs = 3;
+
+//------------------------------------------------------------------------------
+// Write NumberOfPieces spheres along the x axis with NumberOfLODs
+// resolutions each, and the multiblock file referencing them, with the
+// statistics of the LODs if withStatistics is true. Return the number of
+// cells of each LOD in numberOfCells.
+std::string WriteLODFile(bool withStatistics, vtkIdType numberOfCells[])
+{
+  const std::string fileName = withStatistics ?
+    "msvVTKScreenSpaceLODControllerTest1.vtm" :
+    "msvVTKScreenSpaceLODControllerTest1NoStatistics.vtm";
+  std::ofstream file(fileName.c_str());
+  file << "<?xml version=\"1.0\"?>\n"
+       << "<VTKFile type=\"vtkMultiBlockDataSet\" version=\"1.0\">\n"
+       << "  <vtkMultiBlockDataSet>\n";
+  for (int piece = 0; piece < NumberOfPieces; ++piece)
+    {
+    file << "    <Block index=\"" << piece << "\" name=\"piece"
+         << piece << "\">\n";
+    for (int lod = 0; lod < NumberOfLODs; ++lod)
+      {
+      std::stringstream lodFileName;
+      lodFileName << "msvVTKScreenSpaceLODControllerTest1_"
+                  << piece << "_" << lod << ".vtp";
+      vtkNew<vtkSphereSource> sphere;
+      sphere->SetCenter(piece, 0., 0.);
+      sphere->SetThetaResolution(4 << lod);
+      sphere->SetPhiResolution(4 << lod);
+      sphere->Update();
+      vtkNew<vtkXMLPolyDataWriter> writer;
+      writer->SetInputConnection(sphere->GetOutputPort());
+      writer->SetFileName(lodFileName.str().c_str());
+      writer->Write();
+      numberOfCells[lod] = sphere->GetOutput()->GetNumberOfCells();
+      file << "      <DataSet index=\"" << lod << "\" file=\""
+           << lodFileName.str() << "\"";
+      if (withStatistics)
+        {
+        double* bounds = sphere->GetOutput()->GetBounds();
+        file << " number_of_cells=\"" << numberOfCells[lod] << "\""
+             << " bounds=\"" << bounds[0] << " " << bounds[1] << " "
+             << bounds[2] << " " << bounds[3] << " "
+             << bounds[4] << " " << bounds[5] << "\"";
+        }
+      file << "/>\n";
+      }
+    file << "    </Block>\n";
+    }
+  file << "  </vtkMultiBlockDataSet>\n"
+       << "</VTKFile>\n";
+  return fileName;
+}
+
+//------------------------------------------------------------------------------
+bool CheckLODs(msvVTKXMLMultiblockLODReader* reader, const int expectedLODs[])
+{
+  for (int piece = 0; piece < NumberOfPieces; ++piece)
+    {
+    if (reader->GetPieceLOD(piece) != expectedLODs[piece])
+      {
+      std::cerr << "Piece " << piece << " has LOD "
+                << reader->GetPieceLOD(piece) << ", expected LOD "
+                << expectedLODs[piece] << std::endl;
+      return false;
+      }
+    }
+  return true;
+}
+}
+
+// -----------------------------------------------------------------------------
+int msvVTKScreenSpaceLODControllerTest1(int vtkNotUsed(argc),
+                                        char* vtkNotUsed(argv)[])
+{
+  vtkIdType numberOfCells[NumberOfLODs];
+
+  // Statistics measured once the LODs are read
+  vtkNew<msvVTKXMLMultiblockLODReader> measuredReader;
+  measuredReader->SetFileName(WriteLODFile(false, numberOfCells).c_str());
+  measuredReader->Update();
+  double bounds[6];
+  if (measuredReader->GetPieceLODStatistics(0, 0, bounds) !=
+        numberOfCells[0] ||
+      bounds[0] != -0.5 || bounds[1] != 0.5 ||
+      measuredReader->GetPieceLODStatistics(0, 1, bounds) != -1 ||
+      bounds[0] <= bounds[1])
+    {
+    std::cerr << "Wrong measured statistics" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // Statistics given by the file
+  vtkNew<msvVTKXMLMultiblockLODReader> reader;
+  reader->SetFileName(WriteLODFile(true, numberOfCells).c_str());
+  reader->Update();
+  if (reader->GetPieceLODStatistics(1, 2, bounds) != numberOfCells[2] ||
+      bounds[0] != 0.5 || bounds[1] != 1.5)
+    {
+    std::cerr << "Wrong file statistics" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // The render window is never rendered, only its size is used.
+  vtkNew<vtkRenderWindow> renderWindow;
+  renderWindow->SetSize(400, 400);
+  vtkNew<vtkRenderer> renderer;
+  renderWindow->AddRenderer(renderer.GetPointer());
+  vtkCamera* camera = renderer->GetActiveCamera();
+  camera->SetFocalPoint(0., 0., 0.);
+  camera->SetViewUp(0., 0., 1.);
+  camera->SetPosition(-3., 0., 0.);
+  camera->SetClippingRange(0.1, 1000.);
+
+  vtkNew<msvVTKScreenSpaceLODController> controller;
+  controller->SetReader(reader.GetPointer());
+  controller->SetRenderer(renderer.GetPointer());
+
+  // Close to the camera, all the pieces need their finest LOD.
+  int lods[NumberOfPieces] = {2, 2, 2};
+  if (controller->Update() != NumberOfPieces ||
+      !CheckLODs(reader.GetPointer(), lods) ||
+      controller->GetNumberOfSelectedCells() !=
+        NumberOfPieces * numberOfCells[2])
+    {
+    std::cerr << "Wrong LODs close to the camera" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // Within a budget, the LODs with the smallest errors are lowered first.
+  controller->SetCellBudget(NumberOfPieces * numberOfCells[1]);
+  controller->Update();
+  lods[0] = lods[1] = lods[2] = 1;
+  if (!CheckLODs(reader.GetPointer(), lods) ||
+      controller->GetNumberOfSelectedCells() > controller->GetCellBudget())
+    {
+    std::cerr << "Wrong LODs within the budget" << std::endl;
+    return EXIT_FAILURE;
+    }
+  controller->SetCellBudget(0);
+
+  // Far from the camera, the coarsest LOD is enough. Moving the camera does
+  // nothing until the end of the interaction.
+  vtkNew<vtkObject> interactionSource;
+  controller->SetEventSource(interactionSource.GetPointer());
+  camera->SetPosition(-500., 0., 0.);
+  if (reader->GetPieceLOD(0) != 1)
+    {
+    std::cerr << "LOD changed before the end of the interaction" << std::endl;
+    return EXIT_FAILURE;
+    }
+  interactionSource->InvokeEvent(vtkCommand::EndInteractionEvent);
+  lods[0] = lods[1] = lods[2] = 0;
+  if (!CheckLODs(reader.GetPointer(), lods))
+    {
+    std::cerr << "Wrong LODs far from the camera" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // Out of the view frustum, the coarsest LOD too.
+  camera->SetPosition(-3., 0., 0.);
+  controller->Update();
+  camera->SetFocalPoint(-3., 10., 0.);
+  controller->Update();
+  if (!CheckLODs(reader.GetPointer(), lods))
+    {
+    std::cerr << "Wrong LODs out of the frustum" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // Hidden pieces are left untouched.
+  reader->SetPieceVisibility(2, false);
+  camera->SetFocalPoint(0., 0., 0.);
+  controller->Update();
+  lods[0] = lods[1] = 2;
+  lods[2] = -1;
+  if (!CheckLODs(reader.GetPointer(), lods))
+    {
+    std::cerr << "Wrong LODs with a hidden piece" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,124 @@
+/*==============================================================================
+
+  Library: MSVTK
+
+  Copyright (c) Kitware Inc.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0.txt
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// MSVTK
+#include "msvVTKDataFileSeriesReader.h"
+#include "msvVTKTemporalDataSetCache.h"
+
+// VTK includes
+#include "vtkNew.h"
+#include "vtkPolyData.h"
+#include "vtkPolyDataReader.h"
+#include "vtkStreamingDemandDrivenPipeline.h"
+#include "vtkTemporalDataSet.h"
+#include "vtkTestUtilities.h"
+
+// STD includes
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+
+// -----------------------------------------------------------------------------
+// Play a series forward through a cache holding about 3 time steps, then
+// step back and check that the pinned neighbour is served from the cache.
+int msvVTKTemporalDataSetCacheTest1(int argc, char* argv[])
+{
+  const char* file0 =
+    vtkTestUtilities::ExpandDataFileName(argc,argv,"Polydata00.vtk");
+  const char* file1 =
+    vtkTestUtilities::ExpandDataFileName(argc,argv,"Polydata01.vtk");
+  const int numberOfFiles = 6;
+
+  unsigned long stepSize = 0;
+  const char* files[] = {file0, file1};
+  for (int i = 0; i < 2; ++i)
+    {
+    vtkNew<vtkPolyDataReader> referenceReader;
+    referenceReader->SetFileName(files[i]);
+    referenceReader->Update();
+    stepSize = std::max(stepSize,
+                        referenceReader->GetOutput()->GetActualMemorySize());
+    }
+
+  vtkNew<vtkPolyDataReader> polyDataReader;
+  vtkNew<msvVTKDataFileSeriesReader> fileSeriesReader;
+  fileSeriesReader->SetReader(polyDataReader.GetPointer());
+  for (int i = 0; i < numberOfFiles; ++i)
+    {
+    fileSeriesReader->AddFileName(files[i % 2]);
+    }
+
+  vtkNew<msvVTKTemporalDataSetCache> cache;
+  cache->SetInputConnection(fileSeriesReader->GetOutputPort());
+  cache->SetMemoryBudget(3 * stepSize);
+  cache->SetNumberOfPinnedNeighbors(1);
+  cache->UpdateInformation();
+
+  vtkStreamingDemandDrivenPipeline* executive =
+    vtkStreamingDemandDrivenPipeline::SafeDownCast(cache->GetExecutive());
+  for (int step = 0; step < numberOfFiles; ++step)
+    {
+    executive->SetUpdateTimeStep(0, static_cast<double>(step));
+    cache->Update();
+    vtkTemporalDataSet* output =
+      vtkTemporalDataSet::SafeDownCast(cache->GetOutputDataObject(0));
+    if (!output || output->GetNumberOfTimeSteps() != 1 ||
+        !vtkPolyData::SafeDownCast(output->GetTimeStep(0)))
+      {
+      std::cerr << "Error: wrong output for time step " << step << std::endl;
+      return EXIT_FAILURE;
+      }
+    }
+
+  if (cache->GetCacheMisses() != numberOfFiles || cache->GetCacheHits() != 0)
+    {
+    std::cerr << "Error: every time step must be read once, got "
+              << cache->GetCacheMisses() << " misses and "
+              << cache->GetCacheHits() << " hits." << std::endl;
+    return EXIT_FAILURE;
+    }
+  if (cache->GetCacheEvictions() == 0 ||
+      cache->GetCacheMemorySize() > cache->GetMemoryBudget())
+    {
+    std::cerr << "Error: the cache is over budget: "
+              << cache->GetCacheMemorySize() << " KiB for "
+              << cache->GetMemoryBudget() << " KiB." << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  executive->SetUpdateTimeStep(0, static_cast<double>(numberOfFiles - 2));
+  cache->Update();
+  if (cache->GetCacheHits() != 1)
+    {
+    std::cerr << "Error: the pinned neighbour was evicted." << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  cache->ResetCacheStatistics();
+  if (cache->GetCacheHits() != 0 || cache->GetCacheMisses() != 0 ||
+      cache->GetCacheEvictions() != 0)
+    {
+    std::cerr << "Error: cache statistics not reset." << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  cache->Print(std::cout);
+  return EXIT_SUCCESS;
+}
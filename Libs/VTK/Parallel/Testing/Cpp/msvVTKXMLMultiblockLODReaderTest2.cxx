@@ -0,0 +1,311 @@
+/*==============================================================================
+
+  Library: MSVTK
+
+  Copyright (c) Kitware Inc.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0.txt
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// MSVTK
+#include "msvVTKXMLMultiblockLODReader.h"
+
+// VTK includes
+#include "vtkInformation.h"
+#include "vtkMultiBlockDataSet.h"
+#include "vtkNew.h"
+#include "vtkPolyData.h"
+#include "vtkSphereSource.h"
+#include "vtkXMLPolyDataWriter.h"
+
+// STD includes
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+namespace
+{
+const int NumberOfPieces = 3;
+const int NumberOfLODs = 3;
+
+//------------------------------------------------------------------------------
+// Write NumberOfPieces spheres with NumberOfLODs resolutions each, and the
+// multiblock file referencing them, in the current directory.
+std::string WriteLODFile()
+{
+  const std::string fileName = "msvVTKXMLMultiblockLODReaderTest2.vtm";
+  std::ofstream file(fileName.c_str());
+  file << "<?xml version=\"1.0\"?>\n"
+       << "<VTKFile type=\"vtkMultiBlockDataSet\" version=\"1.0\">\n"
+       << "  <vtkMultiBlockDataSet>\n";
+  for (int piece = 0; piece < NumberOfPieces; ++piece)
+    {
+    file << "    <Block index=\"" << piece << "\" name=\"piece"
+         << piece << "\">\n";
+    for (int lod = 0; lod < NumberOfLODs; ++lod)
+      {
+      std::stringstream lodFileName;
+      lodFileName << "msvVTKXMLMultiblockLODReaderTest2_"
+                  << piece << "_" << lod << ".vtp";
+      vtkNew<vtkSphereSource> sphere;
+      sphere->SetCenter(piece, 0., 0.);
+      sphere->SetThetaResolution(4 << lod);
+      sphere->SetPhiResolution(4 << lod);
+      vtkNew<vtkXMLPolyDataWriter> writer;
+      writer->SetInputConnection(sphere->GetOutputPort());
+      writer->SetFileName(lodFileName.str().c_str());
+      writer->Write();
+      file << "      <DataSet index=\"" << lod << "\" file=\""
+           << lodFileName.str() << "\"/>\n";
+      }
+    file << "    </Block>\n";
+    }
+  file << "  </vtkMultiBlockDataSet>\n"
+       << "</VTKFile>\n";
+  return fileName;
+}
+
+//------------------------------------------------------------------------------
+// Check that the output has a named block per piece, with a block per LOD
+// only holding the LOD expected for the piece, -1 meaning that the piece is
+// hidden.
+bool CheckLODs(vtkMultiBlockDataSet* output, const int expectedLODs[])
+{
+  if (output->GetNumberOfBlocks() != NumberOfPieces)
+    {
+    std::cerr << "Output has " << output->GetNumberOfBlocks()
+              << " blocks, expected " << NumberOfPieces << std::endl;
+    return false;
+    }
+  for (int piece = 0; piece < NumberOfPieces; ++piece)
+    {
+    vtkMultiBlockDataSet* block =
+      vtkMultiBlockDataSet::SafeDownCast(output->GetBlock(piece));
+    if (!block || block->GetNumberOfBlocks() != NumberOfLODs)
+      {
+      std::cerr << "Missing block for piece " << piece << std::endl;
+      return false;
+      }
+    std::stringstream name;
+    name << "piece" << piece;
+    const char* blockName = output->HasMetaData(piece) ?
+      output->GetMetaData(piece)->Get(vtkCompositeDataSet::NAME()) : 0;
+    if (!blockName || name.str() != blockName)
+      {
+      std::cerr << "Wrong name for the block of piece " << piece << std::endl;
+      return false;
+      }
+    for (int lod = 0; lod < NumberOfLODs; ++lod)
+      {
+      bool loaded = block->GetBlock(lod) != 0;
+      if (loaded != (lod == expectedLODs[piece]))
+        {
+        std::cerr << "Piece " << piece << " LOD " << lod << " is "
+                  << (loaded ? "loaded" : "not loaded") << ", expected LOD "
+                  << expectedLODs[piece] << std::endl;
+        return false;
+        }
+      }
+    }
+  return true;
+}
+}
+
+// -----------------------------------------------------------------------------
+int msvVTKXMLMultiblockLODReaderTest2(int vtkNotUsed(argc),
+                                      char* vtkNotUsed(argv)[])
+{
+  std::string fileName = WriteLODFile();
+
+  vtkNew<msvVTKXMLMultiblockLODReader> reader;
+  reader->SetFileName(fileName.c_str());
+  reader->Update();
+  vtkMultiBlockDataSet* output =
+    vtkMultiBlockDataSet::SafeDownCast(reader->GetOutputDataObject(0));
+
+  int lods[NumberOfPieces] = {0, 0, 0};
+  if (!CheckLODs(output, lods))
+    {
+    std::cerr << "Wrong LODs by default" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  if (reader->GetNumberOfDataSetReads() != NumberOfPieces)
+    {
+    std::cerr << "Wrong number of reads: "
+              << reader->GetNumberOfDataSetReads() << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // Change one piece: only its new LOD is read, the other leaves are kept.
+  vtkDataObject* piece0 =
+    vtkMultiBlockDataSet::SafeDownCast(output->GetBlock(0))->GetBlock(0);
+  reader->SetPieceLOD(1, 2);
+  reader->Update();
+  lods[1] = 2;
+  if (!CheckLODs(output, lods) || reader->GetPieceLOD(1) != 2)
+    {
+    std::cerr << "SetPieceLOD failed" << std::endl;
+    return EXIT_FAILURE;
+    }
+  if (reader->GetNumberOfDataSetReads() != NumberOfPieces + 1 ||
+      vtkMultiBlockDataSet::SafeDownCast(
+        output->GetBlock(0))->GetBlock(0) != piece0)
+    {
+    std::cerr << "SetPieceLOD read unchanged pieces: "
+              << reader->GetNumberOfDataSetReads() << " reads" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // A second update in place keeps the blocks of the pieces in the output.
+  vtkDataObject* block1 = output->GetBlock(1);
+  reader->SetPieceLOD(2, 1);
+  reader->Update();
+  lods[2] = 1;
+  if (!CheckLODs(output, lods) || output->GetBlock(1) != block1 ||
+      reader->GetNumberOfDataSetReads() != NumberOfPieces + 2)
+    {
+    std::cerr << "Second SetPieceLOD failed" << std::endl;
+    return EXIT_FAILURE;
+    }
+  reader->SetPieceLOD(2, 0);
+  reader->Update();
+  lods[2] = 0;
+
+  // Change several pieces at once, clamping to the available LODs
+  int pieces[2] = {0, 2};
+  unsigned int newLODs[2] = {1, 5};
+  unsigned long mtime = reader->GetMTime();
+  reader->SetPieceLODs(2, pieces, newLODs);
+  reader->Update();
+  lods[0] = 1;
+  lods[2] = NumberOfLODs - 1;
+  if (!CheckLODs(output, lods) || reader->GetMTime() == mtime)
+    {
+    std::cerr << "SetPieceLODs failed" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // Setting the same LODs again doesn't modify the reader
+  mtime = reader->GetMTime();
+  reader->SetPieceLODs(2, pieces, newLODs);
+  if (reader->GetMTime() != mtime)
+    {
+    std::cerr << "SetPieceLODs modified the reader without changes"
+              << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // Hide and show a piece
+  reader->SetPieceVisibility(1, false);
+  reader->Update();
+  lods[1] = -1;
+  if (!CheckLODs(output, lods) || reader->GetPieceLOD(1) != -3)
+    {
+    std::cerr << "SetPieceVisibility(false) failed" << std::endl;
+    return EXIT_FAILURE;
+    }
+  reader->SetPieceVisibility(1, true);
+  reader->Update();
+  lods[1] = 2;
+  if (!CheckLODs(output, lods))
+    {
+    std::cerr << "SetPieceVisibility(true) failed" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // Flat index of the LOD 1 leaf of the last piece: the root, then each
+  // piece block followed by its LOD leaves.
+  vtkIdType compositeIndex = 1 + (NumberOfPieces - 1) * (NumberOfLODs + 1) + 2;
+  if (reader->GetPieceFromCompositeIndex(compositeIndex) != NumberOfPieces - 1)
+    {
+    std::cerr << "GetPieceFromCompositeIndex failed: "
+              << reader->GetPieceFromCompositeIndex(compositeIndex)
+              << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // Back to the default LOD
+  reader->SetDefaultLOD(0);
+  reader->Update();
+  lods[0] = lods[1] = lods[2] = 0;
+  if (!CheckLODs(output, lods))
+    {
+    std::cerr << "SetDefaultLOD failed" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // Flip a piece back and forth: both LODs are still resident.
+  reader->ResetCacheStatistics();
+  int numberOfReads = reader->GetNumberOfDataSetReads();
+  reader->SetPieceLOD(1, 2);
+  reader->Update();
+  reader->SetPieceLOD(1, 0);
+  reader->Update();
+  if (!CheckLODs(output, lods) ||
+      reader->GetNumberOfDataSetReads() != numberOfReads ||
+      reader->GetCacheHits() != 2 || reader->GetCacheMisses() != 0 ||
+      reader->GetNumberOfCachedLeaves() == 0)
+    {
+    std::cerr << "Resident LODs were read again" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // Without memory budget, only the leaves of the output are kept.
+  reader->SetMemoryBudget(0);
+  reader->Update();
+  if (!CheckLODs(output, lods) || reader->GetNumberOfCachedLeaves() != 0 ||
+      reader->GetCacheEvictions() == 0 || reader->GetCacheMemorySize() == 0)
+    {
+    std::cerr << "Resident LODs were not evicted" << std::endl;
+    return EXIT_FAILURE;
+    }
+  reader->SetPieceLOD(1, 2);
+  reader->Update();
+  lods[1] = 2;
+  if (!CheckLODs(output, lods) || reader->GetCacheMisses() != 1 ||
+      reader->GetNumberOfDataSetReads() != numberOfReads + 1)
+    {
+    std::cerr << "Evicted LOD was not read again" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // Read the leaves on several threads
+  vtkNew<msvVTKXMLMultiblockLODReader> threadedReader;
+  threadedReader->SetNumberOfReadThreads(4);
+  threadedReader->SetFileName(fileName.c_str());
+  threadedReader->SetDefaultLOD(2);
+  threadedReader->Update();
+  output = vtkMultiBlockDataSet::SafeDownCast(
+    threadedReader->GetOutputDataObject(0));
+  lods[0] = lods[1] = lods[2] = 2;
+  if (!CheckLODs(output, lods) ||
+      threadedReader->GetNumberOfDataSetReads() != NumberOfPieces)
+    {
+    std::cerr << "Threaded read failed" << std::endl;
+    return EXIT_FAILURE;
+    }
+  threadedReader->SetPieceLOD(0, 1);
+  threadedReader->Update();
+  lods[0] = 1;
+  if (!CheckLODs(output, lods) ||
+      threadedReader->GetNumberOfDataSetReads() != NumberOfPieces + 1)
+    {
+    std::cerr << "Threaded SetPieceLOD failed" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+}
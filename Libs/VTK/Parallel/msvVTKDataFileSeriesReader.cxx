@@ -133,6 +133,33 @@ void msvVTKDataFileSeriesReader::SetReaderFileName(const char* fname)
   this->SetCurrentFileName(fname);
 }
 
+//------------------------------------------------------------------------------
+vtkAlgorithm* msvVTKDataFileSeriesReader::NewReaderForFile(const char* fname)
+{
+  vtkDataReader* reader = vtkDataReader::SafeDownCast(this->Reader);
+  if (!reader || reader->GetReadFromInputString())
+    {
+    return 0;
+    }
+  vtkDataReader* newReader = vtkDataReader::SafeDownCast(reader->NewInstance());
+  newReader->SetScalarsName(reader->GetScalarsName());
+  newReader->SetVectorsName(reader->GetVectorsName());
+  newReader->SetTensorsName(reader->GetTensorsName());
+  newReader->SetNormalsName(reader->GetNormalsName());
+  newReader->SetTCoordsName(reader->GetTCoordsName());
+  newReader->SetLookupTableName(reader->GetLookupTableName());
+  newReader->SetFieldDataName(reader->GetFieldDataName());
+  newReader->SetReadAllScalars(reader->GetReadAllScalars());
+  newReader->SetReadAllVectors(reader->GetReadAllVectors());
+  newReader->SetReadAllNormals(reader->GetReadAllNormals());
+  newReader->SetReadAllTensors(reader->GetReadAllTensors());
+  newReader->SetReadAllColorScalars(reader->GetReadAllColorScalars());
+  newReader->SetReadAllTCoords(reader->GetReadAllTCoords());
+  newReader->SetReadAllFields(reader->GetReadAllFields());
+  newReader->SetFileName(fname);
+  return newReader;
+}
+
 //------------------------------------------------------------------------------
 void msvVTKDataFileSeriesReader::PrintSelf(ostream &os, vtkIndent indent)
 {
@@ -19,6 +19,12 @@
 
 ==============================================================================*/
 
+// .NAME msvVTKDataFileSeriesReader - file series reader for legacy VTK files
+// .SECTION Description
+// msvVTKDataFileSeriesReader reads a file series with a vtkDataReader.
+// As legacy readers can't read a piece of a file, PieceMode should be set
+// to SPLIT_FILES to distribute partitioned time steps across pieces.
+
 #ifndef __msvVTKDataFileSeriesReader_h
 #define __msvVTKDataFileSeriesReader_h
 
@@ -47,6 +53,7 @@ protected:
   msvVTKDataFileSeriesReader();
   virtual ~msvVTKDataFileSeriesReader();
   virtual void SetReaderFileName(const char* fname);
+  virtual vtkAlgorithm* NewReaderForFile(const char* fname);
 
 private:
   msvVTKDataFileSeriesReader(const msvVTKDataFileSeriesReader&);// Not implemented.
@@ -44,22 +44,52 @@
 
 #include "msvVTKFileSeriesReader.h"
 
+#include "vtkAppendFilter.h"
+#include "vtkAppendPolyData.h"
+#include "vtkConditionVariable.h"
+#include "vtkDataObject.h"
+#include "vtkDataObjectTypes.h"
+#include "vtkExecutive.h"
 #include "vtkGenericDataObjectReader.h"
 #include "vtkInformation.h"
-#include "vtkInformationIntegerKey.h"
+#include "vtkInformationDoubleVectorKey.h"
 #include "vtkInformationVector.h"
 #include "vtkMath.h"
+#include "vtkMultiThreader.h"
+#include "vtkMutexLock.h"
 #include "vtkObjectFactory.h"
+#include "vtkPolyData.h"
 #include "vtkStdString.h"
 #include "vtkStreamingDemandDrivenPipeline.h"
 #include "vtkStringArray.h"
+#include "vtkTemporalDataSet.h"
 #include "vtkTypeTraits.h"
+#include "vtkUnstructuredGrid.h"
+
+#include <vtksys/SystemTools.hxx>
+
+#ifdef _WIN32
+# ifndef NOMINMAX
+#  define NOMINMAX
+# endif
+# include <windows.h>
+#else
+# include <fcntl.h>
+# include <sys/mman.h>
+# include <sys/stat.h>
+# include <unistd.h>
+#endif
 
 #include "vtkSmartPointer.h"
 #define VTK_CREATE(type, name) \
   vtkSmartPointer<type> name = vtkSmartPointer<type>::New()
 
 #include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <list>
 #include <map>
 #include <set>
 #include <string>
@@ -70,6 +100,10 @@ vtkCxxSetObjectMacro(msvVTKFileSeriesReader,Reader,vtkAlgorithm);
 
 //=============================================================================
 // Internal class for holding time ranges.
+// The time information of each input is kept in a flat array indexed by the
+// input index. The inputs in use are sorted by start time into a contiguous
+// table, rebuilt only when the time information changes, so that the time
+// lookups are binary searches. The aggregated time steps are cached as well.
 class msvVTKFileSeriesReaderTimeRanges
 {
 public:
@@ -86,20 +120,65 @@ public:
   int GetIndexForTime(double time);
   std::set<int> ChooseInputs(vtkInformation *outInfo);
   std::vector<double> GetTimesForInput(int inputId, vtkInformation *outInfo);
+  // Return the inputs, in index order, whose time range starts with the one
+  // of the input index.
+  std::vector<int> GetInputsStartingWith(int index);
+  // Return the input serving the times right after the ones of the input
+  // index, i.e. bounding its time range in the table, -1 if none.
+  int GetNextInput(int index);
 
 private:
-  static vtkInformationIntegerKey *INDEX();
-  typedef std::map<double, vtkSmartPointer<vtkInformation> > RangeMapType;
-  RangeMapType RangeMap;
+  struct InputTimeInfo
+  {
+    InputTimeInfo() : Known(false), HasTimeRange(false), HasTimeSteps(false),
+                      InTable(false), Order(0)
+    {
+      this->TimeRange[0] = this->TimeRange[1] = 0.;
+    }
+    bool Known;
+    bool HasTimeRange;
+    bool HasTimeSteps;
+    // Whether the input takes part in the time table.
+    bool InTable;
+    // Insertion order, an input added later replaces the inputs starting at
+    // the same time.
+    unsigned long Order;
+    double TimeRange[2];
+    std::vector<double> TimeSteps;
+  };
+
+  struct TableEntry
+  {
+    double StartTime;
+    // Start time of the next entry, times in [StartTime, EndTime[ are
+    // served by this entry.
+    double EndTime;
+    int Index;
+  };
+
+  static bool EntryLess(const TableEntry& a, const TableEntry& b)
+  {
+    return a.StartTime < b.StartTime;
+  }
+
+  void UpdateTable();
+  const TableEntry* FindEntry(double time);
+
+  std::vector<InputTimeInfo> Inputs;
+  unsigned long InsertionCount;
+  bool TableModified;
+  std::vector<TableEntry> Table;
+  // All the inputs in use sorted by start time then index.
+  std::vector<std::pair<double, int> > InputsByStartTime;
+  std::vector<double> AggregateTimeSteps;
   double outputTimeRange[2];
-  std::map<int, vtkSmartPointer<vtkInformation> > InputLookup;
 };
 
-vtkInformationKeyMacro(msvVTKFileSeriesReaderTimeRanges, INDEX, Integer);
-
 //-----------------------------------------------------------------------------
 msvVTKFileSeriesReaderTimeRanges::msvVTKFileSeriesReaderTimeRanges()
 {
+  this->InsertionCount = 0;
+  this->TableModified = false;
   this->outputTimeRange[0] = 0.;
   this->outputTimeRange[1] = -1.;
 }
@@ -107,77 +186,103 @@ msvVTKFileSeriesReaderTimeRanges::msvVTKFileSeriesReaderTimeRanges()
 //-----------------------------------------------------------------------------
 void msvVTKFileSeriesReaderTimeRanges::Reset()
 {
+  this->Inputs.clear();
+  this->InsertionCount = 0;
   this->ResetRangeMap();
-  this->InputLookup.clear();
 }
 
 //-----------------------------------------------------------------------------
 void msvVTKFileSeriesReaderTimeRanges::AddTimeRange(int index,
                                                  vtkInformation *srcInfo)
 {
-  VTK_CREATE(vtkInformation, info);
-  info->Set(msvVTKFileSeriesReaderTimeRanges::INDEX(), index);
-
-  this->InputLookup[index] = info;
+  if (index < 0)
+    {
+    return;
+    }
+  if (index >= static_cast<int>(this->Inputs.size()))
+    {
+    this->Inputs.resize(index + 1);
+    }
+  // Replacing the time information of an input also removes its previous
+  // range from the table.
+  InputTimeInfo& input = this->Inputs[index];
+  input = InputTimeInfo();
+  input.Known = true;
+  this->TableModified = true;
 
   if (srcInfo->Has(vtkStreamingDemandDrivenPipeline::TIME_STEPS()))
     {
-    info->CopyEntry(srcInfo, vtkStreamingDemandDrivenPipeline::TIME_STEPS());
+    double *timeSteps
+      = srcInfo->Get(vtkStreamingDemandDrivenPipeline::TIME_STEPS());
+    int numTimeSteps
+      = srcInfo->Length(vtkStreamingDemandDrivenPipeline::TIME_STEPS());
+    input.HasTimeSteps = true;
+    input.TimeSteps.assign(timeSteps, timeSteps + numTimeSteps);
     if (srcInfo->Has(vtkStreamingDemandDrivenPipeline::TIME_RANGE()))
       {
-      info->CopyEntry(srcInfo, vtkStreamingDemandDrivenPipeline::TIME_RANGE());
+      double *timeRange
+        = srcInfo->Get(vtkStreamingDemandDrivenPipeline::TIME_RANGE());
+      input.TimeRange[0] = timeRange[0];
+      input.TimeRange[1] = timeRange[1];
+      input.HasTimeRange = true;
       }
-    else
+    else if (numTimeSteps > 0)
       {
-      double *timeSteps
-        = info->Get(vtkStreamingDemandDrivenPipeline::TIME_STEPS());
-      int numTimeSteps
-        = info->Length(vtkStreamingDemandDrivenPipeline::TIME_STEPS());
-      double timeRange[2];
-      timeRange[0] = timeSteps[0];
-      timeRange[1] = timeSteps[numTimeSteps-1];
-      info->Set(vtkStreamingDemandDrivenPipeline::TIME_RANGE(), timeRange, 2);
+      input.TimeRange[0] = timeSteps[0];
+      input.TimeRange[1] = timeSteps[numTimeSteps-1];
+      input.HasTimeRange = true;
       }
     }
   else if (srcInfo->Has(vtkStreamingDemandDrivenPipeline::TIME_RANGE()))
     {
-    info->CopyEntry(srcInfo, vtkStreamingDemandDrivenPipeline::TIME_RANGE());
+    double *timeRange
+      = srcInfo->Get(vtkStreamingDemandDrivenPipeline::TIME_RANGE());
+    input.TimeRange[0] = timeRange[0];
+    input.TimeRange[1] = timeRange[1];
+    input.HasTimeRange = true;
     }
-  else
+  if (!input.HasTimeRange)
     {
     vtkGenericWarningMacro(<< "Input with index " << index
                            << " has no time information.");
     return;
     }
 
-  this->RangeMap[info->Get(vtkStreamingDemandDrivenPipeline::TIME_RANGE())[0]]
-    = info;
+  input.InTable = true;
+  input.Order = ++this->InsertionCount;
 }
 
 //------------------------------------------------------------------------------
 void msvVTKFileSeriesReaderTimeRanges::SetTimeRange(int index,
                                                     double* range)
 {
-  if (this->InputLookup.empty())
+  if (index < 0 || index >= static_cast<int>(this->Inputs.size()) ||
+      !this->Inputs[index].Known)
     {
     return;
     }
 
-  vtkInformation* info;
-  info = this->InputLookup[index];
-  info->Remove(vtkStreamingDemandDrivenPipeline::TIME_RANGE());
-  info->Set(vtkStreamingDemandDrivenPipeline::TIME_RANGE(), range, 2);
-  this->RangeMap[info->Get(vtkStreamingDemandDrivenPipeline::TIME_RANGE())[0]]
-    = info;
+  InputTimeInfo& input = this->Inputs[index];
+  input.TimeRange[0] = range[0];
+  input.TimeRange[1] = range[1];
+  input.HasTimeRange = true;
+  input.InTable = true;
+  input.Order = ++this->InsertionCount;
+  this->TableModified = true;
 }
 
 //------------------------------------------------------------------------------
 void msvVTKFileSeriesReaderTimeRanges::GetTimeRange(double timeRange[2])
 {
-  timeRange[0] = this->RangeMap.begin()->second
-                       ->Get(vtkStreamingDemandDrivenPipeline::TIME_RANGE())[0];
-  timeRange[1] = (--this->RangeMap.end())->second
-                       ->Get(vtkStreamingDemandDrivenPipeline::TIME_RANGE())[1];
+  this->UpdateTable();
+  if (this->Table.empty())
+    {
+    timeRange[0] = 0.;
+    timeRange[1] = -1.;
+    return;
+    }
+  timeRange[0] = this->Table.front().StartTime;
+  timeRange[1] = this->Inputs[this->Table.back().Index].TimeRange[1];
 }
 
 //------------------------------------------------------------------------------
@@ -197,23 +302,111 @@ void msvVTKFileSeriesReaderTimeRanges::GetOutputTimeRange(double timeRange[2])
 //------------------------------------------------------------------------------
 void msvVTKFileSeriesReaderTimeRanges::ResetRangeMap()
 {
-  this->RangeMap.clear();
+  for (size_t i = 0; i < this->Inputs.size(); ++i)
+    {
+    this->Inputs[i].InTable = false;
+    }
+  this->Table.clear();
+  this->InputsByStartTime.clear();
+  this->AggregateTimeSteps.clear();
+  this->TableModified = false;
+}
+
+//------------------------------------------------------------------------------
+void msvVTKFileSeriesReaderTimeRanges::UpdateTable()
+{
+  if (!this->TableModified)
+    {
+    return;
+    }
+  this->TableModified = false;
+  this->Table.clear();
+  this->InputsByStartTime.clear();
+  this->AggregateTimeSteps.clear();
+
+  // Sort the inputs by start time, the most recently added input wins among
+  // the ones starting at the same time.
+  std::vector<std::pair<double, std::pair<unsigned long, int> > > starts;
+  for (size_t i = 0; i < this->Inputs.size(); ++i)
+    {
+    const InputTimeInfo& input = this->Inputs[i];
+    if (input.InTable)
+      {
+      starts.push_back(std::make_pair(input.TimeRange[0],
+        std::make_pair(input.Order, static_cast<int>(i))));
+      this->InputsByStartTime.push_back(
+        std::make_pair(input.TimeRange[0], static_cast<int>(i)));
+      }
+    }
+  std::sort(starts.begin(), starts.end());
+  std::sort(this->InputsByStartTime.begin(), this->InputsByStartTime.end());
+  for (size_t i = 0; i < starts.size(); ++i)
+    {
+    if (i + 1 < starts.size() && starts[i + 1].first == starts[i].first)
+      {
+      continue;
+      }
+    TableEntry entry;
+    entry.StartTime = starts[i].first;
+    entry.EndTime = vtkTypeTraits<double>::Max();
+    entry.Index = starts[i].second.second;
+    if (!this->Table.empty())
+      {
+      this->Table.back().EndTime = entry.StartTime;
+      }
+    this->Table.push_back(entry);
+    }
+
+  // Aggregate the time steps of each input up to the start of the next one.
+  for (size_t i = 0; i < this->Table.size(); ++i)
+    {
+    const TableEntry& entry = this->Table[i];
+    const std::vector<double>& localTimeSteps =
+      this->Inputs[entry.Index].TimeSteps;
+    for (size_t j = 0;
+         j < localTimeSteps.size() && localTimeSteps[j] < entry.EndTime; ++j)
+      {
+      this->AggregateTimeSteps.push_back(localTimeSteps[j]);
+      }
+    }
+}
+
+//------------------------------------------------------------------------------
+const msvVTKFileSeriesReaderTimeRanges::TableEntry*
+msvVTKFileSeriesReaderTimeRanges::FindEntry(double time)
+{
+  this->UpdateTable();
+  if (this->Table.empty())
+    {
+    return 0;
+    }
+  TableEntry key;
+  key.StartTime = time;
+  // This returns the entry _after_ the one we want.
+  std::vector<TableEntry>::const_iterator itr = std::upper_bound(
+    this->Table.begin(), this->Table.end(), key,
+    msvVTKFileSeriesReaderTimeRanges::EntryLess);
+  if (itr != this->Table.begin())
+    {
+    // Back up one to the entry we really want. If the requested time is
+    // before any available time, the first entry is used.
+    --itr;
+    }
+  return &(*itr);
 }
 
 //-----------------------------------------------------------------------------
 int msvVTKFileSeriesReaderTimeRanges::GetAggregateTimeInfo(vtkInformation *outInfo)
 {
-  if (this->RangeMap.empty())
+  this->UpdateTable();
+  if (this->Table.empty())
     {
     vtkGenericWarningMacro(<< "No inputs with time information.");
     return 0;
     }
 
   double timeRange[2];
-  timeRange[0] = this->RangeMap.begin()->second
-                       ->Get(vtkStreamingDemandDrivenPipeline::TIME_RANGE())[0];
-  timeRange[1] = (--this->RangeMap.end())->second
-                       ->Get(vtkStreamingDemandDrivenPipeline::TIME_RANGE())[1];
+  this->GetTimeRange(timeRange);
 
   // Special case: if the time range is a single value, supress it.  This is
   // most likely from a data set that is a single file with no time anyway.
@@ -227,35 +420,11 @@ int msvVTKFileSeriesReaderTimeRanges::GetAggregateTimeInfo(vtkInformation *outIn
 
   outInfo->Set(vtkStreamingDemandDrivenPipeline::TIME_RANGE(), timeRange, 2);
 
-  std::vector<double> timeSteps;
-
-  RangeMapType::iterator itr = this->RangeMap.begin();
-  while (itr != this->RangeMap.end())
-    {
-    // First, get all the time steps for this input.
-    double *localTimeSteps
-      = itr->second->Get(vtkStreamingDemandDrivenPipeline::TIME_STEPS());
-    int numLocalSteps
-      = itr->second->Length(vtkStreamingDemandDrivenPipeline::TIME_STEPS());
-    double localEndTime = vtkTypeTraits<double>::Max();
-    // Second, check where the time range for the next section begins.
-    itr++;
-    if (itr != this->RangeMap.end())
-      {
-      localEndTime
-        = itr->second->Get(vtkStreamingDemandDrivenPipeline::TIME_RANGE())[0];
-      }
-    // Third, copy the appropriate time steps to the aggregate time steps.
-    for (int i = 0; (i<numLocalSteps) && (localTimeSteps[i]<localEndTime); i++)
-      {
-      timeSteps.push_back(localTimeSteps[i]);
-      }
-    }
-
-  if (timeSteps.size() > 0)
+  if (this->AggregateTimeSteps.size() > 0)
     {
     outInfo->Set(vtkStreamingDemandDrivenPipeline::TIME_STEPS(),
-               &timeSteps[0], static_cast<int>(timeSteps.size()));
+                 &this->AggregateTimeSteps[0],
+                 static_cast<int>(this->AggregateTimeSteps.size()));
     }
   else
     {
@@ -268,50 +437,68 @@ int msvVTKFileSeriesReaderTimeRanges::GetAggregateTimeInfo(vtkInformation *outIn
 int msvVTKFileSeriesReaderTimeRanges::GetInputTimeInfo(int index,
                                                     vtkInformation *outInfo)
 {
-  if (this->InputLookup.find(index) == this->InputLookup.end())
+  if (index < 0 || index >= static_cast<int>(this->Inputs.size()) ||
+      !this->Inputs[index].Known)
     {
     // if there are no files specified, there's no time information to provide.
     return 1;
     }
 
-  vtkInformation *storedInfo = this->InputLookup[index];
-  outInfo->CopyEntry(storedInfo,vtkStreamingDemandDrivenPipeline::TIME_RANGE());
-  if (storedInfo->Has(vtkStreamingDemandDrivenPipeline::TIME_STEPS()))
+  const InputTimeInfo& input = this->Inputs[index];
+  if (input.HasTimeRange)
     {
-    outInfo->CopyEntry(storedInfo,
-                       vtkStreamingDemandDrivenPipeline::TIME_STEPS());
-    return 1;
+    outInfo->Set(vtkStreamingDemandDrivenPipeline::TIME_RANGE(),
+                 const_cast<double*>(input.TimeRange), 2);
     }
   else
     {
+    outInfo->Remove(vtkStreamingDemandDrivenPipeline::TIME_RANGE());
+    }
+  if (!input.HasTimeSteps)
+    {
+    outInfo->Remove(vtkStreamingDemandDrivenPipeline::TIME_STEPS());
     return 0;
     }
+  if (input.TimeSteps.empty())
+    {
+    // A null array would remove the key.
+    double noTimeStep = 0.;
+    outInfo->Set(vtkStreamingDemandDrivenPipeline::TIME_STEPS(),
+                 &noTimeStep, 0);
+    }
+  else
+    {
+    outInfo->Set(vtkStreamingDemandDrivenPipeline::TIME_STEPS(),
+                 const_cast<double*>(&input.TimeSteps[0]),
+                 static_cast<int>(input.TimeSteps.size()));
+    }
+  return 1;
 }
 
 //-----------------------------------------------------------------------------
 int msvVTKFileSeriesReaderTimeRanges::GetIndexForTime(double time)
 {
-  if (this->RangeMap.empty())
-    {
-    // It would make sense to give a warning here, but we should have already
-    // warned in GetAggregateTimeInfo.  Warning here would just be annoying.
-    return 0;
-    }
+  // It would make sense to give a warning if there is no time information,
+  // but we should have already warned in GetAggregateTimeInfo.  Warning here
+  // would just be annoying.
+  const TableEntry* entry = this->FindEntry(time);
+  return entry ? entry->Index : 0;
+}
 
-  // This returns the item _after_ the one we want.
-  RangeMapType::iterator itr = this->RangeMap.upper_bound(time);
-  if (itr == this->RangeMap.begin())
+//-----------------------------------------------------------------------------
+int msvVTKFileSeriesReaderTimeRanges::GetNextInput(int index)
+{
+  if (index < 0 || index >= static_cast<int>(this->Inputs.size()) ||
+      !this->Inputs[index].InTable)
     {
-    // The requested time step is before any available time.  We will use it by
-    // doing nothing here.
+    return -1;
     }
-  else
+  const TableEntry* entry = this->FindEntry(this->Inputs[index].TimeRange[0]);
+  if (!entry || entry == &this->Table.back())
     {
-    // Back up one to the item we really want.
-    itr--;
+    return -1;
     }
-
-  return itr->second->Get(msvVTKFileSeriesReaderTimeRanges::INDEX());
+  return (entry + 1)->Index;
 }
 
 //-----------------------------------------------------------------------------
@@ -345,12 +532,15 @@ std::vector<double> msvVTKFileSeriesReaderTimeRanges::GetTimesForInput(
                                                         int inputId,
                                                         vtkInformation *outInfo)
 {
-  // Get the saved info for this input.
-  vtkInformation *inInfo = this->InputLookup[inputId];
+  std::vector<double> times;
+  if (inputId < 0 || inputId >= static_cast<int>(this->Inputs.size()) ||
+      !this->Inputs[inputId].HasTimeRange)
+    {
+    return times;
+    }
 
   // This is the time range that is supported by this input.
-  double *supportedTimeRange
-    = inInfo->Get(vtkStreamingDemandDrivenPipeline::TIME_RANGE());
+  const double *supportedTimeRange = this->Inputs[inputId].TimeRange;
 
   // Get the time range from which we "allow" data from this input.  The lower
   // bound is simply the bottom part of the time range of the input, unless it
@@ -359,28 +549,27 @@ std::vector<double> msvVTKFileSeriesReaderTimeRanges::GetTimesForInput(
   // highest times starts.
   double allowedTimeRange[2];
   allowedTimeRange[0] = supportedTimeRange[0];
-
-  // Find the input with the next times.
-  RangeMapType::iterator itr = this->RangeMap.upper_bound(allowedTimeRange[0]);
-  if (itr != this->RangeMap.end())
+  allowedTimeRange[1] = vtkTypeTraits<double>::Max();
+  const TableEntry* entry = this->FindEntry(supportedTimeRange[0]);
+  if (entry && entry->StartTime == supportedTimeRange[0])
     {
-    allowedTimeRange[1] = itr->first;
+    allowedTimeRange[1] = entry->EndTime;
+    // Adjust the begining time if we are the first time.
+    if (entry == &this->Table.front())
+      {
+      allowedTimeRange[0] = -vtkTypeTraits<double>::Max();
+      }
     }
-  else
+  else if (entry && entry->StartTime < supportedTimeRange[0])
     {
-    // There is no next time.
-    allowedTimeRange[1] = vtkTypeTraits<double>::Max();
+    allowedTimeRange[1] = entry->EndTime;
     }
-
-  // Adjust the begining time if we are the first time.
-  if (this->RangeMap.find(allowedTimeRange[0]) == this->RangeMap.begin())
+  else if (entry)
     {
-    allowedTimeRange[0] = -vtkTypeTraits<double>::Max();
+    // The input starts before any input in use.
+    allowedTimeRange[1] = entry->StartTime;
     }
 
-  // Now we are finally ready to identify the times
-  std::vector<double> times;
-
   // Get the update times
   int numUpTimes =
     outInfo->Length(vtkStreamingDemandDrivenPipeline::UPDATE_TIME_STEPS());
@@ -402,165 +591,1302 @@ std::vector<double> msvVTKFileSeriesReaderTimeRanges::GetTimesForInput(
   return times;
 }
 
-//=============================================================================
-struct msvVTKFileSeriesReaderInternals
+//-----------------------------------------------------------------------------
+std::vector<int> msvVTKFileSeriesReaderTimeRanges::GetInputsStartingWith(
+                                                                   int index)
 {
-  std::vector<std::string> FileNames;
-  bool FileNameIsSet;
-  msvVTKFileSeriesReaderTimeRanges *TimeRanges;
-};
+  std::vector<int> inputs;
+  if (index < 0 || index >= static_cast<int>(this->Inputs.size()) ||
+      !this->Inputs[index].InTable)
+    {
+    return inputs;
+    }
+  this->UpdateTable();
+  std::pair<double, int> first(this->Inputs[index].TimeRange[0],
+                               -VTK_LARGE_INTEGER);
+  std::pair<double, int> last(this->Inputs[index].TimeRange[0],
+                              VTK_LARGE_INTEGER);
+  std::vector<std::pair<double, int> >::const_iterator it = std::lower_bound(
+    this->InputsByStartTime.begin(), this->InputsByStartTime.end(), first);
+  std::vector<std::pair<double, int> >::const_iterator end = std::upper_bound(
+    it, this->InputsByStartTime.end(), last);
+  for (; it != end; ++it)
+    {
+    inputs.push_back(it->second);
+    }
+  return inputs;
+}
 
 //=============================================================================
-msvVTKFileSeriesReader::msvVTKFileSeriesReader()
+// Layout of the binary time index file. It is written in the native byte
+// order of the writer and memory-mapped as is:
+//   header | records sorted by file name | time steps | file names
+struct msvVTKFileSeriesReaderTimeIndexHeader
 {
-  this->SetNumberOfInputPorts(0);
-  this->SetNumberOfOutputPorts(1);
-
-  this->Reader = 0;
+  char Magic[8];
+  vtkTypeUInt32 ByteOrder;
+  vtkTypeUInt32 Version;
+  vtkTypeUInt64 NumberOfRecords;
+  vtkTypeUInt64 NumberOfTimeSteps;
+};
 
-  this->HiddenReaderModification = 0;
-  this->SavedReaderModification = 0;
+struct msvVTKFileSeriesReaderTimeIndexRecord
+{
+  vtkTypeUInt64 NameOffset;
+  vtkTypeUInt64 NameLength;
+  vtkTypeUInt64 FirstTimeStep;
+  vtkTypeUInt64 NumberOfTimeSteps;
+  vtkTypeInt64 ModifiedTime;
+  vtkTypeUInt64 Size;
+  vtkTypeUInt64 Hash;
+  double TimeRange[2];
+};
 
-  this->Internal = new msvVTKFileSeriesReaderInternals;
-  this->Internal->FileNameIsSet = false;
-  this->Internal->TimeRanges = new msvVTKFileSeriesReaderTimeRanges;
+static const char msvTimeIndexMagic[8] = {'M','S','V','T','I','D','X','\0'};
+static const vtkTypeUInt32 msvTimeIndexByteOrder = 0x01020304;
+static const vtkTypeUInt32 msvTimeIndexVersion = 2;
 
-  this->FileNameMethod = NULL;
-  //this->SetFileNameMethod("SetFileName");
+//-----------------------------------------------------------------------------
+// 64 bits FNV-1a hash of the first 64 KiB of a file, 0 if it can not be
+// read. Along with the file size, it tells a copied file from a rewritten
+// one without reading whole data files.
+static vtkTypeUInt64 msvComputeFileHash(const char *fileName)
+{
+  ifstream file(fileName, ios::in | ios::binary);
+  if (!file.good())
+    {
+    return 0;
+    }
+  vtkTypeUInt64 hash = 14695981039346656037ULL;
+  char buffer[65536];
+  file.read(buffer, sizeof(buffer));
+  std::streamsize count = file.gcount();
+  for (std::streamsize i = 0; i < count; ++i)
+    {
+    hash ^= static_cast<unsigned char>(buffer[i]);
+    hash *= 1099511628211ULL;
+    }
+  // 0 means no hash.
+  return hash ? hash : 1;
+}
 
-  this->MetaFileName = NULL;
-  this->UseMetaFile = 0;
-  this->CurrentFileName = 0;
+//=============================================================================
+// Internal class persisting the time information of each file of a series,
+// so that it does not have to be queried again as long as the file is not
+// modified. The index file is memory-mapped, entries are looked up in place
+// and only the new or changed ones are kept in memory until written.
+class msvVTKFileSeriesReaderTimeIndex
+{
+public:
+  msvVTKFileSeriesReaderTimeIndex();
+  ~msvVTKFileSeriesReaderTimeIndex();
+
+  // Fill info with the time information of fileName if it is known and the
+  // file was not modified since (same modification time and size, or same
+  // size and hash of the beginning of the file). Return false otherwise.
+  bool Get(const std::string& fileName, vtkInformation *info);
+  // Record the time information found in info for fileName.
+  void Set(const std::string& fileName, vtkInformation *info);
+
+  bool Read(const char *indexFileName);
+  // Write all the entries. Missing content hashes are computed only if
+  // computeHashes is true, as it reads the beginning of every file.
+  bool Write(const char *indexFileName, bool computeHashes);
+  bool IsOutOfDate() const { return this->OutOfDate; }
 
-  this->IgnoreReaderTime = 0;
+private:
+  struct Entry
+  {
+    long int ModifiedTime;
+    unsigned long Size;
+    vtkTypeUInt64 Hash;
+    std::vector<double> TimeSteps;
+    double TimeRange[2];
+  };
+  typedef std::map<std::string, Entry> EntryMapType;
+
+  bool Find(const std::string& fileName, Entry& entry);
+  bool FindMapped(const std::string& fileName, Entry& entry);
+  void GetMappedEntry(vtkTypeUInt64 record, Entry& entry);
+  std::string GetMappedName(vtkTypeUInt64 record);
+  void Unmap();
+
+  EntryMapType Entries;
+  bool OutOfDate;
+
+  const char *MappedData;
+  size_t MappedSize;
+#ifdef _WIN32
+  HANDLE MappedFile;
+  HANDLE Mapping;
+#endif
+  const msvVTKFileSeriesReaderTimeIndexHeader *Header;
+  const msvVTKFileSeriesReaderTimeIndexRecord *Records;
+  const double *TimeSteps;
+  const char *Names;
+  size_t NamesSize;
+};
 
-  this->LastRequestInformationIndex = -1;
+//-----------------------------------------------------------------------------
+msvVTKFileSeriesReaderTimeIndex::msvVTKFileSeriesReaderTimeIndex()
+{
+  this->OutOfDate = false;
+  this->MappedData = 0;
+  this->MappedSize = 0;
+#ifdef _WIN32
+  this->MappedFile = INVALID_HANDLE_VALUE;
+  this->Mapping = NULL;
+#endif
+  this->Header = 0;
+  this->Records = 0;
+  this->TimeSteps = 0;
+  this->Names = 0;
+  this->NamesSize = 0;
 }
 
 //-----------------------------------------------------------------------------
-msvVTKFileSeriesReader::~msvVTKFileSeriesReader()
+msvVTKFileSeriesReaderTimeIndex::~msvVTKFileSeriesReaderTimeIndex()
 {
-  this->SetCurrentFileName(NULL);
-  this->SetMetaFileName(NULL);
-  this->SetReader(NULL);
-  delete this->Internal->TimeRanges;
-  delete this->Internal;
-  this->SetFileNameMethod(0);
+  this->Unmap();
 }
 
-//----------------------------------------------------------------------------
-// Overload standard modified time function. If the internal reader is
-// modified, then this object is modified as well.
-unsigned long msvVTKFileSeriesReader::GetMTime()
+//-----------------------------------------------------------------------------
+bool msvVTKFileSeriesReaderTimeIndex::Get(const std::string& fileName,
+                                          vtkInformation *info)
 {
-  unsigned long mTime=this->vtkObject::GetMTime();
-
-  if ( this->Reader )
+  Entry entry;
+  if (!this->Find(fileName, entry) ||
+      entry.Size != vtksys::SystemTools::FileLength(fileName.c_str()))
     {
-    // In general, we want Modifieds in Reader to be reflected in this object's
-    // MTime.  However, we will also be making modifications to the Reader (such
-    // as changing the filename) that we want to suppress from the reporting.
-    // When this happens, we save the timestamp before our modification into
-    // this->SavedReaderModification and capture the resulting MTime in
-    // this->HiddenReaderModification.  If we run into that modification,
-    // suppress it by reporting the saved modification.
-    unsigned long readerMTime;
-    if (this->Reader->GetMTime() == this->HiddenReaderModification)
-      {
-      readerMTime = this->SavedReaderModification;
-      }
-    else
+    return false;
+    }
+  long int modifiedTime = vtksys::SystemTools::ModifiedTime(fileName.c_str());
+  if (entry.ModifiedTime != modifiedTime)
+    {
+    // Same content with a new time stamp, e.g. a copied series.
+    if (!entry.Hash || entry.Hash != msvComputeFileHash(fileName.c_str()))
       {
-      readerMTime = this->Reader->GetMTime();
+      return false;
       }
-    mTime = ( readerMTime > mTime ? readerMTime : mTime );
+    entry.ModifiedTime = modifiedTime;
+    this->Entries[fileName] = entry;
+    this->OutOfDate = true;
     }
 
-  return mTime;
-}
-
-//----------------------------------------------------------------------------
-void msvVTKFileSeriesReader::AddFileName(const char* name)
-{
-  this->Internal->FileNames.push_back(name);
-  this->Modified();
+  info->Remove(vtkStreamingDemandDrivenPipeline::TIME_STEPS());
+  if (!entry.TimeSteps.empty())
+    {
+    info->Set(vtkStreamingDemandDrivenPipeline::TIME_STEPS(),
+              &entry.TimeSteps[0], static_cast<int>(entry.TimeSteps.size()));
+    }
+  info->Set(vtkStreamingDemandDrivenPipeline::TIME_RANGE(),
+            entry.TimeRange, 2);
+  return true;
 }
 
-//----------------------------------------------------------------------------
-void msvVTKFileSeriesReader::RemoveAllFileNames()
+//-----------------------------------------------------------------------------
+void msvVTKFileSeriesReaderTimeIndex::Set(const std::string& fileName,
+                                          vtkInformation *info)
 {
-  this->Internal->FileNames.clear();
-  this->Modified();
-}
+  Entry entry;
+  entry.ModifiedTime = vtksys::SystemTools::ModifiedTime(fileName.c_str());
+  entry.Size = vtksys::SystemTools::FileLength(fileName.c_str());
+  entry.Hash = 0;
+  if (info->Has(vtkStreamingDemandDrivenPipeline::TIME_STEPS()))
+    {
+    double *timeSteps = info->Get(vtkStreamingDemandDrivenPipeline::TIME_STEPS());
+    int numTimeSteps = info->Length(vtkStreamingDemandDrivenPipeline::TIME_STEPS());
+    entry.TimeSteps.assign(timeSteps, timeSteps + numTimeSteps);
+    }
+  if (info->Has(vtkStreamingDemandDrivenPipeline::TIME_RANGE()))
+    {
+    double *timeRange = info->Get(vtkStreamingDemandDrivenPipeline::TIME_RANGE());
+    entry.TimeRange[0] = timeRange[0];
+    entry.TimeRange[1] = timeRange[1];
+    }
+  else if (!entry.TimeSteps.empty())
+    {
+    entry.TimeRange[0] = entry.TimeSteps.front();
+    entry.TimeRange[1] = entry.TimeSteps.back();
+    }
+  else
+    {
+    // No time information, nothing worth remembering.
+    return;
+    }
 
-//----------------------------------------------------------------------------
-unsigned int msvVTKFileSeriesReader::GetNumberOfFileNames()
-{
-  return static_cast<unsigned int>(this->Internal->FileNames.size());
+  Entry previous;
+  if (this->Find(fileName, previous) &&
+      previous.ModifiedTime == entry.ModifiedTime &&
+      previous.Size == entry.Size)
+    {
+    if (previous.TimeSteps == entry.TimeSteps &&
+        previous.TimeRange[0] == entry.TimeRange[0] &&
+        previous.TimeRange[1] == entry.TimeRange[1])
+      {
+      return;
+      }
+    // The content did not change, its hash still holds.
+    entry.Hash = previous.Hash;
+    }
+  this->Entries[fileName] = entry;
+  this->OutOfDate = true;
 }
 
-//----------------------------------------------------------------------------
-const char* msvVTKFileSeriesReader::GetFileName(unsigned int idx)
+//-----------------------------------------------------------------------------
+bool msvVTKFileSeriesReaderTimeIndex::Find(const std::string& fileName,
+                                           Entry& entry)
 {
-  if (idx >= this->Internal->FileNames.size())
+  EntryMapType::iterator itr = this->Entries.find(fileName);
+  if (itr != this->Entries.end())
     {
-    return 0;
+    entry = itr->second;
+    return true;
     }
-  return this->Internal->FileNames[idx].c_str();
+  return this->FindMapped(fileName, entry);
 }
 
-//----------------------------------------------------------------------------
-int msvVTKFileSeriesReader::ProcessRequest(vtkInformation* request,
-                                        vtkInformationVector** inputVector,
-                                        vtkInformationVector* outputVector)
+//-----------------------------------------------------------------------------
+bool msvVTKFileSeriesReaderTimeIndex::FindMapped(const std::string& fileName,
+                                                 Entry& entry)
 {
-  this->UpdateMetaData();
-
-  if (this->Reader)
+  if (!this->Header)
     {
-    // Make sure that there is a file to get information from.
-    if (request->Has(vtkDemandDrivenPipeline::REQUEST_DATA_OBJECT()))
-      {
-      if (!this->Internal->FileNameIsSet && (this->GetNumberOfFileNames() > 0))
-        {
-        this->SetReaderFileName(this->GetFileName(0));
-        this->Internal->FileNameIsSet = true;
-        }
-      }
-    // Our handling of these requests will call the reader's request in turn.
-    if (request->Has(vtkDemandDrivenPipeline::REQUEST_INFORMATION()))
+    return false;
+    }
+  // Records are sorted by file name.
+  vtkTypeUInt64 first = 0;
+  vtkTypeUInt64 last = this->Header->NumberOfRecords;
+  while (first < last)
+    {
+    vtkTypeUInt64 middle = first + (last - first) / 2;
+    const msvVTKFileSeriesReaderTimeIndexRecord &record = this->Records[middle];
+    int comparison = fileName.compare(0, std::string::npos,
+                                      this->Names + record.NameOffset,
+                                      static_cast<size_t>(record.NameLength));
+    if (comparison == 0)
       {
-      return this->RequestInformation(request, inputVector, outputVector);
+      this->GetMappedEntry(middle, entry);
+      return true;
       }
-    if (request->Has(vtkDemandDrivenPipeline::REQUEST_DATA()))
+    if (comparison < 0)
       {
-      return this->RequestData(request, inputVector, outputVector);
+      last = middle;
       }
-    // Let the reader process anything we did not handle ourselves.
-    int retVal = this->Reader->ProcessRequest(request,
-                                              inputVector,
-                                              outputVector);
-    // Additional processing requried by us.
-    if (request->Has(vtkStreamingDemandDrivenPipeline::REQUEST_UPDATE_EXTENT()))
+    else
       {
-      this->RequestUpdateExtent(request, inputVector, outputVector);
+      first = middle + 1;
       }
-
-    return retVal;
     }
-  vtkErrorMacro("No reader is defined. Cannot perform pipeline pass.");
-  return 0;
+  return false;
 }
 
-//----------------------------------------------------------------------------
-int msvVTKFileSeriesReader::RequestInformation(
-                                 vtkInformation* request,
-                                 vtkInformationVector** vtkNotUsed(inputVector),
-                                 vtkInformationVector* outputVector)
+//-----------------------------------------------------------------------------
+void msvVTKFileSeriesReaderTimeIndex::GetMappedEntry(vtkTypeUInt64 index,
+                                                     Entry& entry)
 {
-  vtkInformation *outInfo = outputVector->GetInformationObject(0);
+  const msvVTKFileSeriesReaderTimeIndexRecord &record = this->Records[index];
+  entry.ModifiedTime = static_cast<long int>(record.ModifiedTime);
+  entry.Size = static_cast<unsigned long>(record.Size);
+  entry.Hash = record.Hash;
+  entry.TimeSteps.assign(this->TimeSteps + record.FirstTimeStep,
+                         this->TimeSteps + record.FirstTimeStep +
+                           record.NumberOfTimeSteps);
+  entry.TimeRange[0] = record.TimeRange[0];
+  entry.TimeRange[1] = record.TimeRange[1];
+}
 
-  this->Internal->TimeRanges->Reset();
+//-----------------------------------------------------------------------------
+std::string msvVTKFileSeriesReaderTimeIndex::GetMappedName(vtkTypeUInt64 index)
+{
+  const msvVTKFileSeriesReaderTimeIndexRecord &record = this->Records[index];
+  return std::string(this->Names + record.NameOffset,
+                     static_cast<size_t>(record.NameLength));
+}
+
+//-----------------------------------------------------------------------------
+bool msvVTKFileSeriesReaderTimeIndex::Read(const char *indexFileName)
+{
+  this->Unmap();
+  this->Entries.clear();
+  this->OutOfDate = false;
+
+#ifdef _WIN32
+  this->MappedFile = CreateFileA(indexFileName, GENERIC_READ, FILE_SHARE_READ,
+                                 NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL,
+                                 NULL);
+  if (this->MappedFile == INVALID_HANDLE_VALUE)
+    {
+    return false;
+    }
+  LARGE_INTEGER fileSize;
+  if (!GetFileSizeEx(this->MappedFile, &fileSize) || fileSize.QuadPart == 0)
+    {
+    this->Unmap();
+    return false;
+    }
+  this->MappedSize = static_cast<size_t>(fileSize.QuadPart);
+  this->Mapping = CreateFileMappingA(this->MappedFile, NULL, PAGE_READONLY,
+                                     0, 0, NULL);
+  if (this->Mapping == NULL)
+    {
+    this->Unmap();
+    return false;
+    }
+  this->MappedData = static_cast<const char*>(
+    MapViewOfFile(this->Mapping, FILE_MAP_READ, 0, 0, 0));
+#else
+  int fd = open(indexFileName, O_RDONLY);
+  if (fd < 0)
+    {
+    return false;
+    }
+  struct stat fileStat;
+  if (fstat(fd, &fileStat) != 0 || fileStat.st_size == 0)
+    {
+    close(fd);
+    return false;
+    }
+  this->MappedSize = static_cast<size_t>(fileStat.st_size);
+  void *data = mmap(0, this->MappedSize, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  this->MappedData = (data == MAP_FAILED) ? 0 : static_cast<const char*>(data);
+#endif
+  if (!this->MappedData)
+    {
+    this->Unmap();
+    return false;
+    }
+
+  // Check the file is an index written on a machine with the same byte
+  // order, and that the sections fit in it.
+  size_t headerSize = sizeof(msvVTKFileSeriesReaderTimeIndexHeader);
+  const msvVTKFileSeriesReaderTimeIndexHeader *header =
+    reinterpret_cast<const msvVTKFileSeriesReaderTimeIndexHeader*>(
+      this->MappedData);
+  if (this->MappedSize < headerSize ||
+      memcmp(header->Magic, msvTimeIndexMagic, sizeof(msvTimeIndexMagic)) ||
+      header->ByteOrder != msvTimeIndexByteOrder ||
+      header->Version != msvTimeIndexVersion)
+    {
+    this->Unmap();
+    return false;
+    }
+  vtkTypeUInt64 recordsSize = header->NumberOfRecords *
+    sizeof(msvVTKFileSeriesReaderTimeIndexRecord);
+  vtkTypeUInt64 timeStepsSize = header->NumberOfTimeSteps * sizeof(double);
+  if (recordsSize / sizeof(msvVTKFileSeriesReaderTimeIndexRecord) !=
+        header->NumberOfRecords ||
+      timeStepsSize / sizeof(double) != header->NumberOfTimeSteps ||
+      headerSize + recordsSize + timeStepsSize > this->MappedSize)
+    {
+    this->Unmap();
+    return false;
+    }
+  this->Header = header;
+  this->Records =
+    reinterpret_cast<const msvVTKFileSeriesReaderTimeIndexRecord*>(
+      this->MappedData + headerSize);
+  this->TimeSteps = reinterpret_cast<const double*>(
+    this->MappedData + headerSize + recordsSize);
+  this->Names = this->MappedData + headerSize + recordsSize + timeStepsSize;
+  this->NamesSize = this->MappedSize -
+    static_cast<size_t>(headerSize + recordsSize + timeStepsSize);
+  for (vtkTypeUInt64 i = 0; i < header->NumberOfRecords; ++i)
+    {
+    const msvVTKFileSeriesReaderTimeIndexRecord &record = this->Records[i];
+    if (record.NameOffset + record.NameLength > this->NamesSize ||
+        record.FirstTimeStep + record.NumberOfTimeSteps >
+          header->NumberOfTimeSteps)
+      {
+      this->Unmap();
+      return false;
+      }
+    }
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+bool msvVTKFileSeriesReaderTimeIndex::Write(const char *indexFileName,
+                                            bool computeHashes)
+{
+  // Gather the mapped entries that were not replaced, the file can not be
+  // written while mapped.
+  if (this->Header)
+    {
+    for (vtkTypeUInt64 i = 0; i < this->Header->NumberOfRecords; ++i)
+      {
+      std::string fileName = this->GetMappedName(i);
+      if (this->Entries.find(fileName) == this->Entries.end())
+        {
+        this->GetMappedEntry(i, this->Entries[fileName]);
+        }
+      }
+    this->Unmap();
+    }
+
+  msvVTKFileSeriesReaderTimeIndexHeader header;
+  memcpy(header.Magic, msvTimeIndexMagic, sizeof(msvTimeIndexMagic));
+  header.ByteOrder = msvTimeIndexByteOrder;
+  header.Version = msvTimeIndexVersion;
+  header.NumberOfRecords = this->Entries.size();
+  header.NumberOfTimeSteps = 0;
+
+  std::vector<msvVTKFileSeriesReaderTimeIndexRecord> records;
+  std::vector<double> timeSteps;
+  std::string names;
+  for (EntryMapType::iterator itr = this->Entries.begin();
+       itr != this->Entries.end(); ++itr)
+    {
+    Entry& entry = itr->second;
+    if (computeHashes && !entry.Hash)
+      {
+      entry.Hash = msvComputeFileHash(itr->first.c_str());
+      }
+    msvVTKFileSeriesReaderTimeIndexRecord record;
+    record.NameOffset = names.size();
+    record.NameLength = itr->first.size();
+    record.FirstTimeStep = timeSteps.size();
+    record.NumberOfTimeSteps = entry.TimeSteps.size();
+    record.ModifiedTime = entry.ModifiedTime;
+    record.Size = entry.Size;
+    record.Hash = entry.Hash;
+    record.TimeRange[0] = entry.TimeRange[0];
+    record.TimeRange[1] = entry.TimeRange[1];
+    records.push_back(record);
+    names += itr->first;
+    timeSteps.insert(timeSteps.end(),
+                     entry.TimeSteps.begin(), entry.TimeSteps.end());
+    }
+  header.NumberOfTimeSteps = timeSteps.size();
+
+  ofstream indexFile(indexFileName, ios::out | ios::binary);
+  if (!indexFile.good())
+    {
+    return false;
+    }
+  indexFile.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  if (!records.empty())
+    {
+    indexFile.write(reinterpret_cast<const char*>(&records[0]),
+                    records.size() * sizeof(records[0]));
+    }
+  if (!timeSteps.empty())
+    {
+    indexFile.write(reinterpret_cast<const char*>(&timeSteps[0]),
+                    timeSteps.size() * sizeof(double));
+    }
+  indexFile.write(names.data(), names.size());
+  this->OutOfDate = !indexFile.good();
+  return !this->OutOfDate;
+}
+
+//-----------------------------------------------------------------------------
+void msvVTKFileSeriesReaderTimeIndex::Unmap()
+{
+#ifdef _WIN32
+  if (this->MappedData)
+    {
+    UnmapViewOfFile(this->MappedData);
+    }
+  if (this->Mapping != NULL)
+    {
+    CloseHandle(this->Mapping);
+    this->Mapping = NULL;
+    }
+  if (this->MappedFile != INVALID_HANDLE_VALUE)
+    {
+    CloseHandle(this->MappedFile);
+    this->MappedFile = INVALID_HANDLE_VALUE;
+    }
+#else
+  if (this->MappedData)
+    {
+    munmap(const_cast<char*>(this->MappedData), this->MappedSize);
+    }
+#endif
+  this->MappedData = 0;
+  this->MappedSize = 0;
+  this->Header = 0;
+  this->Records = 0;
+  this->TimeSteps = 0;
+  this->Names = 0;
+  this->NamesSize = 0;
+}
+
+//-----------------------------------------------------------------------------
+// Update reader, at the given time and piece (piece number, number of pieces
+// and ghost levels) if any, and return a shallow copy of its output that
+// does not share anything with the reader anymore. The reader is deleted.
+// Used to read files on other threads than the pipeline one.
+static vtkDataObject* msvReadDetachedOutput(vtkAlgorithm *reader,
+                                            const double *time,
+                                            const int *piece)
+{
+  reader->UpdateInformation();
+  vtkStreamingDemandDrivenPipeline *executive =
+    vtkStreamingDemandDrivenPipeline::SafeDownCast(reader->GetExecutive());
+  if (time)
+    {
+    executive->SetUpdateTimeStep(0, *time);
+    }
+  if (piece)
+    {
+    executive->SetUpdateExtent(0, piece[0], piece[1], piece[2]);
+    }
+  reader->Update();
+  vtkDataObject *output = reader->GetOutputDataObject(0);
+  vtkDataObject *data = 0;
+  if (output)
+    {
+    data = output->NewInstance();
+    data->ShallowCopy(output);
+    output->Initialize();
+    }
+  reader->Delete();
+  return data;
+}
+
+//=============================================================================
+// Internal class reading files ahead on background threads and keeping the
+// outputs in a least recently used cache.
+// The cache itself is only accessed from the pipeline thread. The workers
+// only see the readers they are given and hand over the shallow copies of
+// their outputs through the Completed list, so that no data object is ever
+// shared (and reference counted) by two threads at the same time.
+class msvVTKFileSeriesReaderPrefetcher
+{
+public:
+  msvVTKFileSeriesReaderPrefetcher();
+  ~msvVTKFileSeriesReaderPrefetcher();
+
+  void Start(int numberOfThreads);
+  void Stop();
+  void Clear();
+  void SetCacheSize(int size);
+
+  // Move the outputs read by the workers into the cache.
+  void CollectCompleted();
+  // Wait for index to be read if it is scheduled, then return its cached
+  // output or NULL.
+  vtkDataObject* Get(int index);
+  void Insert(int index, vtkDataObject* data);
+  bool IsCachedOrPending(int index);
+  // Queue reader to be updated by a worker for the given piece. Takes
+  // ownership of reader.
+  void Schedule(int index, vtkAlgorithm* reader, const int piece[3]);
+
+private:
+  static VTK_THREAD_RETURN_TYPE Work(void* arg);
+  bool IsCompleted(int index);
+  void Touch(int index);
+
+  struct Job
+  {
+    int Index;
+    vtkAlgorithm* Reader;
+    int Piece[3];
+    unsigned long Generation;
+  };
+  struct Result
+  {
+    int Index;
+    vtkDataObject* Data;
+    unsigned long Generation;
+  };
+
+  vtkSmartPointer<vtkMultiThreader> Threader;
+  std::vector<int> ThreadIds;
+  vtkSmartPointer<vtkMutexLock> Lock;
+  vtkSmartPointer<vtkConditionVariable> JobAdded;
+  vtkSmartPointer<vtkConditionVariable> JobDone;
+  bool Stopping;
+  unsigned long Generation;
+  std::deque<Job> Jobs;
+  std::vector<Result> Completed;
+  std::set<int> Pending;
+
+  typedef std::map<int, vtkSmartPointer<vtkDataObject> > CacheType;
+  CacheType Cache;
+  std::list<int> UseOrder;
+  int CacheSize;
+};
+
+//-----------------------------------------------------------------------------
+msvVTKFileSeriesReaderPrefetcher::msvVTKFileSeriesReaderPrefetcher()
+{
+  this->Threader = vtkSmartPointer<vtkMultiThreader>::New();
+  this->Lock = vtkSmartPointer<vtkMutexLock>::New();
+  this->JobAdded = vtkSmartPointer<vtkConditionVariable>::New();
+  this->JobDone = vtkSmartPointer<vtkConditionVariable>::New();
+  this->Stopping = false;
+  this->Generation = 0;
+  this->CacheSize = 1;
+}
+
+//-----------------------------------------------------------------------------
+msvVTKFileSeriesReaderPrefetcher::~msvVTKFileSeriesReaderPrefetcher()
+{
+  this->Stop();
+}
+
+//-----------------------------------------------------------------------------
+void msvVTKFileSeriesReaderPrefetcher::Start(int numberOfThreads)
+{
+  numberOfThreads = std::min(numberOfThreads, VTK_MAX_THREADS);
+  if (static_cast<int>(this->ThreadIds.size()) == numberOfThreads)
+    {
+    return;
+    }
+  this->Stop();
+  for (int i = 0; i < numberOfThreads; ++i)
+    {
+    this->ThreadIds.push_back(this->Threader->SpawnThread(
+      &msvVTKFileSeriesReaderPrefetcher::Work, this));
+    }
+}
+
+//-----------------------------------------------------------------------------
+void msvVTKFileSeriesReaderPrefetcher::Stop()
+{
+  if (this->ThreadIds.empty())
+    {
+    return;
+    }
+  this->Lock->Lock();
+  this->Stopping = true;
+  this->JobAdded->Broadcast();
+  this->Lock->Unlock();
+  for (size_t i = 0; i < this->ThreadIds.size(); ++i)
+    {
+    this->Threader->TerminateThread(this->ThreadIds[i]);
+    }
+  this->ThreadIds.clear();
+  this->Stopping = false;
+
+  // Without workers, nothing scheduled will ever be read.
+  this->Clear();
+}
+
+//-----------------------------------------------------------------------------
+void msvVTKFileSeriesReaderPrefetcher::Clear()
+{
+  this->Lock->Lock();
+  ++this->Generation;
+  for (std::deque<Job>::iterator it = this->Jobs.begin();
+       it != this->Jobs.end(); ++it)
+    {
+    it->Reader->Delete();
+    }
+  this->Jobs.clear();
+  this->Pending.clear();
+  this->Lock->Unlock();
+
+  // Outputs still being read are dropped by CollectCompleted when they
+  // come back with an old generation.
+  this->CollectCompleted();
+  this->Cache.clear();
+  this->UseOrder.clear();
+}
+
+//-----------------------------------------------------------------------------
+void msvVTKFileSeriesReaderPrefetcher::SetCacheSize(int size)
+{
+  this->CacheSize = std::max(size, 1);
+}
+
+//-----------------------------------------------------------------------------
+void msvVTKFileSeriesReaderPrefetcher::CollectCompleted()
+{
+  std::vector<Result> completed;
+  this->Lock->Lock();
+  completed.swap(this->Completed);
+  for (size_t i = 0; i < completed.size(); ++i)
+    {
+    if (completed[i].Generation == this->Generation)
+      {
+      this->Pending.erase(completed[i].Index);
+      }
+    }
+  unsigned long generation = this->Generation;
+  this->Lock->Unlock();
+
+  for (size_t i = 0; i < completed.size(); ++i)
+    {
+    if (completed[i].Data && completed[i].Generation == generation)
+      {
+      this->Insert(completed[i].Index, completed[i].Data);
+      }
+    if (completed[i].Data)
+      {
+      completed[i].Data->Delete();
+      }
+    }
+}
+
+//-----------------------------------------------------------------------------
+vtkDataObject* msvVTKFileSeriesReaderPrefetcher::Get(int index)
+{
+  this->Lock->Lock();
+  while (this->Pending.count(index) && !this->ThreadIds.empty() &&
+         !this->IsCompleted(index))
+    {
+    this->JobDone->Wait(this->Lock);
+    }
+  this->Lock->Unlock();
+  this->CollectCompleted();
+
+  CacheType::iterator it = this->Cache.find(index);
+  if (it == this->Cache.end())
+    {
+    return 0;
+    }
+  this->Touch(index);
+  return it->second;
+}
+
+//-----------------------------------------------------------------------------
+void msvVTKFileSeriesReaderPrefetcher::Insert(int index, vtkDataObject* data)
+{
+  this->Cache[index] = data;
+  this->Touch(index);
+  while (static_cast<int>(this->Cache.size()) > this->CacheSize)
+    {
+    this->Cache.erase(this->UseOrder.back());
+    this->UseOrder.pop_back();
+    }
+}
+
+//-----------------------------------------------------------------------------
+bool msvVTKFileSeriesReaderPrefetcher::IsCachedOrPending(int index)
+{
+  if (this->Cache.find(index) != this->Cache.end())
+    {
+    return true;
+    }
+  this->Lock->Lock();
+  bool pending = this->Pending.count(index) > 0;
+  this->Lock->Unlock();
+  return pending;
+}
+
+//-----------------------------------------------------------------------------
+void msvVTKFileSeriesReaderPrefetcher::Schedule(int index, vtkAlgorithm* reader,
+                                                const int piece[3])
+{
+  Job job;
+  job.Index = index;
+  job.Reader = reader;
+  std::copy(piece, piece + 3, job.Piece);
+  this->Lock->Lock();
+  job.Generation = this->Generation;
+  this->Jobs.push_back(job);
+  this->Pending.insert(index);
+  this->JobAdded->Signal();
+  this->Lock->Unlock();
+}
+
+//-----------------------------------------------------------------------------
+bool msvVTKFileSeriesReaderPrefetcher::IsCompleted(int index)
+{
+  // Lock must be held. Pending entries are only erased when collected.
+  for (size_t i = 0; i < this->Completed.size(); ++i)
+    {
+    if (this->Completed[i].Index == index &&
+        this->Completed[i].Generation == this->Generation)
+      {
+      return true;
+      }
+    }
+  return false;
+}
+
+//-----------------------------------------------------------------------------
+void msvVTKFileSeriesReaderPrefetcher::Touch(int index)
+{
+  this->UseOrder.remove(index);
+  this->UseOrder.push_front(index);
+}
+
+//-----------------------------------------------------------------------------
+VTK_THREAD_RETURN_TYPE msvVTKFileSeriesReaderPrefetcher::Work(void* arg)
+{
+  vtkMultiThreader::ThreadInfo* threadInfo =
+    static_cast<vtkMultiThreader::ThreadInfo*>(arg);
+  msvVTKFileSeriesReaderPrefetcher* self =
+    static_cast<msvVTKFileSeriesReaderPrefetcher*>(threadInfo->UserData);
+
+  self->Lock->Lock();
+  while (true)
+    {
+    while (!self->Stopping && self->Jobs.empty())
+      {
+      self->JobAdded->Wait(self->Lock);
+      }
+    if (self->Stopping)
+      {
+      break;
+      }
+    Job job = self->Jobs.front();
+    self->Jobs.pop_front();
+    self->Lock->Unlock();
+
+    // Release the reader (and its references to the arrays) before handing
+    // the copy of its output over.
+    Result result;
+    result.Index = job.Index;
+    result.Generation = job.Generation;
+    result.Data = msvReadDetachedOutput(job.Reader, 0, job.Piece);
+
+    self->Lock->Lock();
+    self->Completed.push_back(result);
+    self->JobDone->Broadcast();
+    }
+  self->Lock->Unlock();
+  return VTK_THREAD_RETURN_VALUE;
+}
+
+//=============================================================================
+// A time step of a multiple time request, read on its own reader.
+struct msvVTKFileSeriesReaderLoadJob
+{
+  vtkAlgorithm *Reader;
+  double Time;
+  bool UseTime;
+  int Piece[3];
+  vtkDataObject *Output;
+};
+
+//-----------------------------------------------------------------------------
+static VTK_THREAD_RETURN_TYPE msvLoadTimeSteps(void *arg)
+{
+  vtkMultiThreader::ThreadInfo *threadInfo =
+    static_cast<vtkMultiThreader::ThreadInfo*>(arg);
+  std::vector<msvVTKFileSeriesReaderLoadJob> *jobs =
+    static_cast<std::vector<msvVTKFileSeriesReaderLoadJob>*>(
+      threadInfo->UserData);
+  for (size_t i = threadInfo->ThreadID; i < jobs->size();
+       i += threadInfo->NumberOfThreads)
+    {
+    msvVTKFileSeriesReaderLoadJob &job = (*jobs)[i];
+    if (job.Reader)
+      {
+      job.Output = msvReadDetachedOutput(job.Reader,
+                                         job.UseTime ? &job.Time : 0,
+                                         job.Piece);
+      job.Reader = 0;
+      }
+    }
+  return VTK_THREAD_RETURN_VALUE;
+}
+
+//=============================================================================
+// A file whose time information is queried on its own reader.
+struct msvVTKFileSeriesReaderScanJob
+{
+  vtkAlgorithm *Reader;
+  vtkInformation *TimeInfo;
+};
+
+//-----------------------------------------------------------------------------
+static VTK_THREAD_RETURN_TYPE msvScanTimeInformation(void *arg)
+{
+  vtkMultiThreader::ThreadInfo *threadInfo =
+    static_cast<vtkMultiThreader::ThreadInfo*>(arg);
+  std::vector<msvVTKFileSeriesReaderScanJob> *jobs =
+    static_cast<std::vector<msvVTKFileSeriesReaderScanJob>*>(
+      threadInfo->UserData);
+  for (size_t i = threadInfo->ThreadID; i < jobs->size();
+       i += threadInfo->NumberOfThreads)
+    {
+    msvVTKFileSeriesReaderScanJob &job = (*jobs)[i];
+    job.Reader->UpdateInformation();
+    vtkInformation *readerInfo =
+      job.Reader->GetExecutive()->GetOutputInformation(0);
+    job.TimeInfo = vtkInformation::New();
+    job.TimeInfo->CopyEntry(readerInfo,
+                            vtkStreamingDemandDrivenPipeline::TIME_STEPS());
+    job.TimeInfo->CopyEntry(readerInfo,
+                            vtkStreamingDemandDrivenPipeline::TIME_RANGE());
+    job.Reader->Delete();
+    job.Reader = 0;
+    }
+  return VTK_THREAD_RETURN_VALUE;
+}
+
+//=============================================================================
+struct msvVTKFileSeriesReaderInternals
+{
+  std::vector<std::string> FileNames;
+  bool FileNameIsSet;
+  msvVTKFileSeriesReaderTimeRanges *TimeRanges;
+
+  // File index chosen in the last RequestUpdateExtent.
+  int UpdateIndex;
+  // True when the last RequestUpdateExtent was served with a temporal
+  // output, whose time steps are then read in RequestTemporalData.
+  bool TemporalRequest;
+  // Data object of the reader type, the type of the time steps of a
+  // temporal output.
+  vtkSmartPointer<vtkDataObject> TimeStepPrototype;
+  // True when each file holds a single time step, so a cached output can
+  // stand for a file whatever the requested time.
+  bool SingleStepFiles;
+  int LastReadAheadIndex;
+  int PlaybackDirection;
+  msvVTKFileSeriesReaderPrefetcher Prefetcher;
+
+  msvVTKFileSeriesReaderTimeIndex TimeIndex;
+  // Name of the time index file last read.
+  std::string TimeIndexFileRead;
+  // Inputs whose time information was assumed by the lazy time discovery.
+  std::set<int> AssumedInputs;
+
+  // Piece number, number of pieces and ghost levels of the last
+  // RequestUpdateExtent, and the ones the prefetch cache holds.
+  int UpdatePiece[3];
+  int CachedPiece[3];
+  // True when the requested piece is read from a share of the files.
+  bool SplitPieces;
+};
+
+//-----------------------------------------------------------------------------
+// Get the requested piece number, number of pieces and ghost levels.
+static void msvGetUpdatePiece(vtkInformation *outInfo, int piece[3])
+{
+  piece[0] = 0;
+  piece[1] = 1;
+  piece[2] = 0;
+  if (outInfo->Has(vtkStreamingDemandDrivenPipeline::UPDATE_PIECE_NUMBER()))
+    {
+    piece[0] =
+      outInfo->Get(vtkStreamingDemandDrivenPipeline::UPDATE_PIECE_NUMBER());
+    }
+  if (outInfo->Has(
+        vtkStreamingDemandDrivenPipeline::UPDATE_NUMBER_OF_PIECES()))
+    {
+    piece[1] = outInfo->Get(
+      vtkStreamingDemandDrivenPipeline::UPDATE_NUMBER_OF_PIECES());
+    }
+  if (outInfo->Has(
+        vtkStreamingDemandDrivenPipeline::UPDATE_NUMBER_OF_GHOST_LEVELS()))
+    {
+    piece[2] = outInfo->Get(
+      vtkStreamingDemandDrivenPipeline::UPDATE_NUMBER_OF_GHOST_LEVELS());
+    }
+}
+
+//-----------------------------------------------------------------------------
+// Clamp time to the time range of the input index, as the file may clip on
+// it.
+static double msvClampToInputTimeRange(
+  msvVTKFileSeriesReaderTimeRanges *timeRanges, int index, double time)
+{
+  VTK_CREATE(vtkInformation, inputInfo);
+  timeRanges->GetInputTimeInfo(index, inputInfo);
+  double *range =
+    inputInfo->Get(vtkStreamingDemandDrivenPipeline::TIME_RANGE());
+  if (range)
+    {
+    time = std::max(range[0], std::min(range[1], time));
+    }
+  return time;
+}
+
+//-----------------------------------------------------------------------------
+// Return a new information holding the time entries of srcInfo.
+static vtkSmartPointer<vtkInformation> msvNewTimeInformation(
+                                                       vtkInformation *srcInfo)
+{
+  VTK_CREATE(vtkInformation, info);
+  info->CopyEntry(srcInfo, vtkStreamingDemandDrivenPipeline::TIME_STEPS());
+  info->CopyEntry(srcInfo, vtkStreamingDemandDrivenPipeline::TIME_RANGE());
+  return info;
+}
+
+//-----------------------------------------------------------------------------
+// Return the start time of the input described by info.
+static double msvGetStartTime(vtkInformation *info)
+{
+  if (info->Has(vtkStreamingDemandDrivenPipeline::TIME_RANGE()))
+    {
+    return info->Get(vtkStreamingDemandDrivenPipeline::TIME_RANGE())[0];
+    }
+  if (info->Has(vtkStreamingDemandDrivenPipeline::TIME_STEPS()))
+    {
+    return info->Get(vtkStreamingDemandDrivenPipeline::TIME_STEPS())[0];
+    }
+  return 0.;
+}
+
+//-----------------------------------------------------------------------------
+// Return a copy of the time information in info, shifted by shift.
+static vtkSmartPointer<vtkInformation> msvShiftTimeInformation(
+                                           vtkInformation *info, double shift)
+{
+  VTK_CREATE(vtkInformation, shifted);
+  if (info->Has(vtkStreamingDemandDrivenPipeline::TIME_STEPS()))
+    {
+    double *timeSteps = info->Get(vtkStreamingDemandDrivenPipeline::TIME_STEPS());
+    int numTimeSteps = info->Length(vtkStreamingDemandDrivenPipeline::TIME_STEPS());
+    if (numTimeSteps == 0)
+      {
+      // A null array would remove the key.
+      double noTimeStep = 0.;
+      shifted->Set(vtkStreamingDemandDrivenPipeline::TIME_STEPS(),
+                   &noTimeStep, 0);
+      }
+    else
+      {
+      std::vector<double> shiftedSteps(numTimeSteps);
+      for (int i = 0; i < numTimeSteps; ++i)
+        {
+        shiftedSteps[i] = timeSteps[i] + shift;
+        }
+      shifted->Set(vtkStreamingDemandDrivenPipeline::TIME_STEPS(),
+                   &shiftedSteps[0], numTimeSteps);
+      }
+    }
+  if (info->Has(vtkStreamingDemandDrivenPipeline::TIME_RANGE()))
+    {
+    double *timeRange = info->Get(vtkStreamingDemandDrivenPipeline::TIME_RANGE());
+    double shiftedRange[2] = {timeRange[0] + shift, timeRange[1] + shift};
+    shifted->Set(vtkStreamingDemandDrivenPipeline::TIME_RANGE(),
+                 shiftedRange, 2);
+    }
+  return shifted;
+}
+
+//-----------------------------------------------------------------------------
+// Return true if info1 and info2 hold the same time information.
+static bool msvSameTimeInformation(vtkInformation *info1,
+                                   vtkInformation *info2)
+{
+  vtkInformationDoubleVectorKey *keys[2] = {
+    vtkStreamingDemandDrivenPipeline::TIME_STEPS(),
+    vtkStreamingDemandDrivenPipeline::TIME_RANGE()};
+  for (int k = 0; k < 2; ++k)
+    {
+    if (info1->Has(keys[k]) != info2->Has(keys[k]))
+      {
+      return false;
+      }
+    if (!info1->Has(keys[k]))
+      {
+      continue;
+      }
+    int length = info1->Length(keys[k]);
+    if (length != info2->Length(keys[k]))
+      {
+      return false;
+      }
+    double *values1 = info1->Get(keys[k]);
+    double *values2 = info2->Get(keys[k]);
+    for (int i = 0; i < length; ++i)
+      {
+      double tolerance = 1e-6 * std::max(1., std::fabs(values1[i]));
+      if (std::fabs(values1[i] - values2[i]) > tolerance)
+        {
+        return false;
+        }
+      }
+    }
+  return true;
+}
+
+//=============================================================================
+msvVTKFileSeriesReader::msvVTKFileSeriesReader()
+{
+  this->SetNumberOfInputPorts(0);
+  this->SetNumberOfOutputPorts(1);
+
+  this->Reader = 0;
+
+  this->HiddenReaderModification = 0;
+  this->SavedReaderModification = 0;
+
+  this->Internal = new msvVTKFileSeriesReaderInternals;
+  this->Internal->FileNameIsSet = false;
+  this->Internal->TimeRanges = new msvVTKFileSeriesReaderTimeRanges;
+  this->Internal->UpdateIndex = -1;
+  this->Internal->TemporalRequest = false;
+  this->Internal->SingleStepFiles = false;
+  this->Internal->LastReadAheadIndex = -1;
+  this->Internal->PlaybackDirection = 1;
+  this->Internal->UpdatePiece[0] = this->Internal->CachedPiece[0] = 0;
+  this->Internal->UpdatePiece[1] = this->Internal->CachedPiece[1] = 1;
+  this->Internal->UpdatePiece[2] = this->Internal->CachedPiece[2] = 0;
+  this->Internal->SplitPieces = false;
+
+  this->FileNameMethod = NULL;
+  //this->SetFileNameMethod("SetFileName");
+
+  this->MetaFileName = NULL;
+  this->UseMetaFile = 0;
+  this->CurrentFileName = 0;
+
+  this->IgnoreReaderTime = 0;
+  this->LazyTimeDiscovery = 0;
+  this->NumberOfScanThreads = 1;
+  this->TimeIndexFileName = NULL;
+
+  this->LastRequestInformationIndex = -1;
+
+  this->PieceMode = FORWARD_PIECES;
+  this->TemporalOutput = 0;
+
+  this->UsePrefetch = 0;
+  this->CacheSize = 8;
+  this->PrefetchDepth = 2;
+  this->NumberOfPrefetchThreads = 2;
+  this->CacheHits = 0;
+  this->CacheMisses = 0;
+}
+
+//-----------------------------------------------------------------------------
+msvVTKFileSeriesReader::~msvVTKFileSeriesReader()
+{
+  this->SetCurrentFileName(NULL);
+  this->SetMetaFileName(NULL);
+  this->SetTimeIndexFileName(NULL);
+  this->SetReader(NULL);
+  delete this->Internal->TimeRanges;
+  delete this->Internal;
+  this->SetFileNameMethod(0);
+}
+
+//----------------------------------------------------------------------------
+// Overload standard modified time function. If the internal reader is
+// modified, then this object is modified as well.
+unsigned long msvVTKFileSeriesReader::GetMTime()
+{
+  unsigned long mTime=this->vtkObject::GetMTime();
+
+  if ( this->Reader )
+    {
+    // In general, we want Modifieds in Reader to be reflected in this object's
+    // MTime.  However, we will also be making modifications to the Reader (such
+    // as changing the filename) that we want to suppress from the reporting.
+    // When this happens, we save the timestamp before our modification into
+    // this->SavedReaderModification and capture the resulting MTime in
+    // this->HiddenReaderModification.  If we run into that modification,
+    // suppress it by reporting the saved modification.
+    unsigned long readerMTime;
+    if (this->Reader->GetMTime() == this->HiddenReaderModification)
+      {
+      readerMTime = this->SavedReaderModification;
+      }
+    else
+      {
+      readerMTime = this->Reader->GetMTime();
+      }
+    mTime = ( readerMTime > mTime ? readerMTime : mTime );
+    }
+
+  return mTime;
+}
+
+//----------------------------------------------------------------------------
+void msvVTKFileSeriesReader::AddFileName(const char* name)
+{
+  this->Internal->FileNames.push_back(name);
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+void msvVTKFileSeriesReader::RemoveAllFileNames()
+{
+  this->Internal->FileNames.clear();
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+unsigned int msvVTKFileSeriesReader::GetNumberOfFileNames()
+{
+  return static_cast<unsigned int>(this->Internal->FileNames.size());
+}
+
+//----------------------------------------------------------------------------
+const char* msvVTKFileSeriesReader::GetFileName(unsigned int idx)
+{
+  if (idx >= this->Internal->FileNames.size())
+    {
+    return 0;
+    }
+  return this->Internal->FileNames[idx].c_str();
+}
+
+//----------------------------------------------------------------------------
+int msvVTKFileSeriesReader::ProcessRequest(vtkInformation* request,
+                                        vtkInformationVector** inputVector,
+                                        vtkInformationVector* outputVector)
+{
+  this->UpdateMetaData();
+
+  if (this->Reader)
+    {
+    // Make sure that there is a file to get information from.
+    if (request->Has(vtkDemandDrivenPipeline::REQUEST_DATA_OBJECT()))
+      {
+      if (!this->Internal->FileNameIsSet && (this->GetNumberOfFileNames() > 0))
+        {
+        this->SetReaderFileName(this->GetFileName(0));
+        this->Internal->FileNameIsSet = true;
+        }
+      }
+    // Our handling of these requests will call the reader's request in turn.
+    if (request->Has(vtkDemandDrivenPipeline::REQUEST_DATA_OBJECT()))
+      {
+      return this->RequestDataObject(request, inputVector, outputVector);
+      }
+    if (request->Has(vtkDemandDrivenPipeline::REQUEST_INFORMATION()))
+      {
+      return this->RequestInformation(request, inputVector, outputVector);
+      }
+    if (request->Has(vtkDemandDrivenPipeline::REQUEST_DATA()))
+      {
+      return this->RequestData(request, inputVector, outputVector);
+      }
+    // Let the reader process anything we did not handle ourselves.
+    int retVal = this->Reader->ProcessRequest(request,
+                                              inputVector,
+                                              outputVector);
+    // Additional processing requried by us.
+    if (request->Has(vtkStreamingDemandDrivenPipeline::REQUEST_UPDATE_EXTENT()))
+      {
+      this->RequestUpdateExtent(request, inputVector, outputVector);
+      }
+
+    return retVal;
+    }
+  vtkErrorMacro("No reader is defined. Cannot perform pipeline pass.");
+  return 0;
+}
+
+//----------------------------------------------------------------------------
+int msvVTKFileSeriesReader::RequestInformation(
+                                 vtkInformation* request,
+                                 vtkInformationVector** vtkNotUsed(inputVector),
+                                 vtkInformationVector* outputVector)
+{
+  vtkInformation *outInfo = outputVector->GetInformationObject(0);
+
+  this->Internal->TimeRanges->Reset();
+
+  // Whatever changed (files, reader or prefetch settings) invalidates what
+  // was read ahead.
+  if (this->UsePrefetch)
+    {
+    this->Internal->Prefetcher.Clear();
+    this->Internal->Prefetcher.SetCacheSize(
+      std::max(this->CacheSize, this->PrefetchDepth + 1));
+    }
+  else
+    {
+    this->Internal->Prefetcher.Stop();
+    }
+  this->Internal->SingleStepFiles = false;
+  this->Internal->LastReadAheadIndex = -1;
 
   int numFiles = static_cast<int>(this->GetNumberOfFileNames());
   if (numFiles < 1)
@@ -598,25 +1924,163 @@ int msvVTKFileSeriesReader::RequestInformation(
       outInfo->Set(vtkStreamingDemandDrivenPipeline::TIME_STEPS(), &time, 1);
       this->Internal->TimeRanges->AddTimeRange(i, outInfo);
       }
+    this->Internal->SingleStepFiles = true;
 
     this->UpdateOutputTimeRange();
     }
   else
     {
-    // Record the reported file time info.
-    this->Internal->TimeRanges->AddTimeRange(0, outInfo);
-
-    // Query all the other files for time info.
-    for (int i = 1; i < numFiles; i++)
-      {
-      this->RequestInformationForInput(i, request, outputVector);
-      this->Internal->TimeRanges->AddTimeRange(i, outInfo);
-      }
+    msvVTKFileSeriesReaderTimeIndex &timeIndex = this->Internal->TimeIndex;
+    if (this->TimeIndexFileName &&
+        this->Internal->TimeIndexFileRead != this->TimeIndexFileName)
+      {
+      // A missing index is not an error, it is written once complete.
+      timeIndex.Read(this->TimeIndexFileName);
+      this->Internal->TimeIndexFileRead = this->TimeIndexFileName;
+      }
+
+    // Record the reported file time info.
+    std::vector<vtkSmartPointer<vtkInformation> > inputInfos(numFiles);
+    inputInfos[0] = msvNewTimeInformation(outInfo);
+    timeIndex.Set(this->GetFileName(0), outInfo);
+
+    // Query all the other files for time info, unless it is already known
+    // from the time index. In lazy mode, only the last file is queried.
+    std::vector<int> filesToQuery;
+    for (int i = 1; i < numFiles; i++)
+      {
+      VTK_CREATE(vtkInformation, indexedInfo);
+      if (timeIndex.Get(this->GetFileName(i), indexedInfo))
+        {
+        inputInfos[i] = indexedInfo;
+        }
+      else if (!this->LazyTimeDiscovery || i == numFiles - 1)
+        {
+        filesToQuery.push_back(i);
+        }
+      }
+    if (this->NumberOfScanThreads > 1 && filesToQuery.size() > 1)
+      {
+      std::vector<vtkInformation*> scannedInfos(filesToQuery.size(), 0);
+      if (this->ScanTimeInformation(static_cast<int>(filesToQuery.size()),
+                                    &filesToQuery[0], &scannedInfos[0]))
+        {
+        // Merge in index order.
+        for (size_t f = 0; f < filesToQuery.size(); f++)
+          {
+          inputInfos[filesToQuery[f]] = scannedInfos[f];
+          scannedInfos[f]->Delete();
+          }
+        }
+      }
+    for (size_t f = 0; f < filesToQuery.size(); f++)
+      {
+      int i = filesToQuery[f];
+      if (!inputInfos[i])
+        {
+        this->RequestInformationForInput(i, request, outputVector);
+        inputInfos[i] = msvNewTimeInformation(outInfo);
+        }
+      timeIndex.Set(this->GetFileName(i), inputInfos[i]);
+      }
+
+    // Assume the time information of the files left by shifting the
+    // closest known files around them with a constant stride.
+    this->Internal->AssumedInputs.clear();
+    int lower = 0;
+    for (int i = 1; i < numFiles; i++)
+      {
+      if (inputInfos[i])
+        {
+        lower = i;
+        continue;
+        }
+      int upper = i + 1;
+      while (!inputInfos[upper])
+        {
+        ++upper;
+        }
+      double stride = (msvGetStartTime(inputInfos[upper]) -
+                       msvGetStartTime(inputInfos[lower])) / (upper - lower);
+      inputInfos[i] = msvShiftTimeInformation(inputInfos[lower],
+                                              stride * (i - lower));
+      this->Internal->AssumedInputs.insert(i);
+      }
+
+    for (int i = 0; i < numFiles; i++)
+      {
+      this->Internal->TimeRanges->AddTimeRange(i, inputInfos[i]);
+      }
+    this->UpdateTimeIndexFile();
+    }
+
+  // Now that we have collected all of the time information, set the aggregate
+  // time steps in the output.
+  this->Internal->TimeRanges->GetAggregateTimeInfo(outInfo);
+
+  if (this->PieceMode == SPLIT_FILES)
+    {
+    outInfo->Set(vtkStreamingDemandDrivenPipeline::MAXIMUM_NUMBER_OF_PIECES(),
+                 -1);
+    }
+  return 1;
+}
+
+//----------------------------------------------------------------------------
+int msvVTKFileSeriesReader::RequestDataObject(
+                                 vtkInformation* request,
+                                 vtkInformationVector** inputVector,
+                                 vtkInformationVector* outputVector)
+{
+  vtkInformation *outInfo = outputVector->GetInformationObject(0);
+  vtkInformation *portInfo = this->GetOutputPortInformation(0);
+  vtkInformation *readerPortInfo = this->Reader->GetOutputPortInformation(0);
+  vtkDataObject *output = outInfo->Get(vtkDataObject::DATA_OBJECT());
+  if (!this->TemporalOutput)
+    {
+    this->Internal->TimeStepPrototype = 0;
+    portInfo->CopyEntry(readerPortInfo, vtkDataObject::DATA_TYPE_NAME());
+    if (vtkTemporalDataSet::SafeDownCast(output))
+      {
+      // Back from a temporal output, let the reader create its own.
+      output->SetPipelineInformation(0);
+      }
+    return this->Reader->ProcessRequest(request, inputVector, outputVector);
+    }
+
+  // The reader creates its output in a temporary information if its type
+  // depends on the file, the type of its output port is used otherwise.
+  VTK_CREATE(vtkInformationVector, tempOutputVector);
+  VTK_CREATE(vtkInformation, tempOutInfo);
+  tempOutputVector->Append(tempOutInfo);
+  if (!this->Reader->ProcessRequest(request, inputVector, tempOutputVector))
+    {
+    return 0;
+    }
+  vtkDataObject *timeStep = tempOutInfo->Get(vtkDataObject::DATA_OBJECT());
+  if (timeStep)
+    {
+    this->Internal->TimeStepPrototype.TakeReference(timeStep->NewInstance());
+    timeStep->SetPipelineInformation(0);
+    }
+  else
+    {
+    this->Internal->TimeStepPrototype.TakeReference(
+      vtkDataObjectTypes::NewDataObject(
+        readerPortInfo->Get(vtkDataObject::DATA_TYPE_NAME())));
+    }
+  if (!this->Internal->TimeStepPrototype)
+    {
+    vtkErrorMacro("Could not create the time steps of the reader type.");
+    return 0;
     }
 
-  // Now that we have collected all of the time information, set the aggregate
-  // time steps in the output.
-  this->Internal->TimeRanges->GetAggregateTimeInfo(outInfo);
+  portInfo->Set(vtkDataObject::DATA_TYPE_NAME(), "vtkTemporalDataSet");
+  if (!vtkTemporalDataSet::SafeDownCast(output))
+    {
+    VTK_CREATE(vtkTemporalDataSet, temporalOutput);
+    temporalOutput->SetPipelineInformation(outInfo);
+    }
   return 1;
 }
 
@@ -627,15 +2091,32 @@ int msvVTKFileSeriesReader::RequestUpdateExtent(
                                  vtkInformationVector* outputVector)
 {
   vtkInformation *outInfo = outputVector->GetInformationObject(0);
+
+  msvGetUpdatePiece(outInfo, this->Internal->UpdatePiece);
+  this->Internal->SplitPieces = false;
+  if (!std::equal(this->Internal->UpdatePiece, this->Internal->UpdatePiece + 3,
+                  this->Internal->CachedPiece))
+    {
+    // The outputs read ahead belong to another piece.
+    this->Internal->Prefetcher.Clear();
+    std::copy(this->Internal->UpdatePiece, this->Internal->UpdatePiece + 3,
+              this->Internal->CachedPiece);
+    }
+
+  this->ValidateRequestedInputs(outInfo);
   std::set<int> inputs = this->Internal->TimeRanges->ChooseInputs(outInfo);
-  if (inputs.size() > 1)
+  this->Internal->TemporalRequest = false;
+  if (inputs.size() > 1 && !this->TemporalOutput)
     {
-    vtkErrorMacro("vtkTemporalDataSet not fully supported.");
-    // To support readers that give vtkTemporalDataSet, we would have to iterate
-    // over all of the readers in RequestData and then combine the outputs into
-    // some saved data set.
+    vtkErrorMacro("Time steps spanning several files require TemporalOutput.");
     return 0;
     }
+  if (this->TemporalOutput && !inputs.empty())
+    {
+    // Each file is read on its own in RequestTemporalData.
+    this->Internal->TemporalRequest = true;
+    return 1;
+    }
   if (inputs.size() == 0)
     {
     vtkErrorMacro("Inputs are not set.");
@@ -651,6 +2132,22 @@ int msvVTKFileSeriesReader::RequestUpdateExtent(
     index = -1;
     }
 
+  this->Internal->UpdateIndex = index;
+
+  // The files of the piece are read on their own in RequestData.
+  this->Internal->SplitPieces = this->SplitsFiles(index);
+  if (this->Internal->SplitPieces)
+    {
+    return 1;
+    }
+
+  // Files already read ahead do not need the reader to be set up.
+  if (this->UsePrefetch && this->Internal->SingleStepFiles && index >= 0 &&
+      this->Internal->Prefetcher.IsCachedOrPending(index))
+    {
+    return 1;
+    }
+
   // Make sure that the reader file name is set correctly and that
   // RequestInformation has been called.
   this->RequestInformationForInput(index);
@@ -677,17 +2174,76 @@ int msvVTKFileSeriesReader::RequestData(vtkInformation *request,
                                      vtkInformationVector **inputVector,
                                      vtkInformationVector *outputVector)
 {
-  // We have modified the TIME_STEPS information in the output vector.  Some
-  // readers (e.g. the Exodus reader) reuse this array to get time indices.
-  // Just in case, restore the vector.
   vtkInformation *outInfo = outputVector->GetInformationObject(0);
-  this->Internal->TimeRanges->GetInputTimeInfo(
-                                     this->LastRequestInformationIndex,outInfo);
+  if (this->Internal->TemporalRequest && this->GetNumberOfFileNames() > 0)
+    {
+    return this->RequestTemporalData(request, inputVector, outputVector);
+    }
+  vtkDataObject *output = outInfo->Get(vtkDataObject::DATA_OBJECT());
+  int index = this->Internal->UpdateIndex;
+  if (this->Internal->SplitPieces && index >= 0 && output)
+    {
+    double time = 0.;
+    bool useTime = !this->Internal->SingleStepFiles &&
+      outInfo->Has(vtkStreamingDemandDrivenPipeline::UPDATE_TIME_STEPS());
+    if (useTime)
+      {
+      time = outInfo->Get(
+        vtkStreamingDemandDrivenPipeline::UPDATE_TIME_STEPS())[0];
+      }
+    vtkDataObject *data = this->ReadPieceFiles(index, useTime ? &time : 0,
+                                               request, inputVector, outInfo);
+    if (!data)
+      {
+      return 0;
+      }
+    output->ShallowCopy(data);
+    data->Delete();
+    return 1;
+    }
+
+  bool useCache = this->UsePrefetch && this->Internal->SingleStepFiles &&
+                  index >= 0 && output != 0;
 
   int retVal = -1;
   if (this->GetNumberOfFileNames() > 0)
     {
-    retVal = this->Reader->ProcessRequest(request, inputVector, outputVector);
+    vtkDataObject *cached =
+      useCache ? this->Internal->Prefetcher.Get(index) : 0;
+    if (cached)
+      {
+      output->ShallowCopy(cached);
+      ++this->CacheHits;
+      retVal = 1;
+      }
+    else
+      {
+      // RequestUpdateExtent skipped the reader set up if the file was
+      // cached at that time.
+      if (useCache)
+        {
+        this->RequestInformationForInput(index);
+        }
+
+      // We have modified the TIME_STEPS information in the output vector.
+      // Some readers (e.g. the Exodus reader) reuse this array to get time
+      // indices. Just in case, restore the vector.
+      this->Internal->TimeRanges->GetInputTimeInfo(
+                                     this->LastRequestInformationIndex,outInfo);
+      retVal = this->Reader->ProcessRequest(request, inputVector, outputVector);
+      if (useCache && retVal)
+        {
+        ++this->CacheMisses;
+        vtkDataObject *copy = output->NewInstance();
+        copy->ShallowCopy(output);
+        this->Internal->Prefetcher.Insert(index, copy);
+        copy->Delete();
+        }
+      }
+    if (useCache)
+      {
+      this->ScheduleReadAhead(index);
+      }
     // Now restore the information.
     this->Internal->TimeRanges->GetAggregateTimeInfo(outInfo);
     }
@@ -695,6 +2251,344 @@ int msvVTKFileSeriesReader::RequestData(vtkInformation *request,
   return retVal;
 }
 
+//-----------------------------------------------------------------------------
+int msvVTKFileSeriesReader::RequestTemporalData(
+                                            vtkInformation *request,
+                                            vtkInformationVector **inputVector,
+                                            vtkInformationVector *outputVector)
+{
+  vtkInformation *outInfo = outputVector->GetInformationObject(0);
+  int numUpTimes =
+    outInfo->Length(vtkStreamingDemandDrivenPipeline::UPDATE_TIME_STEPS());
+  double *upTimes =
+    outInfo->Get(vtkStreamingDemandDrivenPipeline::UPDATE_TIME_STEPS());
+  std::vector<double> times(upTimes, upTimes + numUpTimes);
+  if (times.empty())
+    {
+    // No time requested, the first time step stands for the series.
+    double *timeSteps =
+      outInfo->Get(vtkStreamingDemandDrivenPipeline::TIME_STEPS());
+    times.push_back(timeSteps ? timeSteps[0] : 0.);
+    }
+
+  vtkTemporalDataSet *output = vtkTemporalDataSet::SafeDownCast(
+    outInfo->Get(vtkDataObject::DATA_OBJECT()));
+  if (!output)
+    {
+    vtkErrorMacro("The output is not a vtkTemporalDataSet.");
+    return 0;
+    }
+
+  // Read each time step: from the prefetch cache when possible, on its own
+  // reader and thread when the concrete reader supports it, otherwise one
+  // after the other with the internal reader.
+  bool useCache = this->UsePrefetch && this->Internal->SingleStepFiles;
+  std::vector<msvVTKFileSeriesReaderLoadJob> jobs(times.size());
+  std::vector<bool> split(times.size(), false);
+  std::vector<int> indices(times.size());
+  int numberOfReaders = 0;
+  for (size_t i = 0; i < times.size(); ++i)
+    {
+    msvVTKFileSeriesReaderLoadJob &job = jobs[i];
+    indices[i] = this->Internal->TimeRanges->GetIndexForTime(times[i]);
+    job.Reader = 0;
+    job.Output = 0;
+    job.UseTime = !this->Internal->SingleStepFiles;
+    job.Time = times[i];
+    std::copy(this->Internal->UpdatePiece, this->Internal->UpdatePiece + 3,
+              job.Piece);
+    split[i] = this->SplitsFiles(indices[i]);
+    if (split[i])
+      {
+      // The share of the piece is read in the loop below.
+      continue;
+      }
+    if (job.UseTime)
+      {
+      job.Time = msvClampToInputTimeRange(this->Internal->TimeRanges,
+                                          indices[i], job.Time);
+      }
+    vtkDataObject *cached =
+      useCache ? this->Internal->Prefetcher.Get(indices[i]) : 0;
+    if (cached)
+      {
+      job.Output = cached->NewInstance();
+      job.Output->ShallowCopy(cached);
+      ++this->CacheHits;
+      continue;
+      }
+    job.Reader = this->NewReaderForFile(this->GetFileName(indices[i]));
+    numberOfReaders += (job.Reader ? 1 : 0);
+    }
+
+  if (numberOfReaders > 0)
+    {
+    VTK_CREATE(vtkMultiThreader, threader);
+    threader->SetNumberOfThreads(
+      std::min(numberOfReaders, threader->GetNumberOfThreads()));
+    threader->SetSingleMethod(msvLoadTimeSteps, &jobs);
+    threader->SingleMethodExecute();
+    }
+
+  int retVal = 1;
+  for (size_t i = 0; i < jobs.size(); ++i)
+    {
+    if (split[i])
+      {
+      jobs[i].Output =
+        this->ReadPieceFiles(indices[i], jobs[i].UseTime ? &jobs[i].Time : 0,
+                             request, inputVector, outInfo);
+      }
+    else if (!jobs[i].Output && !jobs[i].Reader)
+      {
+      jobs[i].Output =
+        this->ReadTimeStep(indices[i], jobs[i].UseTime ? &jobs[i].Time : 0,
+                           request, inputVector, outInfo);
+      }
+    if (!jobs[i].Output)
+      {
+      vtkErrorMacro(<< "Could not read time step " << times[i]);
+      retVal = 0;
+      }
+    else if (useCache && !split[i])
+      {
+      ++this->CacheMisses;
+      vtkDataObject *copy = jobs[i].Output->NewInstance();
+      copy->ShallowCopy(jobs[i].Output);
+      this->Internal->Prefetcher.Insert(indices[i], copy);
+      copy->Delete();
+      }
+    }
+
+  for (size_t i = 0; i < jobs.size(); ++i)
+    {
+    if (jobs[i].Output)
+      {
+      jobs[i].Output->GetInformation()->Set(
+        vtkDataObject::DATA_TIME_STEPS(), &times[i], 1);
+      output->SetTimeStep(static_cast<unsigned int>(i), jobs[i].Output);
+      jobs[i].Output->Delete();
+      }
+    }
+  output->GetInformation()->Set(vtkDataObject::DATA_TIME_STEPS(),
+                                &times[0], static_cast<int>(times.size()));
+
+  if (useCache && !indices.empty())
+    {
+    this->ScheduleReadAhead(indices.back());
+    }
+  return retVal;
+}
+
+//-----------------------------------------------------------------------------
+vtkDataObject* msvVTKFileSeriesReader::ReadTimeStep(
+                                            int index,
+                                            const double *time,
+                                            vtkInformation *request,
+                                            vtkInformationVector **inputVector,
+                                            vtkInformation *outInfo)
+{
+  vtkDataObject *prototype = this->TemporalOutput ?
+    this->Internal->TimeStepPrototype.GetPointer() :
+    outInfo->Get(vtkDataObject::DATA_OBJECT());
+  if (!prototype)
+    {
+    return 0;
+    }
+  this->RequestInformationForInput(index);
+
+  // Let the reader fill a new data object through a temporary output
+  // information, as if it were asked for this time step only.
+  VTK_CREATE(vtkInformationVector, tempOutputVector);
+  VTK_CREATE(vtkInformation, tempOutInfo);
+  tempOutputVector->Append(tempOutInfo);
+  this->Internal->TimeRanges->GetInputTimeInfo(index, tempOutInfo);
+  if (this->PieceMode == SPLIT_FILES)
+    {
+    // The pieces are made of whole files.
+    tempOutInfo->Set(
+      vtkStreamingDemandDrivenPipeline::UPDATE_PIECE_NUMBER(), 0);
+    tempOutInfo->Set(
+      vtkStreamingDemandDrivenPipeline::UPDATE_NUMBER_OF_PIECES(), 1);
+    tempOutInfo->Set(
+      vtkStreamingDemandDrivenPipeline::UPDATE_NUMBER_OF_GHOST_LEVELS(), 0);
+    }
+  else
+    {
+    tempOutInfo->CopyEntry(outInfo,
+      vtkStreamingDemandDrivenPipeline::UPDATE_PIECE_NUMBER());
+    tempOutInfo->CopyEntry(outInfo,
+      vtkStreamingDemandDrivenPipeline::UPDATE_NUMBER_OF_PIECES());
+    tempOutInfo->CopyEntry(outInfo,
+      vtkStreamingDemandDrivenPipeline::UPDATE_NUMBER_OF_GHOST_LEVELS());
+    }
+  if (time)
+    {
+    tempOutInfo->Set(vtkStreamingDemandDrivenPipeline::UPDATE_TIME_STEPS(),
+                     const_cast<double*>(time), 1);
+    }
+  vtkDataObject *data = prototype->NewInstance();
+  data->SetPipelineInformation(tempOutInfo);
+  int retVal = this->Reader->ProcessRequest(request, inputVector,
+                                            tempOutputVector);
+  data->SetPipelineInformation(0);
+  if (!retVal)
+    {
+    data->Delete();
+    return 0;
+    }
+  return data;
+}
+
+//-----------------------------------------------------------------------------
+bool msvVTKFileSeriesReader::SplitsFiles(int index)
+{
+  if (this->PieceMode != SPLIT_FILES || index < 0)
+    {
+    return false;
+    }
+  return this->Internal->UpdatePiece[1] > 1;
+}
+
+//-----------------------------------------------------------------------------
+vtkDataObject* msvVTKFileSeriesReader::ReadPieceFiles(
+                                            int index,
+                                            const double *time,
+                                            vtkInformation *request,
+                                            vtkInformationVector **inputVector,
+                                            vtkInformation *outInfo)
+{
+  vtkDataObject *prototype = this->TemporalOutput ?
+    this->Internal->TimeStepPrototype.GetPointer() :
+    outInfo->Get(vtkDataObject::DATA_OBJECT());
+  if (!prototype)
+    {
+    return 0;
+    }
+
+  // Contiguous share of the files of the time step.
+  std::vector<int> files =
+    this->Internal->TimeRanges->GetInputsStartingWith(index);
+  if (files.empty())
+    {
+    files.push_back(index);
+    }
+  const int piece = this->Internal->UpdatePiece[0];
+  const int numPieces = std::max(this->Internal->UpdatePiece[1], 1);
+  size_t first = files.size() * piece / numPieces;
+  size_t last = files.size() * (piece + 1) / numPieces;
+
+  std::vector<vtkSmartPointer<vtkDataObject> > pieceData;
+  for (size_t i = first; i < last; ++i)
+    {
+    double fileTime = 0.;
+    if (time)
+      {
+      fileTime = msvClampToInputTimeRange(this->Internal->TimeRanges,
+                                          files[i], *time);
+      }
+    vtkDataObject *data = this->ReadTimeStep(files[i], time ? &fileTime : 0,
+                                             request, inputVector, outInfo);
+    if (!data)
+      {
+      vtkErrorMacro(<< "Could not read " << this->GetFileName(files[i]));
+      return 0;
+      }
+    pieceData.push_back(data);
+    data->Delete();
+    }
+
+  if (pieceData.empty())
+    {
+    // Nothing to read for this piece.
+    return prototype->NewInstance();
+    }
+  if (pieceData.size() == 1)
+    {
+    pieceData[0]->Register(0);
+    return pieceData[0];
+    }
+
+  vtkDataObject *output = prototype->NewInstance();
+  if (vtkPolyData::SafeDownCast(prototype))
+    {
+    VTK_CREATE(vtkAppendPolyData, append);
+    for (size_t i = 0; i < pieceData.size(); ++i)
+      {
+      append->AddInput(vtkPolyData::SafeDownCast(pieceData[i]));
+      }
+    append->Update();
+    output->ShallowCopy(append->GetOutput());
+    }
+  else if (vtkUnstructuredGrid::SafeDownCast(prototype))
+    {
+    VTK_CREATE(vtkAppendFilter, append);
+    for (size_t i = 0; i < pieceData.size(); ++i)
+      {
+      append->AddInput(vtkDataSet::SafeDownCast(pieceData[i]));
+      }
+    append->Update();
+    output->ShallowCopy(append->GetOutput());
+    }
+  else
+    {
+    vtkWarningMacro(<< prototype->GetClassName() << " files can't be "
+                    << "appended, piece " << piece << " only gets the first "
+                    << "of its " << pieceData.size() << " files.");
+    output->ShallowCopy(pieceData[0]);
+    }
+  return output;
+}
+
+//-----------------------------------------------------------------------------
+void msvVTKFileSeriesReader::ScheduleReadAhead(int index)
+{
+  msvVTKFileSeriesReaderInternals *internal = this->Internal;
+
+  // Small steps give the playback direction, larger jumps (scrubbing,
+  // looping back to the first step) keep the current one.
+  int delta = index - internal->LastReadAheadIndex;
+  if (internal->LastReadAheadIndex >= 0 && delta != 0 &&
+      std::abs(delta) <= this->PrefetchDepth + 1)
+    {
+    internal->PlaybackDirection = (delta > 0 ? 1 : -1);
+    }
+  internal->LastReadAheadIndex = index;
+
+  int numFiles = static_cast<int>(this->GetNumberOfFileNames());
+  for (int step = 1; step <= this->PrefetchDepth; ++step)
+    {
+    int next = index + step * internal->PlaybackDirection;
+    if (next < 0 || next >= numFiles ||
+        internal->Prefetcher.IsCachedOrPending(next))
+      {
+      continue;
+      }
+    vtkAlgorithm *reader = this->NewReaderForFile(this->GetFileName(next));
+    if (!reader)
+      {
+      // The concrete reader does not support reading on other threads.
+      return;
+      }
+    internal->Prefetcher.Start(this->NumberOfPrefetchThreads);
+    internal->Prefetcher.Schedule(next, reader, internal->UpdatePiece);
+    }
+}
+
+//-----------------------------------------------------------------------------
+vtkAlgorithm* msvVTKFileSeriesReader::NewReaderForFile(
+                                           const char* vtkNotUsed(fname))
+{
+  return 0;
+}
+
+//-----------------------------------------------------------------------------
+void msvVTKFileSeriesReader::ResetCacheStatistics()
+{
+  this->CacheHits = 0;
+  this->CacheMisses = 0;
+}
+
 //-----------------------------------------------------------------------------
 int msvVTKFileSeriesReader::RequestInformationForInput(
                                              int index,
@@ -743,6 +2637,155 @@ int msvVTKFileSeriesReader::RequestInformationForInput(
   return 1;
 }
 
+//-----------------------------------------------------------------------------
+int msvVTKFileSeriesReader::ScanTimeInformation(int numberOfFiles,
+                                                const int *indices,
+                                                vtkInformation **timeInfos)
+{
+  std::vector<msvVTKFileSeriesReaderScanJob> jobs;
+  for (int f = 0; f < numberOfFiles; f++)
+    {
+    msvVTKFileSeriesReaderScanJob job;
+    job.Reader = this->NewReaderForFile(this->GetFileName(indices[f]));
+    job.TimeInfo = 0;
+    if (!job.Reader)
+      {
+      // The concrete reader can't be cloned, the files must be queried one
+      // after the other on the internal reader.
+      for (size_t j = 0; j < jobs.size(); j++)
+        {
+        jobs[j].Reader->Delete();
+        }
+      return 0;
+      }
+    jobs.push_back(job);
+    }
+  if (jobs.empty())
+    {
+    return 1;
+    }
+
+  VTK_CREATE(vtkMultiThreader, threader);
+  threader->SetNumberOfThreads(
+    std::min(this->NumberOfScanThreads, numberOfFiles));
+  threader->SetSingleMethod(msvScanTimeInformation, &jobs);
+  threader->SingleMethodExecute();
+
+  for (int f = 0; f < numberOfFiles; f++)
+    {
+    timeInfos[f] = jobs[f].TimeInfo;
+    }
+  return 1;
+}
+
+//-----------------------------------------------------------------------------
+void msvVTKFileSeriesReader::ValidateRequestedInputs(vtkInformation *outInfo)
+{
+  msvVTKFileSeriesReaderTimeRanges *timeRanges = this->Internal->TimeRanges;
+  std::set<int> &assumedInputs = this->Internal->AssumedInputs;
+  // Correcting the time ranges may change the inputs covering the requested
+  // times, so choose them again until they and the inputs bounding them are
+  // all known. Each pass validates at least one input.
+  while (!assumedInputs.empty())
+    {
+    std::set<int> inputs = timeRanges->ChooseInputs(outInfo);
+    std::set<int> files;
+    for (std::set<int>::iterator it = inputs.begin(); it != inputs.end(); ++it)
+      {
+      files.insert(*it);
+      files.insert(timeRanges->GetNextInput(*it));
+      }
+    if (!this->TemporalOutput && !inputs.empty() &&
+        this->SplitsFiles(*inputs.begin()))
+      {
+      std::vector<int> pieceFiles =
+        timeRanges->GetInputsStartingWith(*inputs.begin());
+      files.insert(pieceFiles.begin(), pieceFiles.end());
+      }
+    bool validated = false;
+    for (std::set<int>::iterator it = files.begin(); it != files.end(); ++it)
+      {
+      if (assumedInputs.count(*it))
+        {
+        this->ValidateTimeInformation(*it);
+        validated = true;
+        }
+      }
+    if (!validated)
+      {
+      return;
+      }
+    }
+}
+
+//-----------------------------------------------------------------------------
+void msvVTKFileSeriesReader::ValidateTimeInformation(int index)
+{
+  VTK_CREATE(vtkInformationVector, tempOutputVector);
+  VTK_CREATE(vtkInformation, tempOutputInfo);
+  tempOutputVector->Append(tempOutputInfo);
+  this->RequestInformationForInput(index, NULL, tempOutputVector);
+  this->Internal->AssumedInputs.erase(index);
+  this->Internal->TimeIndex.Set(this->GetFileName(index), tempOutputInfo);
+
+  VTK_CREATE(vtkInformation, assumedInfo);
+  this->Internal->TimeRanges->GetInputTimeInfo(index, assumedInfo);
+  if (!msvSameTimeInformation(assumedInfo, tempOutputInfo))
+    {
+    // The aggregate time steps are already out; correct them in place
+    // rather than modifying the reader in the middle of its own update.
+    this->Internal->TimeRanges->AddTimeRange(index, tempOutputInfo);
+    this->Internal->TimeRanges->GetAggregateTimeInfo(
+      this->GetExecutive()->GetOutputInformation(0));
+    }
+  if (this->Internal->AssumedInputs.empty())
+    {
+    this->UpdateTimeIndexFile();
+    }
+}
+
+//-----------------------------------------------------------------------------
+int msvVTKFileSeriesReader::WriteTimeIndex(const char *indexFileName)
+{
+  if (!this->Reader || !indexFileName)
+    {
+    vtkErrorMacro("A reader and an index file name are required.");
+    return 0;
+    }
+  this->UpdateMetaData();
+
+  int numFiles = static_cast<int>(this->GetNumberOfFileNames());
+  for (int i = 0; i < numFiles; i++)
+    {
+    VTK_CREATE(vtkInformationVector, tempOutputVector);
+    VTK_CREATE(vtkInformation, tempOutputInfo);
+    tempOutputVector->Append(tempOutputInfo);
+    this->RequestInformationForInput(i, NULL, tempOutputVector);
+    this->Internal->TimeIndex.Set(this->GetFileName(i), tempOutputInfo);
+    }
+  if (!this->Internal->TimeIndex.Write(indexFileName, true))
+    {
+    vtkErrorMacro(<< "Could not write time index file " << indexFileName);
+    return 0;
+    }
+  return 1;
+}
+
+//-----------------------------------------------------------------------------
+void msvVTKFileSeriesReader::UpdateTimeIndexFile()
+{
+  if (!this->TimeIndexFileName || !this->Internal->AssumedInputs.empty() ||
+      !this->Internal->TimeIndex.IsOutOfDate())
+    {
+    return;
+    }
+  if (!this->Internal->TimeIndex.Write(this->TimeIndexFileName, false))
+    {
+    vtkWarningMacro(<< "Could not write time index file "
+                    << this->TimeIndexFileName);
+    }
+}
+
 //-----------------------------------------------------------------------------
 void msvVTKFileSeriesReader::SetCurrentFileName(const char *fname)
 {
@@ -772,6 +2815,11 @@ int msvVTKFileSeriesReader::FillOutputPortInformation(int port,
 {
   if (this->Reader)
     {
+    if (this->TemporalOutput)
+      {
+      info->Set(vtkDataObject::DATA_TYPE_NAME(), "vtkTemporalDataSet");
+      return 1;
+      }
     vtkInformation* rinfo = this->Reader->GetOutputPortInformation(port);
     info->CopyEntry(rinfo, vtkDataObject::DATA_TYPE_NAME());
     return 1;
@@ -898,4 +2946,17 @@ void msvVTKFileSeriesReader::PrintSelf(ostream& os, vtkIndent indent)
      << (this->MetaFileName?this->MetaFileName:"(none)") << endl;
   os << indent << "UseMetaFile: " << this->UseMetaFile << endl;
   os << indent << "IgnoreReaderTime: " << this->IgnoreReaderTime << endl;
+  os << indent << "LazyTimeDiscovery: " << this->LazyTimeDiscovery << endl;
+  os << indent << "NumberOfScanThreads: " << this->NumberOfScanThreads << endl;
+  os << indent << "TimeIndexFileName: "
+     << (this->TimeIndexFileName?this->TimeIndexFileName:"(none)") << endl;
+  os << indent << "PieceMode: " << this->PieceMode << endl;
+  os << indent << "TemporalOutput: " << this->TemporalOutput << endl;
+  os << indent << "UsePrefetch: " << this->UsePrefetch << endl;
+  os << indent << "CacheSize: " << this->CacheSize << endl;
+  os << indent << "PrefetchDepth: " << this->PrefetchDepth << endl;
+  os << indent << "NumberOfPrefetchThreads: "
+     << this->NumberOfPrefetchThreads << endl;
+  os << indent << "CacheHits: " << this->CacheHits << endl;
+  os << indent << "CacheMisses: " << this->CacheMisses << endl;
 }
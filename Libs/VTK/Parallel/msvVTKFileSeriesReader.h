@@ -56,6 +56,15 @@
 // file with the correct time.  Overlaps are handled by requesting data from the
 // file with the upper range the farthest in the future.
 //
+// With TemporalOutput on, the output is a vtkTemporalDataSet: when several
+// time steps spanning more than one file are requested at once (e.g. by
+// vtkTemporalInterpolator), every file needed is read and the time steps are
+// returned together.
+//
+// Piece requests (e.g. one piece per MPI rank) are either forwarded to the
+// internal reader when it can read a piece of a file, or served by splitting
+// the files sharing a time range across the pieces. See PieceMode.
+//
 // There are two ways to specify a series of files.  The first way is by adding
 // the filenames one at a time with the AddFileName method.  The second way is
 // by providing a single "meta" file.  This meta file is a simple text file that
@@ -150,6 +159,45 @@ public:
   vtkSetMacro(IgnoreReaderTime, int);
   vtkBooleanMacro(IgnoreReaderTime, int);
 
+  // Description:
+  // If true and the reader provides time, RequestInformation only queries
+  // the first and the last files of the series. The time information of the
+  // files in between is taken from the time index when it is up to date, or
+  // assumed by shifting the closest known files with a constant stride. An
+  // assumed file is validated the first time it is requested; when it does
+  // not match the assumption, the aggregate time steps of the output
+  // information are corrected in place, without modifying the reader.
+  // False by default.
+  vtkGetMacro(LazyTimeDiscovery, int);
+  vtkSetMacro(LazyTimeDiscovery, int);
+  vtkBooleanMacro(LazyTimeDiscovery, int);
+
+  // Description:
+  // Number of threads querying the time information of the files in
+  // RequestInformation, each on its own reader created with
+  // NewReaderForFile(). The files are queried one after the other with the
+  // internal reader when 1 or when the concrete reader does not support it.
+  // 1 by default.
+  vtkGetMacro(NumberOfScanThreads, int);
+  vtkSetClampMacro(NumberOfScanThreads, int, 1, VTK_LARGE_INTEGER);
+
+  // Description:
+  // Get/set the name of the binary sidecar file persisting the time
+  // information of each file (name, modification time, size, hash of the
+  // first 64 KiB, time steps and range). When set, the index is
+  // memory-mapped in RequestInformation and entries matching the files on
+  // disk (same modification time and size, or same size and hash) are trusted
+  // instead of querying the files. It is written back once every file of the
+  // series is known. None by default.
+  vtkGetStringMacro(TimeIndexFileName);
+  vtkSetStringMacro(TimeIndexFileName);
+
+  // Description:
+  // Query the time information of every file of the series and write it,
+  // with a hash of the beginning of each file, to the time index file
+  // indexFileName. Returns 0 on failure.
+  virtual int WriteTimeIndex(const char *indexFileName);
+
   // Description:
   // Get/Set the output time range.
   // It lets you specifying you own time range if
@@ -165,6 +213,71 @@ public:
   // Update TimeRange linearly for each file when user has set one.
   void UpdateOutputTimeRange();
 
+  // Description:
+  // If true, the time steps following the current one (in the playback
+  // direction) are read ahead on background threads and kept, with the
+  // recently used ones, in a cache of shallow copied outputs. Cached time
+  // steps are served without touching the disk. Only used when each file
+  // holds a single time step and the concrete reader implements
+  // NewReaderForFile(). False by default.
+  vtkGetMacro(UsePrefetch, int);
+  vtkSetMacro(UsePrefetch, int);
+  vtkBooleanMacro(UsePrefetch, int);
+
+  // Description:
+  // Maximum number of outputs kept in the prefetch cache. It is never less
+  // than PrefetchDepth + 1. 8 by default.
+  vtkGetMacro(CacheSize, int);
+  vtkSetClampMacro(CacheSize, int, 1, VTK_LARGE_INTEGER);
+
+  // Description:
+  // Number of time steps read ahead of the requested one. 2 by default.
+  vtkGetMacro(PrefetchDepth, int);
+  vtkSetClampMacro(PrefetchDepth, int, 0, VTK_LARGE_INTEGER);
+
+  // Description:
+  // Number of background threads reading ahead. 2 by default.
+  vtkGetMacro(NumberOfPrefetchThreads, int);
+  vtkSetClampMacro(NumberOfPrefetchThreads, int, 1, VTK_LARGE_INTEGER);
+
+  // Description:
+  // Number of time steps served from the prefetch cache (hits) or read
+  // synchronously (misses) since the last call to ResetCacheStatistics().
+  vtkGetMacro(CacheHits, int);
+  vtkGetMacro(CacheMisses, int);
+  void ResetCacheStatistics();
+
+  // Description:
+  // How the requested piece (UPDATE_PIECE_NUMBER, UPDATE_NUMBER_OF_PIECES
+  // and UPDATE_NUMBER_OF_GHOST_LEVELS) is read.
+  // FORWARD_PIECES passes the request to the internal reader, for readers
+  // reading a piece of a file (e.g. XML partitioned formats).
+  // SPLIT_FILES distributes the files holding the same time range (e.g. the
+  // partitions of a time step) across the pieces: each piece reads its share
+  // of the files whole and appends them, a piece left without file is empty.
+  // A single piece request is read as in FORWARD_PIECES mode.
+  // FORWARD_PIECES by default.
+  enum PieceModes
+  {
+    FORWARD_PIECES = 0,
+    SPLIT_FILES
+  };
+  vtkSetClampMacro(PieceMode, int, FORWARD_PIECES, SPLIT_FILES);
+  vtkGetMacro(PieceMode, int);
+  void SetPieceModeToForwardPieces()
+    {this->SetPieceMode(FORWARD_PIECES);}
+  void SetPieceModeToSplitFiles()
+    {this->SetPieceMode(SPLIT_FILES);}
+
+  // Description:
+  // If true, the output is a vtkTemporalDataSet holding one data object of
+  // the reader type per requested time step, so that UPDATE_TIME_STEPS
+  // spanning several files are served in a single pass. Otherwise the output
+  // is the one of the reader and such requests fail. False by default.
+  vtkGetMacro(TemporalOutput, int);
+  vtkSetMacro(TemporalOutput, int);
+  vtkBooleanMacro(TemporalOutput, int);
+
 protected:
   msvVTKFileSeriesReader();
   ~msvVTKFileSeriesReader();
@@ -175,12 +288,48 @@ protected:
   virtual int RequestUpdateExtent(vtkInformation*,
                                   vtkInformationVector**,
                                   vtkInformationVector*);
+  virtual int RequestDataObject(vtkInformation* request,
+                                vtkInformationVector** inputVector,
+                                vtkInformationVector* outputVector);
   virtual int RequestData(vtkInformation *request,
                           vtkInformationVector **inputVector,
                           vtkInformationVector *outputVector);
 
   virtual int FillOutputPortInformation(int port, vtkInformation* info);
 
+  // Description:
+  // Read the files covering the requested time steps into the
+  // vtkTemporalDataSet output, when TemporalOutput is on. The files are read
+  // in parallel when the concrete reader supports NewReaderForFile().
+  virtual int RequestTemporalData(vtkInformation *request,
+                                  vtkInformationVector **inputVector,
+                                  vtkInformationVector *outputVector);
+
+  // Description:
+  // Read the file with the given index, at time if not NULL, with the
+  // internal reader into a new data object. The caller is responsible for
+  // calling Delete on the returned object.
+  virtual vtkDataObject* ReadTimeStep(int index, const double *time,
+                                      vtkInformation *request,
+                                      vtkInformationVector **inputVector,
+                                      vtkInformation *outInfo);
+
+  // Description:
+  // Return true if the file with the given index is read with
+  // ReadPieceFiles(): in SPLIT_FILES mode, when several pieces are
+  // requested.
+  bool SplitsFiles(int index);
+
+  // Description:
+  // Read the share of the requested piece among the files holding the same
+  // time range as the file with the given index, at time if not NULL, into
+  // a new data object (SPLIT_FILES mode). The caller is responsible for
+  // calling Delete on the returned object.
+  virtual vtkDataObject* ReadPieceFiles(int index, const double *time,
+                                        vtkInformation *request,
+                                        vtkInformationVector **inputVector,
+                                        vtkInformation *outInfo);
+
   // Description:
   // Make sure the reader's output is set to the given index and, if it changed,
   // run RequestInformation on the reader.
@@ -200,9 +349,45 @@ protected:
                                vtkStringArray *filesToRead,
                                int maxFilesToRead = VTK_LARGE_INTEGER);
 
+  // Description:
+  // Query the time information of the numberOfFiles files with the given
+  // indices on NumberOfScanThreads threads. timeInfos[i] receives a new
+  // vtkInformation (to be deleted by the caller) holding the time keys of
+  // the file indices[i]. Return 0 and leave timeInfos untouched if the
+  // concrete reader does not support NewReaderForFile().
+  virtual int ScanTimeInformation(int numberOfFiles, const int *indices,
+                                  vtkInformation **timeInfos);
+
+  // Description:
+  // Query the time information of a file that was assumed by the lazy time
+  // discovery and correct the time ranges if the assumption was wrong.
+  virtual void ValidateTimeInformation(int index);
+
+  // Description:
+  // Validate the assumed files serving the times requested in outInfo, and
+  // the files bounding their time ranges, until the files to read no longer
+  // depend on assumed time information.
+  void ValidateRequestedInputs(vtkInformation *outInfo);
+
+  // Description:
+  // Write the time index file if it is set and out of date.
+  virtual void UpdateTimeIndexFile();
+
   virtual void SetReaderFileName(const char* fname)=0;
   vtkAlgorithm* Reader;
 
+  // Description:
+  // Create a new reader configured like Reader and set to read fname. The
+  // caller is responsible for calling Delete on the returned reader. It is
+  // used to read files on other threads than the pipeline one. Returns NULL
+  // by default, meaning the concrete reader does not support it.
+  virtual vtkAlgorithm* NewReaderForFile(const char* fname);
+
+  // Description:
+  // Schedule the read ahead of the files following index in the current
+  // playback direction.
+  virtual void ScheduleReadAhead(int index);
+
   unsigned long HiddenReaderModification;
   unsigned long SavedReaderModification;
 
@@ -219,6 +404,19 @@ protected:
   virtual void UpdateMetaData();
 
   int IgnoreReaderTime;
+  int LazyTimeDiscovery;
+  int NumberOfScanThreads;
+  char *TimeIndexFileName;
+
+  int PieceMode;
+  int TemporalOutput;
+
+  int UsePrefetch;
+  int CacheSize;
+  int PrefetchDepth;
+  int NumberOfPrefetchThreads;
+  int CacheHits;
+  int CacheMisses;
 
 private:
   msvVTKFileSeriesReader(const msvVTKFileSeriesReader&);  // Not implemented.
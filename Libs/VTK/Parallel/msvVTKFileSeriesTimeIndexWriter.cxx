@@ -0,0 +1,134 @@
+/*==============================================================================
+
+  Library: MSVTK
+
+  Copyright (c) Kitware Inc.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0.txt
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// Command line utility generating the binary time index of an existing file
+// series, to be used with msvVTKFileSeriesReader::SetTimeIndexFileName().
+//
+// Usage:
+//   msvVTKFileSeriesTimeIndexWriter <index file> --meta <meta file>
+//   msvVTKFileSeriesTimeIndexWriter <index file> <file1> [<file2> ...]
+//
+// Legacy ".vtk" files are read with vtkGenericDataObjectReader, any other
+// file with vtkXMLGenericDataObjectReader.
+
+// MSVTK includes
+#include "msvVTKFileSeriesReader.h"
+
+// VTK includes
+#include "vtkDataReader.h"
+#include "vtkGenericDataObjectReader.h"
+#include "vtkNew.h"
+#include "vtkObjectFactory.h"
+#include "vtkXMLGenericDataObjectReader.h"
+
+// STD includes
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+// Concrete file series reader forwarding file names to legacy or XML readers.
+class msvVTKGenericFileSeriesReader : public msvVTKFileSeriesReader
+{
+public:
+  vtkTypeMacro(msvVTKGenericFileSeriesReader, msvVTKFileSeriesReader);
+  static msvVTKGenericFileSeriesReader *New();
+
+  // Description:
+  // Read the meta file, if used, to fill the file names.
+  void UpdateFileNames() { this->UpdateMetaData(); }
+
+protected:
+  msvVTKGenericFileSeriesReader(){}
+  virtual ~msvVTKGenericFileSeriesReader(){}
+  virtual void SetReaderFileName(const char* fname)
+    {
+    if (vtkXMLReader::SafeDownCast(this->Reader))
+      {
+      vtkXMLReader::SafeDownCast(this->Reader)->SetFileName(fname);
+      }
+    else if (vtkDataReader::SafeDownCast(this->Reader))
+      {
+      vtkDataReader::SafeDownCast(this->Reader)->SetFileName(fname);
+      }
+    this->SetCurrentFileName(fname);
+    }
+
+private:
+  msvVTKGenericFileSeriesReader(const msvVTKGenericFileSeriesReader&);
+  void operator=(const msvVTKGenericFileSeriesReader&);
+};
+vtkStandardNewMacro(msvVTKGenericFileSeriesReader);
+
+// -----------------------------------------------------------------------------
+int main(int argc, char* argv[])
+{
+  const bool useMetaFile = argc > 2 && std::string(argv[2]) == "--meta";
+  if (argc < 3 || (useMetaFile && argc != 4))
+    {
+    std::cerr << "Usage: " << argv[0] << " <index file> --meta <meta file>\n"
+              << "       " << argv[0] << " <index file> <file1> [<file2> ...]"
+              << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  vtkNew<msvVTKGenericFileSeriesReader> fileSeriesReader;
+  vtkNew<vtkGenericDataObjectReader> legacyReader;
+  vtkNew<vtkXMLGenericDataObjectReader> xmlReader;
+
+  std::string firstFile = argv[2];
+  if (useMetaFile)
+    {
+    fileSeriesReader->SetMetaFileName(argv[3]);
+    fileSeriesReader->UseMetaFileOn();
+    fileSeriesReader->UpdateFileNames();
+    if (fileSeriesReader->GetNumberOfFileNames() == 0)
+      {
+      std::cerr << "No file listed in the meta file " << argv[3] << std::endl;
+      return EXIT_FAILURE;
+      }
+    firstFile = fileSeriesReader->GetFileName(0);
+    }
+  else
+    {
+    for (int i = 2; i < argc; ++i)
+      {
+      fileSeriesReader->AddFileName(argv[i]);
+      }
+    }
+
+  std::string::size_type dot = firstFile.find_last_of('.');
+  if (dot != std::string::npos && firstFile.substr(dot) == ".vtk")
+    {
+    fileSeriesReader->SetReader(legacyReader.GetPointer());
+    }
+  else
+    {
+    fileSeriesReader->SetReader(xmlReader.GetPointer());
+    }
+
+  if (!fileSeriesReader->WriteTimeIndex(argv[1]))
+    {
+    return EXIT_FAILURE;
+    }
+  std::cout << "Wrote the time index of "
+            << fileSeriesReader->GetNumberOfFileNames() << " files to "
+            << argv[1] << std::endl;
+  return EXIT_SUCCESS;
+}
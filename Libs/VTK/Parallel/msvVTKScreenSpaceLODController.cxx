@@ -0,0 +1,336 @@
+/*==============================================================================
+
+  Library: MSVTK
+
+  Copyright (c) Kitware Inc.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0.txt
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// VTK includes
+#include "vtkCallbackCommand.h"
+#include "vtkCamera.h"
+#include "vtkMath.h"
+#include "vtkObjectFactory.h"
+#include "vtkRenderWindow.h"
+#include "vtkRenderer.h"
+#include "vtkWeakPointer.h"
+
+// STD includes
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <queue>
+#include <utility>
+#include <vector>
+
+// MSVTK includes
+#include "msvVTKScreenSpaceLODController.h"
+#include "msvVTKXMLMultiblockLODReader.h"
+
+//------------------------------------------------------------------------------
+class msvVTKScreenSpaceLODController::vtkInternal
+{
+public:
+  // The LODs of a piece and their estimated number of cells and screen
+  // space error.
+  struct PieceSelection
+  {
+    int Piece;
+    int LOD;
+    std::vector<vtkIdType> NumberOfCells;
+    std::vector<double> Errors;
+  };
+
+  vtkWeakPointer<vtkObject> EventSource;
+};
+
+//------------------------------------------------------------------------------
+vtkStandardNewMacro(msvVTKScreenSpaceLODController);
+vtkCxxSetObjectMacro(msvVTKScreenSpaceLODController, Reader,
+                     msvVTKXMLMultiblockLODReader);
+vtkCxxSetObjectMacro(msvVTKScreenSpaceLODController, Renderer, vtkRenderer);
+
+//------------------------------------------------------------------------------
+msvVTKScreenSpaceLODController::msvVTKScreenSpaceLODController()
+{
+  this->Reader = 0;
+  this->Renderer = 0;
+  this->PixelErrorThreshold = 1.;
+  this->CellBudget = 0;
+  this->RefinementFactor = 4.;
+  this->NumberOfSelectedCells = 0;
+
+  this->EventCallbackCommand = vtkCallbackCommand::New();
+  this->EventCallbackCommand->SetClientData(this);
+  this->EventCallbackCommand->SetCallback(
+    msvVTKScreenSpaceLODController::ProcessEvents);
+
+  this->Internal = new vtkInternal;
+}
+
+//------------------------------------------------------------------------------
+msvVTKScreenSpaceLODController::~msvVTKScreenSpaceLODController()
+{
+  this->SetEventSource(0);
+  this->SetReader(0);
+  this->SetRenderer(0);
+  this->EventCallbackCommand->Delete();
+  delete this->Internal;
+}
+
+//------------------------------------------------------------------------------
+void msvVTKScreenSpaceLODController::SetEventSource(vtkObject* source)
+{
+  vtkObject* previousSource = this->Internal->EventSource.GetPointer();
+  if (previousSource == source)
+    {
+    return;
+    }
+  if (previousSource)
+    {
+    previousSource->RemoveObserver(this->EventCallbackCommand);
+    }
+  this->Internal->EventSource = source;
+  if (source)
+    {
+    source->AddObserver(vtkCommand::EndInteractionEvent,
+                        this->EventCallbackCommand);
+    }
+  this->Modified();
+}
+
+//------------------------------------------------------------------------------
+vtkObject* msvVTKScreenSpaceLODController::GetEventSource()
+{
+  return this->Internal->EventSource.GetPointer();
+}
+
+//------------------------------------------------------------------------------
+void msvVTKScreenSpaceLODController::ProcessEvents(
+  vtkObject* vtkNotUsed(caller), unsigned long event, void* clientdata,
+  void* vtkNotUsed(calldata))
+{
+  msvVTKScreenSpaceLODController* self =
+    reinterpret_cast<msvVTKScreenSpaceLODController*>(clientdata);
+  if (event != vtkCommand::EndInteractionEvent || self->Update() == 0)
+    {
+    return;
+    }
+  // Show the new LODs
+  vtkRenderWindow* renderWindow =
+    self->Renderer ? self->Renderer->GetRenderWindow() : 0;
+  if (renderWindow && renderWindow->GetMapped())
+    {
+    renderWindow->Render();
+    }
+}
+
+//------------------------------------------------------------------------------
+double msvVTKScreenSpaceLODController::GetPixelsPerUnit(
+  const double bounds[6], const double planes[24])
+{
+  // Out of the frustum if the corner the furthest along the inward normal
+  // of a plane is behind it.
+  for (int p = 0; p < 6; ++p)
+    {
+    const double* plane = planes + 4 * p;
+    double corner[3];
+    for (int i = 0; i < 3; ++i)
+      {
+      corner[i] = plane[i] >= 0. ? bounds[2*i+1] : bounds[2*i];
+      }
+    if (vtkMath::Dot(plane, corner) + plane[3] < 0.)
+      {
+      return 0.;
+      }
+    }
+
+  vtkCamera* camera = this->Renderer->GetActiveCamera();
+  int* size = this->Renderer->GetSize();
+  double pixels = camera->GetUseHorizontalViewAngle() ? size[0] : size[1];
+  if (camera->GetParallelProjection())
+    {
+    return pixels / (2. * camera->GetParallelScale());
+    }
+
+  // Distance from the camera to the closest point of the bounds
+  double* position = camera->GetPosition();
+  double distance2 = 0.;
+  for (int i = 0; i < 3; ++i)
+    {
+    double delta = std::max(0., std::max(bounds[2*i] - position[i],
+                                         position[i] - bounds[2*i+1]));
+    distance2 += delta * delta;
+    }
+  double distance = std::max(sqrt(distance2),
+                             camera->GetClippingRange()[0]);
+  return pixels / (2. * distance *
+    tan(vtkMath::RadiansFromDegrees(camera->GetViewAngle()) / 2.));
+}
+
+//------------------------------------------------------------------------------
+int msvVTKScreenSpaceLODController::Update()
+{
+  this->NumberOfSelectedCells = 0;
+  if (!this->Reader || !this->Renderer || !this->Renderer->GetActiveCamera())
+    {
+    return 0;
+    }
+  this->Reader->UpdateInformation();
+
+  double planes[24];
+  this->Renderer->GetActiveCamera()->GetFrustumPlanes(
+    this->Renderer->GetTiledAspectRatio(), planes);
+
+  std::vector<vtkInternal::PieceSelection> selections;
+  int numberOfPieces = this->Reader->GetNumberOfLODPieces();
+  for (int piece = 0; piece < numberOfPieces; ++piece)
+    {
+    int numberOfLODs = this->Reader->GetPieceNumberOfLODs(piece);
+    int currentLOD = this->Reader->GetPieceLOD(piece);
+    if (numberOfLODs <= 0 || currentLOD < 0)
+      {
+      continue;
+      }
+
+    vtkInternal::PieceSelection selection;
+    selection.Piece = piece;
+    selection.LOD = currentLOD;
+    selection.NumberOfCells.resize(numberOfLODs);
+    selection.Errors.resize(numberOfLODs);
+
+    // Known statistics, preferably of the current LOD
+    double bounds[6];
+    double pieceBounds[6];
+    vtkMath::UninitializeBounds(pieceBounds);
+    int knownLOD = -1;
+    for (int lod = 0; lod < numberOfLODs; ++lod)
+      {
+      selection.NumberOfCells[lod] =
+        this->Reader->GetPieceLODStatistics(piece, lod, bounds);
+      if (selection.NumberOfCells[lod] >= 0 &&
+          (knownLOD < 0 || lod == currentLOD))
+        {
+        knownLOD = lod;
+        }
+      if (pieceBounds[0] > pieceBounds[1] && bounds[0] <= bounds[1])
+        {
+        std::copy(bounds, bounds + 6, pieceBounds);
+        }
+      }
+    if (knownLOD < 0 || pieceBounds[0] > pieceBounds[1])
+      {
+      // Nothing to estimate the error from, keep the current LOD
+      continue;
+      }
+
+    double pixelsPerUnit = this->GetPixelsPerUnit(pieceBounds, planes);
+    double diagonal = sqrt(
+      (pieceBounds[1] - pieceBounds[0]) * (pieceBounds[1] - pieceBounds[0]) +
+      (pieceBounds[3] - pieceBounds[2]) * (pieceBounds[3] - pieceBounds[2]) +
+      (pieceBounds[5] - pieceBounds[4]) * (pieceBounds[5] - pieceBounds[4]));
+    selection.LOD = -1;
+    for (int lod = 0; lod < numberOfLODs; ++lod)
+      {
+      vtkIdType& numberOfCells = selection.NumberOfCells[lod];
+      if (numberOfCells < 0)
+        {
+        numberOfCells = static_cast<vtkIdType>(
+          selection.NumberOfCells[knownLOD] *
+          pow(this->RefinementFactor, lod - knownLOD));
+        }
+      selection.Errors[lod] = pixelsPerUnit * diagonal /
+        sqrt(static_cast<double>(std::max(numberOfCells, vtkIdType(1))));
+      if (selection.LOD < 0 &&
+          selection.Errors[lod] <= this->PixelErrorThreshold)
+        {
+        selection.LOD = lod;
+        }
+      }
+    if (selection.LOD < 0)
+      {
+      selection.LOD = numberOfLODs - 1;
+      }
+    this->NumberOfSelectedCells += selection.NumberOfCells[selection.LOD];
+    selections.push_back(selection);
+    }
+
+  // Lower the LODs whose coarser LOD has the smallest error until the
+  // selection fits in the budget.
+  if (this->CellBudget > 0 && this->NumberOfSelectedCells > this->CellBudget)
+    {
+    typedef std::pair<double, size_t> CandidateType;
+    std::priority_queue<CandidateType, std::vector<CandidateType>,
+                        std::greater<CandidateType> > candidates;
+    for (size_t i = 0; i < selections.size(); ++i)
+      {
+      if (selections[i].LOD > 0)
+        {
+        candidates.push(std::make_pair(
+          selections[i].Errors[selections[i].LOD - 1], i));
+        }
+      }
+    while (this->NumberOfSelectedCells > this->CellBudget &&
+           !candidates.empty())
+      {
+      vtkInternal::PieceSelection& selection =
+        selections[candidates.top().second];
+      candidates.pop();
+      this->NumberOfSelectedCells -=
+        selection.NumberOfCells[selection.LOD] -
+        selection.NumberOfCells[selection.LOD - 1];
+      --selection.LOD;
+      if (selection.LOD > 0)
+        {
+        candidates.push(std::make_pair(
+          selection.Errors[selection.LOD - 1],
+          static_cast<size_t>(&selection - &selections[0])));
+        }
+      }
+    }
+
+  // Apply the changes at once
+  std::vector<int> pieces;
+  std::vector<unsigned int> lods;
+  for (size_t i = 0; i < selections.size(); ++i)
+    {
+    if (selections[i].LOD != this->Reader->GetPieceLOD(selections[i].Piece))
+      {
+      pieces.push_back(selections[i].Piece);
+      lods.push_back(static_cast<unsigned int>(selections[i].LOD));
+      }
+    }
+  if (!pieces.empty())
+    {
+    this->Reader->SetPieceLODs(static_cast<int>(pieces.size()), &pieces[0],
+                               &lods[0]);
+    }
+  return static_cast<int>(pieces.size());
+}
+
+//------------------------------------------------------------------------------
+void msvVTKScreenSpaceLODController::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "Reader: " << this->Reader << endl;
+  os << indent << "Renderer: " << this->Renderer << endl;
+  os << indent << "EventSource: " << this->GetEventSource() << endl;
+  os << indent << "PixelErrorThreshold: " << this->PixelErrorThreshold
+     << endl;
+  os << indent << "CellBudget: " << this->CellBudget << endl;
+  os << indent << "RefinementFactor: " << this->RefinementFactor << endl;
+  os << indent << "NumberOfSelectedCells: " << this->NumberOfSelectedCells
+     << endl;
+}
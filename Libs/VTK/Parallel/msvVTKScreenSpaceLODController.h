@@ -0,0 +1,146 @@
+/*==============================================================================
+
+  Library: MSVTK
+
+  Copyright (c) Kitware Inc.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0.txt
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// .NAME msvVTKScreenSpaceLODController - select the LODs of a
+// msvVTKXMLMultiblockLODReader from the camera of a renderer
+//
+// .SECTION Description:
+//
+// msvVTKScreenSpaceLODController selects the LOD of each visible piece of a
+// msvVTKXMLMultiblockLODReader so that its screen space error is below
+// PixelErrorThreshold: the error of a LOD is the size, in pixels, of its
+// average cell, i.e. the diagonal of the bounds of the piece divided by the
+// square root of the number of cells of the LOD, projected at the closest
+// point of the bounds to the camera. The coarsest LOD meeting the threshold
+// is selected, the finest one if none does, and the coarsest one for the
+// pieces out of the view frustum.
+//
+// The number of cells and the bounds of the LODs are taken from the reader
+// (see msvVTKXMLMultiblockLODReader::GetPieceLODStatistics()). The number of
+// cells of the LODs not read yet and without statistics in the file is
+// extrapolated from a known LOD of the same piece, assuming that each LOD
+// has RefinementFactor times more cells than the previous one.
+//
+// When the selection exceeds CellBudget, the LODs of the pieces whose next
+// coarser LOD has the smallest screen space error are lowered first, until
+// the selection fits in the budget.
+//
+// The LODs are changed at once with
+// msvVTKXMLMultiblockLODReader::SetPieceLODs() on Update(), which is called
+// whenever the EventSource invokes vtkCommand::EndInteractionEvent.
+// Hidden pieces are left untouched.
+
+#ifndef __msvVTKScreenSpaceLODController_h
+#define __msvVTKScreenSpaceLODController_h
+
+// VTK_PARALLEL includes
+#include "msvVTKParallelExport.h"
+
+#include "vtkObject.h"
+
+class msvVTKXMLMultiblockLODReader;
+class vtkCallbackCommand;
+class vtkRenderer;
+
+class MSV_VTK_PARALLEL_EXPORT msvVTKScreenSpaceLODController
+  : public vtkObject
+{
+public:
+  static msvVTKScreenSpaceLODController *New();
+  vtkTypeMacro(msvVTKScreenSpaceLODController, vtkObject);
+  void PrintSelf(ostream& os, vtkIndent indent);
+
+  // Description:
+  // Reader whose piece LODs are selected.
+  void SetReader(msvVTKXMLMultiblockLODReader* reader);
+  vtkGetObjectMacro(Reader, msvVTKXMLMultiblockLODReader);
+
+  // Description:
+  // Renderer whose active camera and size give the screen space error.
+  void SetRenderer(vtkRenderer* renderer);
+  vtkGetObjectMacro(Renderer, vtkRenderer);
+
+  // Description:
+  // Object whose vtkCommand::EndInteractionEvent triggers Update(),
+  // typically the interactor style of the render window interactor.
+  // It is not reference counted. NULL by default.
+  void SetEventSource(vtkObject* source);
+  vtkObject* GetEventSource();
+
+  // Description:
+  // Maximum screen space error of the selected LODs, in pixels.
+  // 1 by default.
+  vtkSetClampMacro(PixelErrorThreshold, double, 0., VTK_DOUBLE_MAX);
+  vtkGetMacro(PixelErrorThreshold, double);
+
+  // Description:
+  // Maximum total number of cells of the selected LODs, i.e. of triangles
+  // for surface meshes. No limit when 0, by default.
+  vtkSetClampMacro(CellBudget, vtkIdType, 0, VTK_LARGE_ID);
+  vtkGetMacro(CellBudget, vtkIdType);
+
+  // Description:
+  // Ratio between the number of cells of two successive LODs, used for the
+  // LODs whose number of cells is unknown. 4 by default.
+  vtkSetClampMacro(RefinementFactor, double, 1., VTK_DOUBLE_MAX);
+  vtkGetMacro(RefinementFactor, double);
+
+  // Description:
+  // Select the LODs of the pieces of the reader for the current camera and
+  // apply the changes, if any, in a single call to SetPieceLODs(). Return
+  // the number of pieces whose LOD changed.
+  int Update();
+
+  // Description:
+  // Estimated total number of cells of the LODs selected by the last
+  // Update().
+  vtkGetMacro(NumberOfSelectedCells, vtkIdType);
+
+protected:
+  msvVTKScreenSpaceLODController();
+  ~msvVTKScreenSpaceLODController();
+
+  // Description:
+  // Number of pixels per world unit at the closest point of bounds to the
+  // camera, 0 if bounds are out of the view frustum. planes are the frustum
+  // planes of the camera.
+  double GetPixelsPerUnit(const double bounds[6], const double planes[24]);
+
+  static void ProcessEvents(vtkObject* caller, unsigned long event,
+                            void* clientdata, void* calldata);
+
+  msvVTKXMLMultiblockLODReader* Reader;
+  vtkRenderer* Renderer;
+  double PixelErrorThreshold;
+  vtkIdType CellBudget;
+  double RefinementFactor;
+  vtkIdType NumberOfSelectedCells;
+
+  vtkCallbackCommand* EventCallbackCommand;
+
+private:
+  msvVTKScreenSpaceLODController(const msvVTKScreenSpaceLODController&); // Not implemented.
+  void operator=(const msvVTKScreenSpaceLODController&);                  // Not implemented.
+
+  class vtkInternal;
+  vtkInternal* Internal;
+};
+
+#endif
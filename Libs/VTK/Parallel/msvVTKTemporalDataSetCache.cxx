@@ -0,0 +1,352 @@
+/*==============================================================================
+
+  Library: MSVTK
+
+  Copyright (c) Kitware Inc.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0.txt
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+#include "msvVTKTemporalDataSetCache.h"
+#include "vtkCompositeDataPipeline.h"
+#include "vtkDataObject.h"
+#include "vtkInformation.h"
+#include "vtkInformationVector.h"
+#include "vtkObjectFactory.h"
+#include "vtkSmartPointer.h"
+#include "vtkStreamingDemandDrivenPipeline.h"
+#include "vtkTemporalDataSet.h"
+
+#include <algorithm>
+#include <map>
+#include <set>
+#include <vector>
+
+//=============================================================================
+vtkStandardNewMacro(msvVTKTemporalDataSetCache);
+
+//=============================================================================
+class msvVTKTemporalDataSetCacheInternals
+{
+public:
+  struct Entry
+  {
+    vtkSmartPointer<vtkDataObject> Data;
+    // Pipeline modification time when the time step was cached.
+    unsigned long PipelineTime;
+    // Value of UseCount when the time step was last requested.
+    unsigned long LastUse;
+    // Memory size in kibibytes.
+    unsigned long Size;
+  };
+  typedef std::map<double, Entry> CacheType;
+
+  msvVTKTemporalDataSetCacheInternals() : UseCount(0), MemorySize(0) {}
+
+  void Erase(CacheType::iterator it)
+  {
+    this->MemorySize -= it->second.Size;
+    this->Cache.erase(it);
+  }
+
+  CacheType Cache;
+  // Time steps that can't be evicted.
+  std::set<double> Pinned;
+  unsigned long UseCount;
+  unsigned long MemorySize;
+};
+
+//----------------------------------------------------------------------------
+msvVTKTemporalDataSetCache::msvVTKTemporalDataSetCache()
+{
+  this->Internal = new msvVTKTemporalDataSetCacheInternals;
+  this->MemoryBudget = 262144;
+  this->NumberOfPinnedNeighbors = 1;
+  this->CacheHits = 0;
+  this->CacheMisses = 0;
+  this->CacheEvictions = 0;
+}
+
+//----------------------------------------------------------------------------
+msvVTKTemporalDataSetCache::~msvVTKTemporalDataSetCache()
+{
+  delete this->Internal;
+}
+
+//----------------------------------------------------------------------------
+int msvVTKTemporalDataSetCache::FillInputPortInformation(
+  int vtkNotUsed(port), vtkInformation* info)
+{
+  // Accept any data object, temporal or not.
+  info->Set(vtkAlgorithm::INPUT_REQUIRED_DATA_TYPE(), "vtkDataObject");
+  return 1;
+}
+
+//----------------------------------------------------------------------------
+unsigned long msvVTKTemporalDataSetCache::GetCacheMemorySize()
+{
+  return this->Internal->MemorySize;
+}
+
+//----------------------------------------------------------------------------
+int msvVTKTemporalDataSetCache::GetNumberOfCachedTimeSteps()
+{
+  return static_cast<int>(this->Internal->Cache.size());
+}
+
+//----------------------------------------------------------------------------
+void msvVTKTemporalDataSetCache::ResetCacheStatistics()
+{
+  this->CacheHits = 0;
+  this->CacheMisses = 0;
+  this->CacheEvictions = 0;
+}
+
+//----------------------------------------------------------------------------
+int msvVTKTemporalDataSetCache::RequestUpdateExtent(
+  vtkInformation* vtkNotUsed(request),
+  vtkInformationVector** inputVector,
+  vtkInformationVector* outputVector)
+{
+  vtkInformation *inInfo = inputVector[0]->GetInformationObject(0);
+  vtkInformation *outInfo = outputVector->GetInformationObject(0);
+  msvVTKTemporalDataSetCacheInternals::CacheType& cache =
+    this->Internal->Cache;
+
+  // Time steps cached before the pipeline was modified are out of date.
+  vtkDemandDrivenPipeline *ddp =
+    vtkDemandDrivenPipeline::SafeDownCast(this->GetExecutive());
+  if (!ddp)
+    {
+    return 1;
+    }
+  unsigned long pipelineTime = ddp->GetPipelineMTime();
+  for (msvVTKTemporalDataSetCacheInternals::CacheType::iterator it =
+         cache.begin(); it != cache.end();)
+    {
+    msvVTKTemporalDataSetCacheInternals::CacheType::iterator current = it++;
+    if (current->second.PipelineTime < pipelineTime)
+      {
+      this->Internal->Erase(current);
+      }
+    }
+
+  this->Internal->Pinned.clear();
+  if (!outInfo->Has(vtkStreamingDemandDrivenPipeline::UPDATE_TIME_STEPS()))
+    {
+    // Nothing to serve from the cache, the input provides the whole data.
+    return 1;
+    }
+  int numUpTimes =
+    outInfo->Length(vtkStreamingDemandDrivenPipeline::UPDATE_TIME_STEPS());
+  double *upTimes =
+    outInfo->Get(vtkStreamingDemandDrivenPipeline::UPDATE_TIME_STEPS());
+
+  // Pin the requested time steps and their neighbours.
+  int numInTimes =
+    inInfo->Length(vtkStreamingDemandDrivenPipeline::TIME_STEPS());
+  double *inTimes =
+    inInfo->Get(vtkStreamingDemandDrivenPipeline::TIME_STEPS());
+  for (int i = 0; i < numUpTimes; ++i)
+    {
+    this->Internal->Pinned.insert(upTimes[i]);
+    if (!inTimes || numInTimes == 0)
+      {
+      continue;
+      }
+    int step = static_cast<int>(
+      std::lower_bound(inTimes, inTimes + numInTimes, upTimes[i]) - inTimes);
+    if (step == numInTimes ||
+        (step > 0 && upTimes[i] - inTimes[step - 1] < inTimes[step] - upTimes[i]))
+      {
+      --step;
+      }
+    int first = std::max(step - this->NumberOfPinnedNeighbors, 0);
+    int last = std::min(step + this->NumberOfPinnedNeighbors, numInTimes - 1);
+    for (int j = first; j <= last; ++j)
+      {
+      this->Internal->Pinned.insert(inTimes[j]);
+      }
+    }
+
+  // Only request the time steps that are not cached.
+  std::vector<double> missingTimes;
+  for (int i = 0; i < numUpTimes; ++i)
+    {
+    if (cache.find(upTimes[i]) == cache.end())
+      {
+      missingTimes.push_back(upTimes[i]);
+      }
+    }
+  if (!missingTimes.empty())
+    {
+    inInfo->Set(vtkStreamingDemandDrivenPipeline::UPDATE_TIME_STEPS(),
+                &missingTimes[0], static_cast<int>(missingTimes.size()));
+    }
+  else
+    {
+    // Leave the input with what it already has.
+    vtkDataObject *input = inInfo->Get(vtkDataObject::DATA_OBJECT());
+    if (input &&
+        input->GetInformation()->Has(vtkDataObject::DATA_TIME_STEPS()))
+      {
+      inInfo->Set(vtkStreamingDemandDrivenPipeline::UPDATE_TIME_STEPS(),
+        input->GetInformation()->Get(vtkDataObject::DATA_TIME_STEPS()),
+        input->GetInformation()->Length(vtkDataObject::DATA_TIME_STEPS()));
+      }
+    }
+  return 1;
+}
+
+//----------------------------------------------------------------------------
+int msvVTKTemporalDataSetCache::RequestData(
+  vtkInformation* vtkNotUsed(request),
+  vtkInformationVector** inputVector,
+  vtkInformationVector* outputVector)
+{
+  vtkInformation *inInfo = inputVector[0]->GetInformationObject(0);
+  vtkInformation *outInfo = outputVector->GetInformationObject(0);
+  msvVTKTemporalDataSetCacheInternals::CacheType& cache =
+    this->Internal->Cache;
+
+  vtkTemporalDataSet *output = vtkTemporalDataSet::SafeDownCast(
+    outInfo->Get(vtkDataObject::DATA_OBJECT()));
+  vtkDataObject *input = inInfo->Get(vtkDataObject::DATA_OBJECT());
+  if (!output || !input)
+    {
+    return 0;
+    }
+  vtkTemporalDataSet *temporalInput = vtkTemporalDataSet::SafeDownCast(input);
+
+  int numUpTimes =
+    outInfo->Length(vtkStreamingDemandDrivenPipeline::UPDATE_TIME_STEPS());
+  double *upTimes =
+    outInfo->Get(vtkStreamingDemandDrivenPipeline::UPDATE_TIME_STEPS());
+  int numInTimes =
+    input->GetInformation()->Length(vtkDataObject::DATA_TIME_STEPS());
+  double *inTimes =
+    input->GetInformation()->Get(vtkDataObject::DATA_TIME_STEPS());
+  if (!upTimes || !inTimes)
+    {
+    // No time to cache, pass the input through.
+    if (temporalInput)
+      {
+      output->ShallowCopy(temporalInput);
+      }
+    else
+      {
+      output->SetTimeStep(0, input);
+      }
+    return 1;
+    }
+
+  vtkDemandDrivenPipeline *ddp =
+    vtkDemandDrivenPipeline::SafeDownCast(this->GetExecutive());
+  unsigned long pipelineTime = ddp ? ddp->GetPipelineMTime() : 0;
+  ++this->Internal->UseCount;
+
+  // Each requested time step is either cached or in the input.
+  std::vector<double> outTimes;
+  for (int i = 0; i < numUpTimes; ++i)
+    {
+    msvVTKTemporalDataSetCacheInternals::CacheType::iterator it =
+      cache.find(upTimes[i]);
+    if (it != cache.end())
+      {
+      ++this->CacheHits;
+      }
+    else
+      {
+      vtkDataObject *data = 0;
+      for (int j = 0; j < numInTimes && !data; ++j)
+        {
+        if (inTimes[j] == upTimes[i])
+          {
+          data = temporalInput ?
+            temporalInput->GetTimeStep(static_cast<unsigned int>(j)) : input;
+          }
+        }
+      if (!data)
+        {
+        vtkErrorMacro(<< "The input does not provide time " << upTimes[i]);
+        continue;
+        }
+      ++this->CacheMisses;
+      msvVTKTemporalDataSetCacheInternals::Entry entry;
+      entry.Data.TakeReference(data->NewInstance());
+      entry.Data->ShallowCopy(data);
+      entry.PipelineTime = pipelineTime;
+      entry.Size = entry.Data->GetActualMemorySize();
+      this->Internal->MemorySize += entry.Size;
+      it = cache.insert(std::make_pair(upTimes[i], entry)).first;
+      }
+    it->second.LastUse = this->Internal->UseCount;
+    output->SetTimeStep(static_cast<unsigned int>(outTimes.size()),
+                        it->second.Data);
+    outTimes.push_back(upTimes[i]);
+    }
+  if (!outTimes.empty())
+    {
+    output->GetInformation()->Set(vtkDataObject::DATA_TIME_STEPS(),
+                                  &outTimes[0],
+                                  static_cast<int>(outTimes.size()));
+    }
+
+  this->EvictTimeSteps();
+  return 1;
+}
+
+//----------------------------------------------------------------------------
+void msvVTKTemporalDataSetCache::EvictTimeSteps()
+{
+  msvVTKTemporalDataSetCacheInternals::CacheType& cache =
+    this->Internal->Cache;
+  while (this->Internal->MemorySize > this->MemoryBudget)
+    {
+    msvVTKTemporalDataSetCacheInternals::CacheType::iterator oldest =
+      cache.end();
+    for (msvVTKTemporalDataSetCacheInternals::CacheType::iterator it =
+           cache.begin(); it != cache.end(); ++it)
+      {
+      if (this->Internal->Pinned.count(it->first) == 0 &&
+          (oldest == cache.end() ||
+           it->second.LastUse < oldest->second.LastUse))
+        {
+        oldest = it;
+        }
+      }
+    if (oldest == cache.end())
+      {
+      // Everything left is pinned.
+      break;
+      }
+    this->Internal->Erase(oldest);
+    ++this->CacheEvictions;
+    }
+}
+
+//----------------------------------------------------------------------------
+void msvVTKTemporalDataSetCache::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "MemoryBudget: " << this->MemoryBudget << endl;
+  os << indent << "NumberOfPinnedNeighbors: "
+     << this->NumberOfPinnedNeighbors << endl;
+  os << indent << "CacheMemorySize: " << this->Internal->MemorySize << endl;
+  os << indent << "NumberOfCachedTimeSteps: "
+     << this->Internal->Cache.size() << endl;
+  os << indent << "CacheHits: " << this->CacheHits << endl;
+  os << indent << "CacheMisses: " << this->CacheMisses << endl;
+  os << indent << "CacheEvictions: " << this->CacheEvictions << endl;
+}
@@ -0,0 +1,115 @@
+/*==============================================================================
+
+  Library: MSVTK
+
+  Copyright (c) Kitware Inc.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0.txt
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+==============================================================================*/
+
+// .NAME msvVTKTemporalDataSetCache - cache time steps within a memory budget
+//
+// .SECTION Description:
+//
+// msvVTKTemporalDataSetCache is a drop-in replacement for
+// vtkTemporalDataSetCache: it keeps the time steps it has seen so that they
+// are not requested again upstream, and outputs the requested time steps in
+// a vtkTemporalDataSet.
+//
+// Instead of a number of time steps, the cache is bounded by the total
+// memory size of the cached time steps (vtkDataObject::GetActualMemorySize).
+// When over budget, the least recently used time steps are evicted first.
+// The requested time steps and their NumberOfPinnedNeighbors neighbours
+// among the input TIME_STEPS are pinned and never evicted, so that playing
+// back or interpolating around the current time never rereads them.
+
+#ifndef __msvVTKTemporalDataSetCache_h
+#define __msvVTKTemporalDataSetCache_h
+
+// VTK_PARALLEL includes
+#include "msvVTKParallelExport.h"
+
+#include "vtkTemporalDataSetAlgorithm.h"
+
+class msvVTKTemporalDataSetCacheInternals;
+
+class MSV_VTK_PARALLEL_EXPORT msvVTKTemporalDataSetCache
+  : public vtkTemporalDataSetAlgorithm
+{
+public:
+  static msvVTKTemporalDataSetCache *New();
+  vtkTypeMacro(msvVTKTemporalDataSetCache, vtkTemporalDataSetAlgorithm);
+  void PrintSelf(ostream& os, vtkIndent indent);
+
+  // Description:
+  // Maximum memory size of the cached time steps, in kibibytes as returned
+  // by vtkDataObject::GetActualMemorySize(). Pinned time steps are kept even
+  // if they exceed it. 262144 (256 MiB) by default.
+  vtkGetMacro(MemoryBudget, unsigned long);
+  vtkSetMacro(MemoryBudget, unsigned long);
+
+  // Description:
+  // Number of time steps before and after each requested time step that
+  // can't be evicted. 1 by default.
+  vtkGetMacro(NumberOfPinnedNeighbors, int);
+  vtkSetClampMacro(NumberOfPinnedNeighbors, int, 0, VTK_LARGE_INTEGER);
+
+  // Description:
+  // Memory size of the cached time steps, in kibibytes.
+  unsigned long GetCacheMemorySize();
+
+  // Description:
+  // Number of time steps currently cached.
+  int GetNumberOfCachedTimeSteps();
+
+  // Description:
+  // Number of requested time steps served from the cache (hits) or from the
+  // input (misses), and number of time steps evicted to stay within the
+  // memory budget, since the last call to ResetCacheStatistics().
+  vtkGetMacro(CacheHits, int);
+  vtkGetMacro(CacheMisses, int);
+  vtkGetMacro(CacheEvictions, int);
+  void ResetCacheStatistics();
+
+protected:
+  msvVTKTemporalDataSetCache();
+  ~msvVTKTemporalDataSetCache();
+
+  virtual int FillInputPortInformation(int port, vtkInformation* info);
+  virtual int RequestUpdateExtent(vtkInformation*,
+                                  vtkInformationVector**,
+                                  vtkInformationVector*);
+  virtual int RequestData(vtkInformation*,
+                          vtkInformationVector**,
+                          vtkInformationVector*);
+
+  // Description:
+  // Evict the least recently used time steps that are not pinned until the
+  // cache fits in the memory budget.
+  void EvictTimeSteps();
+
+  unsigned long MemoryBudget;
+  int NumberOfPinnedNeighbors;
+  int CacheHits;
+  int CacheMisses;
+  int CacheEvictions;
+
+private:
+  msvVTKTemporalDataSetCache(const msvVTKTemporalDataSetCache&); // Not implemented.
+  void operator=(const msvVTKTemporalDataSetCache&);              // Not implemented.
+
+  msvVTKTemporalDataSetCacheInternals *Internal;
+};
+
+#endif
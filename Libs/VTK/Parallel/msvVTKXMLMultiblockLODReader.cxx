@@ -27,12 +27,15 @@
 #include "vtkInformation.h"
 #include "vtkInformationVector.h"
 #include "vtkInstantiator.h"
+#include "vtkMath.h"
 #include "vtkMultiBlockDataSet.h"
 #include "vtkMultiPieceDataSet.h"
+#include "vtkMultiThreader.h"
 #include "vtkNew.h"
 #include "vtkObjectFactory.h"
 #include "vtkSmartPointer.h"
 #include "vtkStreamingDemandDrivenPipeline.h"
+#include "vtkWeakPointer.h"
 #include "vtkXMLDataElement.h"
 #include "vtkXMLDataParser.h"
 
@@ -44,9 +47,12 @@
 #include <vtksys/SystemTools.hxx>
 
 // STD includes
+#include <algorithm>
 #include <assert.h>
 #include <map>
 #include <set>
+#include <string>
+#include <utility>
 #include <vector>
 
 // MSVTK includes
@@ -58,6 +64,49 @@ struct vtkXMLCompositeDataReaderEntry
   const char* name;
 };
 
+static const vtkXMLCompositeDataReaderEntry vtkXMLCompositeDataReaderEntries[] =
+{
+  {"vtp", "vtkXMLPolyDataReader"},
+  {"vtu", "vtkXMLUnstructuredGridReader"},
+  {"vti", "vtkXMLImageDataReader"},
+  {"vtr", "vtkXMLRectilinearGridReader"},
+  {"vts", "vtkXMLStructuredGridReader"},
+  {0, 0}
+};
+
+//------------------------------------------------------------------------------
+// A leaf read on its own reader by the threads of ReadLeafJobs().
+struct msvVTKXMLMultiblockLODReaderLeafJob
+{
+  unsigned int FlatIndex;
+  vtkXMLReader* Reader;
+  const char* Name;
+  vtkDataSet* Output;
+};
+
+//------------------------------------------------------------------------------
+static VTK_THREAD_RETURN_TYPE msvReadLeaves(void* arg)
+{
+  vtkMultiThreader::ThreadInfo* threadInfo =
+    static_cast<vtkMultiThreader::ThreadInfo*>(arg);
+  std::vector<msvVTKXMLMultiblockLODReaderLeafJob>* jobs =
+    static_cast<std::vector<msvVTKXMLMultiblockLODReaderLeafJob>*>(
+      threadInfo->UserData);
+  for (size_t i = threadInfo->ThreadID; i < jobs->size();
+       i += threadInfo->NumberOfThreads)
+    {
+    msvVTKXMLMultiblockLODReaderLeafJob& job = (*jobs)[i];
+    job.Reader->Update();
+    vtkDataSet* output = job.Reader->GetOutputAsDataSet();
+    if (output)
+      {
+      job.Output = output->NewInstance();
+      job.Output->ShallowCopy(output);
+      }
+    }
+  return VTK_THREAD_RETURN_VALUE;
+}
+
 //------------------------------------------------------------------------------
 class msvVTKXMLMultiblockLODReaderInternal
 {
@@ -65,46 +114,88 @@ public:
   msvVTKXMLMultiblockLODReaderInternal();
   ~msvVTKXMLMultiblockLODReaderInternal();
 
-  void InitListUpdateNodes(vtkXMLDataElement* rootElement);
-  void InitListUpdateNodes(vtkXMLDataElement* root,
-                           unsigned int lodTreeLevel,
-                           unsigned int defaultLOD,
-                           int parent = 0);
-
-  void SetLODToNodes(vtkXMLDataElement* root,
-                     unsigned int LODLevel,
-                     int pieceIndex = -1,
-                     int lod = 0);
-  bool GetNodeLOD(vtkXMLDataElement* root,
-                  unsigned int LODLevel,
-                  int pieceIndex,
-                  int& lod);
-  int GetNodePieceIndex(vtkXMLDataElement* root,
-                        vtkIdType compositeIndex);
-
-  static unsigned int CountNumberOfNodes(vtkXMLDataElement* root);
-  static int GetLevel(vtkXMLDataElement* node);
-  int GetFatherIndex(unsigned int nodeIndex);
+  // Build the LOD table of the tree in a single traversal, unless it is
+  // already built for fileName. The XML elements are parsed again whenever
+  // the reader is modified, so they can't identify the table.
+  void InitListUpdateNodes(vtkXMLDataElement* rootElement,
+                           const char* fileName);
+  void InitListUpdateNodes(vtkXMLDataElement* element,
+                           int fatherIndex,
+                           int level);
+
+  static bool IsNode(vtkXMLDataElement* element);
+
+  // Point the nodes to the elements of the current parse of the file.
+  void UpdateElements(vtkXMLDataElement* primaryElement);
+  void UpdateElements(vtkXMLDataElement* element, unsigned int& flatIndex);
+
+  // Set the LOD of the piece node at flatIndex, clamped to its LODs.
+  // Return true if it changed.
+  bool SetNodeLOD(int flatIndex, int lod);
+  // Return the flat index of the node of the piece pieceIndex, -1 if none.
+  int GetPieceFlatIndex(int pieceIndex);
   int GetFatherLOD(unsigned int nodeIndex);
-
-  // Use to know if a child of an LOD has to be considered or not
-  // bool ShouldReadNode(vtkXMLDataElement* node, int CurrentLODTreeLevel);
+  // Return the composite dataset the node at nodeIndex is a child of, the
+  // output for the children of the root.
+  vtkCompositeDataSet* GetFatherComposite(unsigned int nodeIndex);
+  // Return the number of cells of the datasets of the LOD lod of the piece
+  // node at pieceFlatIndex, -1 if unknown, and set bounds to their bounds.
+  vtkIdType GetLODStatistics(int pieceFlatIndex, int lod, double bounds[6]);
 
   vtkXMLReader* GetReaderOfType(const char* type);
 
-  // The information is stocked in this vector is as the follow:
-  // The index of the vector corresponds to the flatIndex of the tree.
-  // The int information is described as the follow:
-  // - If the node is a composite which is the piece which has the LODs
-  //   (At level-1), the it is the LOD set
-  // - If the node is a leaf, then the number correspond to his fatherIndex
+  // The index of the vector corresponds to the flatIndex of the tree, i.e.
+  // the root is 0 and each DataSet, Block or Piece element increments it in
+  // a preorder traversal, like the flat indices of the output.
+  // The pieces are the nodes at level CurrentLODTreeLevel-1: their children
+  // are their levels of detail.
   struct NodeInfos
   {
-    int MixedIndexFatherLOD;
+    int FatherIndex;   // Flat index of the father, -1 for the root
+    int ChildIndex;    // Index among the nested elements of the father
+    int Level;         // 0 for the root
+    int EndIndex;      // One past the flat index of the last descendant
+    int PieceIndex;    // Flat index of the piece the node belongs to, or -1
+    int NumberOfLODs;  // Pieces only
+    int LOD;           // Pieces only, -(lod+1) when the piece is hidden
+    int DataSetIndex;  // Leaves only, rank among the leaves, -1 otherwise
+    unsigned int BlockIndex;  // Index of the node in its father dataset
+    vtkXMLDataElement* Element;      // Element of the current parse
+    // Composite nodes but the root, which is the output. They are kept to
+    // rebuild the output when it is initialized before an update in place.
+    vtkSmartPointer<vtkCompositeDataSet> Composite;
+    vtkSmartPointer<vtkDataSet> DataSet;  // Leaves, in the output or resident
     vtkSmartPointer<vtkXMLReader> Reader;
+    // Leaves only, from the XML attributes or measured once read
+    vtkIdType NumberOfCells;  // -1 if unknown
+    double Bounds[6];         // Uninitialized (min > max) if unknown
+    // Leaves only, residency of DataSet
+    bool InOutput;             // Whether DataSet is in the output
+    unsigned long LastVisible; // Last update DataSet was in the output
+    unsigned long MemorySize;  // Of DataSet, in kibibytes
   };
   typedef std::vector<NodeInfos> NodesInfosType;
   NodesInfosType NodesInfos;
+  // Measure the dataset of a leaf unless its statistics are known.
+  static void MeasureLeaf(NodeInfos& nodeInfos);
+  // Flat index of the piece at each index among the root nested elements,
+  // -1 where the nested element is not a piece.
+  std::vector<int> Pieces;
+  // File the table was built for.
+  std::string TableFileName;
+  int NumberOfDataSets;
+
+  // Output filled by the last complete read, and the piece it was read for.
+  // As long as they don't change, only the leaves are updated.
+  vtkWeakPointer<vtkCompositeDataSet> Output;
+  int OutputPiece;
+  int OutputNumberOfPieces;
+
+  // Leaves to read in parallel, in flat index order.
+  std::vector<msvVTKXMLMultiblockLODReaderLeafJob> LeafJobs;
+
+  // Number of updates of the output, to order the leaves by visibility.
+  unsigned long NumberOfUpdates;
 
   bool RequestUpdateInformation;
   unsigned int CurrentFlatIndex;
@@ -114,18 +205,113 @@ public:
 };
 
 //------------------------------------------------------------------------------
-int msvVTKXMLMultiblockLODReaderInternal::GetFatherIndex(unsigned int nodeIndex)
+int msvVTKXMLMultiblockLODReaderInternal::GetFatherLOD(unsigned int nodeIndex)
 {
   assert(nodeIndex < this->NodesInfos.size());
-  return this->NodesInfos[nodeIndex].MixedIndexFatherLOD;
+  int fatherIndex = this->NodesInfos[nodeIndex].FatherIndex;
+  return fatherIndex >= 0 ? this->NodesInfos[fatherIndex].LOD : -1;
 }
 
 //------------------------------------------------------------------------------
-int msvVTKXMLMultiblockLODReaderInternal::GetFatherLOD(unsigned int nodeIndex)
+vtkCompositeDataSet* msvVTKXMLMultiblockLODReaderInternal::GetFatherComposite(
+  unsigned int nodeIndex)
 {
-  assert(nodeIndex < this->NodesInfos.size());
-  return this->NodesInfos[
-    this->GetFatherIndex(nodeIndex)].MixedIndexFatherLOD;
+  assert(nodeIndex > 0 && nodeIndex < this->NodesInfos.size());
+  int fatherIndex = this->NodesInfos[nodeIndex].FatherIndex;
+  return fatherIndex == 0 ? this->Output.GetPointer() :
+    this->NodesInfos[fatherIndex].Composite.GetPointer();
+}
+
+//------------------------------------------------------------------------------
+vtkIdType msvVTKXMLMultiblockLODReaderInternal::GetLODStatistics(
+  int pieceFlatIndex, int lod, double bounds[6])
+{
+  vtkMath::UninitializeBounds(bounds);
+  const NodeInfos& piece = this->NodesInfos[pieceFlatIndex];
+  vtkIdType numberOfCells = -1;
+  // Visit the children of the piece, skipping their descendants
+  for (int childIndex = pieceFlatIndex + 1; childIndex < piece.EndIndex;
+       childIndex = this->NodesInfos[childIndex].EndIndex)
+    {
+    const NodeInfos& child = this->NodesInfos[childIndex];
+    if (child.ChildIndex != lod)
+      {
+      continue;
+      }
+    numberOfCells = 0;
+    for (int flatIndex = childIndex; flatIndex < child.EndIndex; ++flatIndex)
+      {
+      const NodeInfos& leaf = this->NodesInfos[flatIndex];
+      if (leaf.DataSetIndex < 0)
+        {
+        continue;
+        }
+      if (leaf.NumberOfCells < 0)
+        {
+        return -1;
+        }
+      numberOfCells += leaf.NumberOfCells;
+      if (leaf.Bounds[0] > leaf.Bounds[1])
+        {
+        continue;
+        }
+      bool first = bounds[0] > bounds[1];
+      for (int i = 0; i < 3; ++i)
+        {
+        bounds[2*i] = first ? leaf.Bounds[2*i] :
+          std::min(bounds[2*i], leaf.Bounds[2*i]);
+        bounds[2*i+1] = first ? leaf.Bounds[2*i+1] :
+          std::max(bounds[2*i+1], leaf.Bounds[2*i+1]);
+        }
+      }
+    }
+  return numberOfCells;
+}
+
+//------------------------------------------------------------------------------
+void msvVTKXMLMultiblockLODReaderInternal::MeasureLeaf(NodeInfos& nodeInfos)
+{
+  if (!nodeInfos.DataSet)
+    {
+    return;
+    }
+  nodeInfos.MemorySize = nodeInfos.DataSet->GetActualMemorySize();
+  if (nodeInfos.NumberOfCells < 0)
+    {
+    nodeInfos.NumberOfCells = nodeInfos.DataSet->GetNumberOfCells();
+    }
+  if (nodeInfos.Bounds[0] > nodeInfos.Bounds[1])
+    {
+    nodeInfos.DataSet->GetBounds(nodeInfos.Bounds);
+    }
+}
+
+//------------------------------------------------------------------------------
+int msvVTKXMLMultiblockLODReaderInternal::GetPieceFlatIndex(int pieceIndex)
+{
+  if (pieceIndex < 0 || pieceIndex >= static_cast<int>(this->Pieces.size()))
+    {
+    return -1;
+    }
+  return this->Pieces[pieceIndex];
+}
+
+//------------------------------------------------------------------------------
+bool msvVTKXMLMultiblockLODReaderInternal::SetNodeLOD(int flatIndex, int lod)
+{
+  if (flatIndex < 0)
+    {
+    return false;
+    }
+  NodeInfos& node = this->NodesInfos[flatIndex];
+  // Clamp the LOD required to the available one
+  int clampLOD = std::min(lod, node.NumberOfLODs - 1);
+  if (node.LOD == clampLOD)
+    {
+    return false;
+    }
+  node.LOD = clampLOD;
+  return true;
 }
 
 //------------------------------------------------------------------------------
@@ -137,6 +323,10 @@ msvVTKXMLMultiblockLODReaderInternal()
 {
   this->RequestUpdateInformation = true;
   this->CurrentFlatIndex = 0;
+  this->NumberOfDataSets = 0;
+  this->OutputPiece = 0;
+  this->OutputNumberOfPieces = 1;
+  this->NumberOfUpdates = 0;
 
   // Read Only the low level of resolution by default
   this->DefaultLOD = 0;
@@ -152,363 +342,507 @@ msvVTKXMLMultiblockLODReaderInternal::
 }
 
 //------------------------------------------------------------------------------
-void msvVTKXMLMultiblockLODReaderInternal::InitListUpdateNodes(vtkXMLDataElement* primaryElement)
+bool msvVTKXMLMultiblockLODReaderInternal::IsNode(vtkXMLDataElement* element)
 {
-  unsigned int numberOfNodes = msvVTKXMLMultiblockLODReaderInternal::
-    CountNumberOfNodes(primaryElement);
+  const char* tagName = element ? element->GetName() : 0;
+  return tagName && (strcmp(tagName, "DataSet") == 0 ||
+                     strcmp(tagName, "Block") == 0 ||
+                     strcmp(tagName, "Piece") == 0);
+}
 
-  // Default values
-  msvVTKXMLMultiblockLODReaderInternal::NodeInfos nodeInfos = {-1,0};
-  this->NodesInfos.assign(numberOfNodes, nodeInfos);
-  this->CurrentFlatIndex = 0; // We reset the flatIndex
-  this->InitListUpdateNodes(primaryElement,
-                            this->CurrentLODTreeLevel,
-                            this->DefaultLOD);
+//------------------------------------------------------------------------------
+void msvVTKXMLMultiblockLODReaderInternal::InitListUpdateNodes(
+  vtkXMLDataElement* primaryElement, const char* fileName)
+{
+  std::string tableFileName = fileName ? fileName : "";
+  if (!primaryElement ||
+      (!this->RequestUpdateInformation &&
+       tableFileName == this->TableFileName &&
+       this->NodesInfos.size() > 0))
+    {
+    return;
+    }
+
+  this->NodesInfos.clear();
+  this->Pieces.clear();
+  this->TableFileName = tableFileName;
+  this->NumberOfDataSets = 0;
+  this->Output = 0;
+  this->InitListUpdateNodes(primaryElement, -1, 0);
   this->RequestUpdateInformation = false;
 }
 
 //------------------------------------------------------------------------------
 void msvVTKXMLMultiblockLODReaderInternal::InitListUpdateNodes(
   vtkXMLDataElement* element,
-  unsigned int lodTreeLevel,
-  unsigned int defaultLOD,
-  int parent)
+  int fatherIndex,
+  int level)
 {
-  if (element == 0)
+  int flatIndex = static_cast<int>(this->NodesInfos.size());
+  msvVTKXMLMultiblockLODReaderInternal::NodeInfos nodeInfos =
+    {fatherIndex, 0, level, flatIndex + 1, -1, 0, 0, -1, 0, element, 0, 0, 0,
+     -1, {1., -1., 1., -1., 1., -1.}, false, 0, 0};
+  if (fatherIndex >= 0)
     {
-    return;
+    nodeInfos.PieceIndex = this->NodesInfos[fatherIndex].PieceIndex;
+    }
+  // Father LOD level
+  if (level == this->CurrentLODTreeLevel - 1)
+    {
+    nodeInfos.PieceIndex = flatIndex;
+    nodeInfos.NumberOfLODs = element->GetNumberOfNestedElements();
+    // Clamp the LOD required to the available one
+    nodeInfos.LOD = std::min(this->DefaultLOD, nodeInfos.NumberOfLODs - 1);
     }
-
   const char* tag = element->GetName();
+  if (strcmp(tag, "DataSet") == 0)
+    {
+    nodeInfos.DataSetIndex = this->NumberOfDataSets++;
+    // Optional statistics, to select LODs before reading them
+    double numberOfCells = 0.;
+    if (element->GetScalarAttribute("number_of_cells", numberOfCells))
+      {
+      nodeInfos.NumberOfCells = static_cast<vtkIdType>(numberOfCells);
+      }
+    element->GetVectorAttribute("bounds", 6, nodeInfos.Bounds);
+    }
+  this->NodesInfos.push_back(nodeInfos);
+
+  // Only composite nodes have children
   if (strcmp(tag, "vtkMultiBlockDataSet") != 0 &&
-        strcmp(tag, "Block") != 0 && strcmp(tag, "Piece") != 0)
+      strcmp(tag, "Block") != 0 && strcmp(tag, "Piece") != 0)
     {
     return;
     }
 
   unsigned int maxElems = element->GetNumberOfNestedElements();
+  if (level == 0)
+    {
+    this->Pieces.assign(maxElems, -1);
+    }
   for (unsigned int cc=0; cc < maxElems; ++cc)
     {
     vtkXMLDataElement* childXML = element->GetNestedElement(cc);
-    if (!childXML ||
-        (strcmp(childXML->GetName(), "DataSet") != 0 &&
-         strcmp(childXML->GetName(), "Block") != 0 &&
-         strcmp(childXML->GetName(), "Piece") != 0))
+    if (!msvVTKXMLMultiblockLODReaderInternal::IsNode(childXML))
       {
       continue;
       }
 
-    this->CurrentFlatIndex++;
-
-    // Father LOD level
-    if (msvVTKXMLMultiblockLODReaderInternal::GetLevel(childXML) ==
-        static_cast<int>(lodTreeLevel)-1)
-      {
-      // Clamp the LOD required to the available one
-      unsigned int clampLOD = std::min(defaultLOD,
-        static_cast<unsigned int>(childXML->GetNumberOfNestedElements())-1);
-
-      this->NodesInfos[this->CurrentFlatIndex].MixedIndexFatherLOD = clampLOD;
-      }
-    // The node is not at the level just above the LODs
-    else
+    int childIndex = static_cast<int>(this->NodesInfos.size());
+    this->InitListUpdateNodes(childXML, flatIndex, level + 1);
+    this->NodesInfos[childIndex].ChildIndex = cc;
+    if (level == 0 && this->CurrentLODTreeLevel == 2)
       {
-      this->NodesInfos[this->CurrentFlatIndex].MixedIndexFatherLOD = parent;
+      this->Pieces[cc] = childIndex;
       }
+    }
+  this->NodesInfos[flatIndex].EndIndex =
+    static_cast<int>(this->NodesInfos.size());
+}
 
-    // Child is a block or a multipiece
-    const char* tagName = childXML->GetName();
-    if (strcmp(tagName, "Block") == 0 || strcmp(tagName, "Piece") == 0)
-      {
-      this->InitListUpdateNodes(childXML,
-                                lodTreeLevel,
-                                defaultLOD,
-                                this->CurrentFlatIndex);
-      }
+//------------------------------------------------------------------------------
+void msvVTKXMLMultiblockLODReaderInternal::UpdateElements(
+  vtkXMLDataElement* primaryElement)
+{
+  // The elements are freed by each parse, and a new primary element may be
+  // allocated where the previous one was, so always walk the tree again.
+  unsigned int flatIndex = 0;
+  if (primaryElement)
+    {
+    this->UpdateElements(primaryElement, flatIndex);
     }
 }
 
 //------------------------------------------------------------------------------
-void msvVTKXMLMultiblockLODReaderInternal::SetLODToNodes(
-  vtkXMLDataElement* element,
-  unsigned int lodTreeLevel,
-  int pieceIndex,
-  int lod)
+void msvVTKXMLMultiblockLODReaderInternal::UpdateElements(
+  vtkXMLDataElement* element, unsigned int& flatIndex)
 {
-  if (element == 0)
+  if (flatIndex >= this->NodesInfos.size())
     {
     return;
     }
-  const char* tag = element->GetName();
-  if (strcmp(tag, "vtkMultiBlockDataSet") != 0 &&
-      strcmp(tag, "Block") != 0 &&
-      strcmp(tag, "Piece") != 0)
+  NodeInfos& nodeInfos = this->NodesInfos[flatIndex++];
+  nodeInfos.Element = element;
+  if (nodeInfos.DataSetIndex >= 0)
     {
     return;
     }
-
   unsigned int maxElems = element->GetNumberOfNestedElements();
   for (unsigned int cc=0; cc < maxElems; ++cc)
     {
     vtkXMLDataElement* childXML = element->GetNestedElement(cc);
-    if (!childXML ||
-        (strcmp(childXML->GetName(), "DataSet") != 0 &&
-         strcmp(childXML->GetName(), "Block") != 0 &&
-         strcmp(childXML->GetName(), "Piece") != 0))
+    if (msvVTKXMLMultiblockLODReaderInternal::IsNode(childXML))
       {
-      continue;
+      this->UpdateElements(childXML, flatIndex);
       }
+    }
+}
 
-    this->CurrentFlatIndex++;
+//------------------------------------------------------------------------------
+namespace
+{
+void SetChild(vtkCompositeDataSet* composite, unsigned int index,
+              vtkDataObject* child, const char* name)
+{
+  vtkMultiBlockDataSet* mblock = vtkMultiBlockDataSet::SafeDownCast(composite);
+  vtkMultiPieceDataSet* mpiece = vtkMultiPieceDataSet::SafeDownCast(composite);
+  if (mblock)
+    {
+    mblock->SetBlock(index, child);
+    mblock->GetMetaData(index)->Set(vtkCompositeDataSet::NAME(), name);
+    }
+  else if (mpiece)
+    {
+    mpiece->SetPiece(index, child);
+    mpiece->GetMetaData(index)->Set(vtkCompositeDataSet::NAME(), name);
+    }
+}
+}
 
-    // Parents of the LOD definitions - We set the information
-    // If there is a specific piece which need to change but not the current
-    // one we just continue to go through the tree
-    if (msvVTKXMLMultiblockLODReaderInternal::GetLevel(childXML) ==
-        static_cast<int>(lodTreeLevel)-1 &&
-        ((pieceIndex >= 0 && static_cast<unsigned int>(pieceIndex) == cc) ||
-         pieceIndex == -1))
-      {
-      // Clamp the LOD required to the available one
-      int clampLOD = std::min(lod,
-        childXML->GetNumberOfNestedElements()-1);
+//------------------------------------------------------------------------------
+// msvVTKXMLMultiblockLODReader methods
 
-      this->NodesInfos[this->CurrentFlatIndex].MixedIndexFatherLOD = clampLOD;
-      }
+//------------------------------------------------------------------------------
+vtkStandardNewMacro(msvVTKXMLMultiblockLODReader);
 
-    // Child is a multiblock dataset itself or a multipiece
-    const char* tagName = childXML->GetName();
-    if (strcmp(tagName, "Block") == 0 ||
-        strcmp(tagName, "Piece") == 0)
-      {
-      this->SetLODToNodes(childXML, lodTreeLevel, -1, lod);
-      }
-    }
+//------------------------------------------------------------------------------
+msvVTKXMLMultiblockLODReader::msvVTKXMLMultiblockLODReader()
+{
+  this->Internal = new msvVTKXMLMultiblockLODReaderInternal;
+  this->NumberOfDataSetReads = 0;
+  this->NumberOfReadThreads = 1;
+  this->MemoryBudget = 262144;
+  this->CacheHits = 0;
+  this->CacheMisses = 0;
+  this->CacheEvictions = 0;
 }
 
 //------------------------------------------------------------------------------
-bool msvVTKXMLMultiblockLODReaderInternal::GetNodeLOD(
-  vtkXMLDataElement* element,
-  unsigned int lodTreeLevel,
-  int pieceIndex,
-  int& lod
-  )
+msvVTKXMLMultiblockLODReader::~msvVTKXMLMultiblockLODReader()
+{
+  delete this->Internal;
+}
+
+//------------------------------------------------------------------------------
+int msvVTKXMLMultiblockLODReader
+::RequestInformation(vtkInformation *request,
+                     vtkInformationVector **vtkNotUsed(inputVector),
+                     vtkInformationVector *outputVector)
 {
-  bool res = false;
-  if (element == 0)
+  return Superclass::RequestInformation(request, 0, outputVector);
+}
+
+//------------------------------------------------------------------------------
+int msvVTKXMLMultiblockLODReader::
+RequestData(vtkInformation* request,
+            vtkInformationVector** inputVector,
+            vtkInformationVector* outputVector)
+{
+  // Build the LOD table the first time and whenever the file changes.
+  vtkXMLDataElement* primaryElement = this->GetPrimaryElement();
+  this->Internal->InitListUpdateNodes(primaryElement, this->GetFileName());
+  this->Internal->UpdateElements(primaryElement);
+
+  vtkInformation* outInfo = outputVector->GetInformationObject(0);
+  vtkCompositeDataSet* output = vtkCompositeDataSet::SafeDownCast(
+    outInfo->Get(vtkDataObject::DATA_OBJECT()));
+  int piece = 0;
+  int numberOfPieces = 1;
+  if (outInfo->Has(vtkStreamingDemandDrivenPipeline::UPDATE_PIECE_NUMBER()))
     {
-    assert(element != 0);
-    return res;
+    piece = outInfo->Get(
+      vtkStreamingDemandDrivenPipeline::UPDATE_PIECE_NUMBER());
     }
-  const char* tag = element->GetName();
-  if (strcmp(tag, "vtkMultiBlockDataSet") != 0 &&
-      strcmp(tag, "Block") != 0 &&
-      strcmp(tag, "Piece") != 0)
+  if (outInfo->Has(
+        vtkStreamingDemandDrivenPipeline::UPDATE_NUMBER_OF_PIECES()))
     {
-    return res;
+    numberOfPieces = outInfo->Get(
+      vtkStreamingDemandDrivenPipeline::UPDATE_NUMBER_OF_PIECES());
     }
 
-  unsigned int maxElems = element->GetNumberOfNestedElements();
-  for (unsigned int cc=0; cc < maxElems; ++cc)
+  // If only LODs changed since the output was read, update its leaves in
+  // place instead of reading the whole composite again.
+  if (output && output == this->Internal->Output.GetPointer() &&
+      piece == this->Internal->OutputPiece &&
+      numberOfPieces == this->Internal->OutputNumberOfPieces &&
+      !outInfo->Has(vtkCompositeDataPipeline::UPDATE_COMPOSITE_INDICES()))
     {
-    vtkXMLDataElement* childXML = element->GetNestedElement(cc);
-    if (!childXML ||
-        (strcmp(childXML->GetName(), "DataSet") != 0 &&
-         strcmp(childXML->GetName(), "Block") != 0 &&
-         strcmp(childXML->GetName(), "Piece") != 0))
-      {
-      continue;
-      }
-
-    this->CurrentFlatIndex++;
-    // Parents of the LOD definitions - We set the information
-    // If there is a specific piece which need to change but not the current
-    // one we just continue to go through the tree
-    if (msvVTKXMLMultiblockLODReaderInternal::GetLevel(childXML) ==
-        static_cast<int>(lodTreeLevel)-1 &&
-        ((pieceIndex >= 0 && static_cast<unsigned int>(pieceIndex) == cc) ||
-         pieceIndex == -1))
-      {
-      lod = this->NodesInfos[this->CurrentFlatIndex].MixedIndexFatherLOD;
-      res = true;
-      break;
-      }
+    this->AttachRootChildren();
+    this->UpdateLeaves(
+      vtksys::SystemTools::GetFilenamePath(this->GetFileName()).c_str());
+    int retVal = this->ReadLeafJobs();
+    this->EvictLeaves();
+    return retVal;
+    }
 
-    // Child is a multiblock dataset itself or a multipiece
-    const char* tagName = childXML->GetName();
-    if (strcmp(tagName, "Block") == 0 ||
-        strcmp(tagName, "Piece") == 0)
-      {
-      res = this->GetNodeLOD(childXML, lodTreeLevel, -1, lod);
-      if (res)
-        {
-        break;
-        }
-      }
+  // The leaves read in parallel are inserted in the output by
+  // ReadLeafJobs().
+  this->Internal->Output = output;
+  this->Internal->CurrentFlatIndex = 0;
+  int retVal = Superclass::RequestData(request, inputVector, outputVector);
+  retVal = this->ReadLeafJobs() && retVal;
+  this->EvictLeaves();
+  if (!retVal || this->GetFileMajorVersion() < 1)
+    {
+    this->Internal->Output = 0;
+    return retVal;
     }
-  return res;
+  this->Internal->OutputPiece = piece;
+  this->Internal->OutputNumberOfPieces = numberOfPieces;
+  return 1;
 }
 
 //------------------------------------------------------------------------------
-int msvVTKXMLMultiblockLODReaderInternal
-::GetNodePieceIndex(vtkXMLDataElement* element,
-                    vtkIdType compositeIndex)
+void msvVTKXMLMultiblockLODReader::AttachRootChildren()
 {
-  if (element == 0)
-    {
-    return -1;
-    }
-  const char* tag = element->GetName();
-  if (strcmp(tag, "vtkMultiBlockDataSet") != 0 &&
-      strcmp(tag, "Block") != 0 &&
-      strcmp(tag, "Piece") != 0)
+  msvVTKXMLMultiblockLODReaderInternal::NodesInfosType& nodesInfos =
+    this->Internal->NodesInfos;
+  vtkCompositeDataSet* output = this->Internal->Output;
+  for (unsigned int childIndex = 1; childIndex < nodesInfos.size();
+       childIndex = nodesInfos[childIndex].EndIndex)
     {
-    return -1;
+    const msvVTKXMLMultiblockLODReaderInternal::NodeInfos& child =
+      nodesInfos[childIndex];
+    vtkDataObject* childDO = child.Composite.GetPointer();
+    if (!childDO && child.InOutput)
+      {
+      childDO = child.DataSet;
+      }
+    const char* name = (childDO && child.Element) ?
+      child.Element->GetAttribute("name") : 0;
+    SetChild(output, child.BlockIndex, childDO, name);
     }
+}
 
-  unsigned int maxElems = element->GetNumberOfNestedElements();
-  for (unsigned int cc=0; cc < maxElems; ++cc)
+//------------------------------------------------------------------------------
+void msvVTKXMLMultiblockLODReader::UpdateLeaves(const char* filePath)
+{
+  msvVTKXMLMultiblockLODReaderInternal::NodesInfosType& nodesInfos =
+    this->Internal->NodesInfos;
+  for (unsigned int flatIndex = 1; flatIndex < nodesInfos.size(); ++flatIndex)
     {
-    vtkXMLDataElement* childXML = element->GetNestedElement(cc);
-    if (!childXML ||
-        (strcmp(childXML->GetName(), "DataSet") != 0 &&
-         strcmp(childXML->GetName(), "Block") != 0 &&
-         strcmp(childXML->GetName(), "Piece") != 0))
+    msvVTKXMLMultiblockLODReaderInternal::NodeInfos& nodeInfos =
+      nodesInfos[flatIndex];
+    if (nodeInfos.DataSetIndex < 0 || !nodeInfos.Element)
       {
       continue;
       }
-
-    this->CurrentFlatIndex++;
-
-    if (this->CurrentFlatIndex == compositeIndex)
+    this->Internal->CurrentFlatIndex = flatIndex;
+    bool read = this->ShouldGetDataSet(nodeInfos.DataSetIndex,
+                                       nodeInfos.Element);
+    // Unchanged leaf
+    if (read == nodeInfos.InOutput)
       {
-      return cc;
+      continue;
       }
 
-    // Child is a multiblock dataset itself or a multipiece
-    const char* tagName = childXML->GetName();
-    if (strcmp(tagName, "Block") == 0 ||
-        strcmp(tagName, "Piece") == 0)
+    vtkDataSet* childDS = 0;
+    const char* name = 0;
+    if (read)
       {
-      int res = this->GetNodePieceIndex(childXML, compositeIndex);
-      if (res >= 0)
-        {
-        return res;
-        }
+      childDS = this->GetLeafDataSet(nodeInfos.Element, filePath);
+      name = nodeInfos.Element->GetAttribute("name");
       }
+    else
+      {
+      // Keep the dataset resident until it is evicted.
+      nodeInfos.InOutput = false;
+      nodeInfos.Reader = 0;
+      }
+    SetChild(this->Internal->GetFatherComposite(flatIndex),
+             nodeInfos.BlockIndex, childDS, name);
     }
-  return -1;
 }
 
 //------------------------------------------------------------------------------
-unsigned int msvVTKXMLMultiblockLODReaderInternal
-::CountNumberOfNodes(vtkXMLDataElement* node)
+vtkDataSet* msvVTKXMLMultiblockLODReader::
+GetLeafDataSet(vtkXMLDataElement* element, const char* filePath)
 {
-  if (node == 0)
+  msvVTKXMLMultiblockLODReaderInternal::NodeInfos& nodeInfos =
+    this->Internal->NodesInfos[this->Internal->CurrentFlatIndex];
+  if (nodeInfos.DataSet)
     {
-    return 0;
+    // Already in the output, or resident since it left it.
+    this->CacheHits += nodeInfos.InOutput ? 0 : 1;
+    nodeInfos.InOutput = true;
+    return nodeInfos.DataSet;
     }
-
-  const char* tagName = node->GetName();
-  if (strcmp(tagName, "DataSet") == 0)
+  if (!nodeInfos.InOutput)
     {
-    return 1;
+    ++this->CacheMisses;
+    }
+  if (this->NumberOfReadThreads <= 1)
+    {
+    nodeInfos.DataSet.TakeReference(this->ReadDataset(element, filePath));
+    msvVTKXMLMultiblockLODReaderInternal::MeasureLeaf(nodeInfos);
+    nodeInfos.InOutput = nodeInfos.DataSet.GetPointer() != 0;
+    ++this->NumberOfDataSetReads;
+    return nodeInfos.DataSet;
     }
 
-  // Neither a Block, a Piece nor a MultiBlock, we ignore the node
-  else if (strcmp(tagName, "vtkMultiBlockDataSet") != 0 &&
-      strcmp(tagName, "Block") != 0 && strcmp(tagName, "Piece") != 0)
+  // Queue the leaf for ReadLeafJobs(), on the reader of its node.
+  const char* file = element->GetAttribute("file");
+  if (!file)
     {
     return 0;
     }
-
-  unsigned int numberOfSubNodes = 1;
-  unsigned int maxElems = node->GetNumberOfNestedElements();
-  for (unsigned int cc=0; cc < maxElems; ++cc)
+  std::string fileName;
+  if (file[0] != '/' && filePath && filePath[0])
+    {
+    fileName = filePath;
+    fileName += "/";
+    }
+  fileName += file;
+  std::string ext = vtksys::SystemTools::GetFilenameLastExtension(fileName);
+  if (ext.size() > 0)
+    {
+    ext.erase(0, 1);
+    }
+  const char* rname = 0;
+  for (const vtkXMLCompositeDataReaderEntry* readerEntry =
+         vtkXMLCompositeDataReaderEntries;
+       !rname && readerEntry->extension; ++readerEntry)
     {
-    vtkXMLDataElement* childXML = node->GetNestedElement(cc);
-    if (!childXML)
+    if (ext == readerEntry->extension)
       {
-      continue;
+      rname = readerEntry->name;
       }
-
-    numberOfSubNodes +=
-      msvVTKXMLMultiblockLODReaderInternal::CountNumberOfNodes(childXML);
     }
-
-  return numberOfSubNodes;
+  vtkXMLReader* reader = rname ? this->GetReaderOfType(rname) : 0;
+  if (!reader)
+    {
+    vtkErrorMacro("Could not create reader for " << fileName.c_str());
+    return 0;
+    }
+  if (reader != nodeInfos.Reader.GetPointer())
+    {
+    nodeInfos.Reader.TakeReference(reader);
+    }
+  reader->SetFileName(fileName.c_str());
+  msvVTKXMLMultiblockLODReaderLeafJob job =
+    {this->Internal->CurrentFlatIndex, reader, element->GetAttribute("name"),
+     0};
+  this->Internal->LeafJobs.push_back(job);
+  nodeInfos.InOutput = true;
+  return 0;
 }
 
 //------------------------------------------------------------------------------
-int msvVTKXMLMultiblockLODReaderInternal
-::GetLevel(vtkXMLDataElement* node)
+int msvVTKXMLMultiblockLODReader::ReadLeafJobs()
 {
-  if (!node)
+  std::vector<msvVTKXMLMultiblockLODReaderLeafJob>& jobs =
+    this->Internal->LeafJobs;
+  if (jobs.empty())
     {
-    return -1;
+    return 1;
     }
 
-  int level = 0;
-  const char* tagName = node->GetName();
+  vtkNew<vtkMultiThreader> threader;
+  threader->SetNumberOfThreads(
+    std::min(static_cast<int>(jobs.size()), this->NumberOfReadThreads));
+  threader->SetSingleMethod(msvReadLeaves, &jobs);
+  threader->SingleMethodExecute();
 
-  // vtkMultiBlockDataSet must be the root of our composite dataset
-  while (node && strcmp(tagName, "vtkMultiBlockDataSet") != 0)
+  // Insert the leaves in flat index order.
+  int retVal = 1;
+  for (size_t i = 0; i < jobs.size(); ++i)
     {
-    node = node->GetParent();
-    if (node)
+    msvVTKXMLMultiblockLODReaderInternal::NodeInfos& nodeInfos =
+      this->Internal->NodesInfos[jobs[i].FlatIndex];
+    nodeInfos.DataSet.TakeReference(jobs[i].Output);
+    msvVTKXMLMultiblockLODReaderInternal::MeasureLeaf(nodeInfos);
+    ++this->NumberOfDataSetReads;
+    if (!jobs[i].Output)
       {
-      tagName = node->GetName();
+      vtkErrorMacro("Could not read " << jobs[i].Reader->GetFileName());
+      nodeInfos.InOutput = false;
+      retVal = 0;
+      continue;
       }
-
-    ++level;
+    SetChild(this->Internal->GetFatherComposite(jobs[i].FlatIndex),
+             nodeInfos.BlockIndex, jobs[i].Output, jobs[i].Name);
     }
-
-  return level;
+  jobs.clear();
+  return retVal;
 }
 
 //------------------------------------------------------------------------------
-// msvVTKXMLMultiblockLODReader methods
-
-//------------------------------------------------------------------------------
-vtkStandardNewMacro(msvVTKXMLMultiblockLODReader);
-
-//------------------------------------------------------------------------------
-msvVTKXMLMultiblockLODReader::msvVTKXMLMultiblockLODReader()
-{
-  this->Internal = new msvVTKXMLMultiblockLODReaderInternal;
-}
-
-//------------------------------------------------------------------------------
-msvVTKXMLMultiblockLODReader::~msvVTKXMLMultiblockLODReader()
+void msvVTKXMLMultiblockLODReader::EvictLeaves()
 {
+  msvVTKXMLMultiblockLODReaderInternal::NodesInfosType& nodesInfos =
+    this->Internal->NodesInfos;
+  unsigned long update = ++this->Internal->NumberOfUpdates;
+  unsigned long memorySize = 0;
+  // Resident leaves out of the output, by last visibility
+  std::vector<std::pair<unsigned long, unsigned int> > evictable;
+  for (unsigned int flatIndex = 0; flatIndex < nodesInfos.size(); ++flatIndex)
+    {
+    msvVTKXMLMultiblockLODReaderInternal::NodeInfos& nodeInfos =
+      nodesInfos[flatIndex];
+    if (!nodeInfos.DataSet)
+      {
+      continue;
+      }
+    memorySize += nodeInfos.MemorySize;
+    if (nodeInfos.InOutput)
+      {
+      nodeInfos.LastVisible = update;
+      }
+    else
+      {
+      evictable.push_back(std::make_pair(nodeInfos.LastVisible, flatIndex));
+      }
+    }
+  if (memorySize <= this->MemoryBudget)
+    {
+    return;
+    }
 
+  std::sort(evictable.begin(), evictable.end());
+  for (size_t i = 0; i < evictable.size() && memorySize > this->MemoryBudget;
+       ++i)
+    {
+    msvVTKXMLMultiblockLODReaderInternal::NodeInfos& nodeInfos =
+      nodesInfos[evictable[i].second];
+    memorySize -= nodeInfos.MemorySize;
+    nodeInfos.DataSet = 0;
+    nodeInfos.MemorySize = 0;
+    ++this->CacheEvictions;
+    }
 }
 
 //------------------------------------------------------------------------------
-int msvVTKXMLMultiblockLODReader
-::RequestInformation(vtkInformation *request,
-                     vtkInformationVector **vtkNotUsed(inputVector),
-                     vtkInformationVector *outputVector)
+unsigned long msvVTKXMLMultiblockLODReader::GetCacheMemorySize()
 {
-  return Superclass::RequestInformation(request, 0, outputVector);
+  unsigned long memorySize = 0;
+  msvVTKXMLMultiblockLODReaderInternal::NodesInfosType::const_iterator it;
+  for (it = this->Internal->NodesInfos.begin();
+       it != this->Internal->NodesInfos.end(); ++it)
+    {
+    memorySize += it->DataSet ? it->MemorySize : 0;
+    }
+  return memorySize;
 }
 
 //------------------------------------------------------------------------------
-int msvVTKXMLMultiblockLODReader::
-RequestData(vtkInformation* request,
-            vtkInformationVector** inputVector,
-            vtkInformationVector* outputVector)
+int msvVTKXMLMultiblockLODReader::GetNumberOfCachedLeaves()
 {
-  // Use if the XML is modified outside of the application or the first time.
-  // TODO: set RequestUpdateInformation to true when modified
-  if (this->Internal->RequestUpdateInformation ||
-      this->Internal->NodesInfos.size() == 0)
+  int numberOfLeaves = 0;
+  msvVTKXMLMultiblockLODReaderInternal::NodesInfosType::const_iterator it;
+  for (it = this->Internal->NodesInfos.begin();
+       it != this->Internal->NodesInfos.end(); ++it)
     {
-    this->Internal->InitListUpdateNodes(this->GetPrimaryElement());
+    numberOfLeaves += (it->DataSet && !it->InOutput) ? 1 : 0;
     }
+  return numberOfLeaves;
+}
 
-  this->Internal->CurrentFlatIndex = 0;
-  return Superclass::RequestData(request, inputVector, outputVector);
+//------------------------------------------------------------------------------
+void msvVTKXMLMultiblockLODReader::ResetCacheStatistics()
+{
+  this->CacheHits = 0;
+  this->CacheMisses = 0;
+  this->CacheEvictions = 0;
 }
 
 //------------------------------------------------------------------------------
@@ -563,36 +897,29 @@ ReadComposite(vtkXMLDataElement* element,
     if (strcmp(tagName, "DataSet") == 0)
       {
       this->Internal->CurrentFlatIndex++;
+      msvVTKXMLMultiblockLODReaderInternal::NodeInfos& nodeInfos =
+        this->Internal->NodesInfos[this->Internal->CurrentFlatIndex];
+      nodeInfos.BlockIndex = index;
 
-      vtkSmartPointer<vtkDataSet> childDS;
+      vtkDataSet* childDS = 0;
       const char* name = 0;
 
       if (this->ShouldGetDataSet(dataSetIndex, childXML))
         {
-        childDS.TakeReference(this->ReadDataset(childXML, filePath));
+        // Reuse the dataset of the previous output if any.
+        childDS = this->GetLeafDataSet(childXML, filePath);
         name = childXML->GetAttribute("name");
         }
       else
         {
-        // We clean its reader if the node got one;
-        // We should put the function within the set but would break the optimization -- Check
-        if (this->Internal->NodesInfos[this->Internal->CurrentFlatIndex].Reader)
-          {
-          this->Internal->NodesInfos[this->Internal->CurrentFlatIndex].Reader = 0;
-          }
+        // Release the reader if the node got one. The dataset stays
+        // resident until it is evicted.
+        nodeInfos.InOutput = false;
+        nodeInfos.Reader = 0;
         }
 
       // insert
-      if (mblock)
-        {
-        mblock->SetBlock(index, childDS);
-        mblock->GetMetaData(index)->Set(vtkCompositeDataSet::NAME(), name);
-        }
-      else if (mpiece)
-        {
-        mpiece->SetPiece(index, childDS);
-        mpiece->GetMetaData(index)->Set(vtkCompositeDataSet::NAME(), name);
-        }
+      SetChild(composite, index, childDS, name);
 
       dataSetIndex++;
       }
@@ -601,8 +928,12 @@ ReadComposite(vtkXMLDataElement* element,
     else if (mblock != 0 && strcmp(tagName, "Block") == 0)
       {
       this->Internal->CurrentFlatIndex++;
+      msvVTKXMLMultiblockLODReaderInternal::NodeInfos& nodeInfos =
+        this->Internal->NodesInfos[this->Internal->CurrentFlatIndex];
 
       vtkMultiBlockDataSet* childDS = vtkMultiBlockDataSet::New();
+      nodeInfos.BlockIndex = index;
+      nodeInfos.Composite = childDS;
       this->ReadComposite(childXML, childDS, filePath, dataSetIndex);
       const char* name = childXML->GetAttribute("name");
       mblock->SetBlock(index, childDS);
@@ -614,8 +945,12 @@ ReadComposite(vtkXMLDataElement* element,
     else if (mblock!=0 && strcmp(tagName, "Piece") == 0)
       {
       this->Internal->CurrentFlatIndex++;
+      msvVTKXMLMultiblockLODReaderInternal::NodeInfos& nodeInfos =
+        this->Internal->NodesInfos[this->Internal->CurrentFlatIndex];
 
       vtkMultiPieceDataSet* childDS = vtkMultiPieceDataSet::New();
+      nodeInfos.BlockIndex = index;
+      nodeInfos.Composite = childDS;
       this->ReadComposite(childXML, childDS, filePath, dataSetIndex);
       const char* name = childXML->GetAttribute("name");
       mblock->SetBlock(index, childDS);
@@ -681,9 +1016,10 @@ vtkXMLReader* msvVTKXMLMultiblockLODReader::GetReaderOfType(const char* type)
 
 //------------------------------------------------------------------------------
 bool msvVTKXMLMultiblockLODReader::ShouldGetDataSet(int dataSetIndex,
-                                                   vtkXMLDataElement* node)
+                                                   vtkXMLDataElement* vtkNotUsed(node))
 {
-  int nodeLevel = msvVTKXMLMultiblockLODReaderInternal::GetLevel(node);
+  const msvVTKXMLMultiblockLODReaderInternal::NodeInfos& nodeInfos =
+    this->Internal->NodesInfos[this->Internal->CurrentFlatIndex];
 
   // If we should not read the data or if the parent should not be get
   // DataSetIndex is set to -1 when the data is a composite node.
@@ -696,11 +1032,10 @@ bool msvVTKXMLMultiblockLODReader::ShouldGetDataSet(int dataSetIndex,
 
   // Otherwise, we should get the dataset if the we are not at the LOD level
   // Or if the node corresponds to the LOD set by its parent.
-  vtkXMLDataElement* father = node->GetParent();
   int currentLOD =
       this->Internal->GetFatherLOD(this->Internal->CurrentFlatIndex);
-  if (nodeLevel != this->Internal->CurrentLODTreeLevel ||
-      node == father->GetNestedElement(currentLOD))
+  if (nodeInfos.Level != this->Internal->CurrentLODTreeLevel ||
+      nodeInfos.ChildIndex == currentLOD)
     {
     return true;
     }
@@ -712,6 +1047,14 @@ bool msvVTKXMLMultiblockLODReader::ShouldGetDataSet(int dataSetIndex,
 void msvVTKXMLMultiblockLODReader::PrintSelf(ostream& os, vtkIndent indent)
 {
   this->Superclass::PrintSelf(os, indent);
+  os << indent << "NumberOfDataSetReads: " << this->NumberOfDataSetReads
+     << endl;
+  os << indent << "NumberOfReadThreads: " << this->NumberOfReadThreads
+     << endl;
+  os << indent << "MemoryBudget: " << this->MemoryBudget << endl;
+  os << indent << "CacheHits: " << this->CacheHits << endl;
+  os << indent << "CacheMisses: " << this->CacheMisses << endl;
+  os << indent << "CacheEvictions: " << this->CacheEvictions << endl;
 
   std::vector<msvVTKXMLMultiblockLODReaderInternal::NodeInfos>::iterator
     itC = this->Internal->NodesInfos.begin();
@@ -720,7 +1063,8 @@ void msvVTKXMLMultiblockLODReader::PrintSelf(ostream& os, vtkIndent indent)
   for (;itC!=this->Internal->NodesInfos.end();++itC)
     {
     os << indent << "FlatIndex: " << index++
-       << indent << " | Father/LOD: " << itC->MixedIndexFatherLOD
+       << indent << " | Father: " << itC->FatherIndex
+       << indent << " | LOD: " << itC->LOD
        << indent << " | Reader: " << itC->Reader.GetPointer();
 
     if (itC->Reader.GetPointer())
@@ -740,9 +1084,18 @@ unsigned int  msvVTKXMLMultiblockLODReader::GetDefaultLOD()
 //------------------------------------------------------------------------------
 void msvVTKXMLMultiblockLODReader::SetDefaultLOD(unsigned int lod)
 {
-  this->Internal->CurrentFlatIndex = 0;
-  this->Internal->SetLODToNodes(this->GetPrimaryElement(),
-                                this->Internal->CurrentLODTreeLevel, -1, lod);
+  this->Internal->InitListUpdateNodes(this->GetPrimaryElement(),
+                                      this->GetFileName());
+  msvVTKXMLMultiblockLODReaderInternal::NodesInfosType::iterator it;
+  for (it = this->Internal->NodesInfos.begin();
+       it != this->Internal->NodesInfos.end(); ++it)
+    {
+    if (it->Level == this->Internal->CurrentLODTreeLevel - 1)
+      {
+      // Clamp the LOD required to the available one
+      it->LOD = std::min(static_cast<int>(lod), it->NumberOfLODs - 1);
+      }
+    }
   this->Internal->DefaultLOD = lod;
   this->Modified();
 }
@@ -750,22 +1103,50 @@ void msvVTKXMLMultiblockLODReader::SetDefaultLOD(unsigned int lod)
 //------------------------------------------------------------------------------
 void msvVTKXMLMultiblockLODReader::SetPieceLOD(int pieceIndex, unsigned int lod)
 {
-  this->Internal->CurrentFlatIndex = 0;
-  this->Internal->SetLODToNodes(this->GetPrimaryElement(),
-                                this->Internal->CurrentLODTreeLevel,
-                                pieceIndex, lod);
+  this->SetPieceLODs(1, &pieceIndex, &lod);
+}
 
-  this->Modified();
+//------------------------------------------------------------------------------
+void msvVTKXMLMultiblockLODReader::SetPieceLODs(int numberOfPieces,
+                                                const int* pieceIndices,
+                                                const unsigned int* lods)
+{
+  this->Internal->InitListUpdateNodes(this->GetPrimaryElement(),
+                                      this->GetFileName());
+  bool modified = false;
+  for (int i = 0; i < numberOfPieces; ++i)
+    {
+    int flatIndex = this->Internal->GetPieceFlatIndex(pieceIndices[i]);
+    modified = this->Internal->SetNodeLOD(
+      flatIndex, static_cast<int>(lods[i])) || modified;
+    }
+  if (modified)
+    {
+    this->Modified();
+    }
+}
+
+//------------------------------------------------------------------------------
+int msvVTKXMLMultiblockLODReader::GetPieceLOD(int pieceIndex)
+{
+  this->Internal->InitListUpdateNodes(this->GetPrimaryElement(),
+                                      this->GetFileName());
+  int flatIndex = this->Internal->GetPieceFlatIndex(pieceIndex);
+  return flatIndex >= 0 ? this->Internal->NodesInfos[flatIndex].LOD : 0;
 }
 
 //------------------------------------------------------------------------------
 void msvVTKXMLMultiblockLODReader::SetPieceVisibility(int pieceIndex, bool visible)
 {
-  this->Internal->CurrentFlatIndex = 0;
-  int lod = 0;
-  bool found = this->Internal->GetNodeLOD(this->GetPrimaryElement(),
-                                          this->Internal->CurrentLODTreeLevel, pieceIndex, lod);
-  assert(found);
+  this->Internal->InitListUpdateNodes(this->GetPrimaryElement(),
+                                      this->GetFileName());
+  int flatIndex = this->Internal->GetPieceFlatIndex(pieceIndex);
+  assert(flatIndex >= 0);
+  if (flatIndex < 0)
+    {
+    return;
+    }
+  int lod = this->Internal->NodesInfos[flatIndex].LOD;
   int newLOD = lod;
   if (lod < 0 && visible)
     {
@@ -784,13 +1165,16 @@ void msvVTKXMLMultiblockLODReader::SetPieceVisibility(int pieceIndex, bool visib
 //------------------------------------------------------------------------------
 int msvVTKXMLMultiblockLODReader::GetPieceFromCompositeIndex(vtkIdType compositeIndex)
 {
-  this->Internal->CurrentFlatIndex = 0;
-  int pieceIndex = this->Internal->GetNodePieceIndex(
-    this->GetPrimaryElement(),
-    this->Internal->GetFatherIndex(compositeIndex));
-  //int pieceIndex = this->Internal->GetNodePieceIndex(
-  //  this->GetPrimaryElement(), compositeIndex);
-  return pieceIndex;
+  this->Internal->InitListUpdateNodes(this->GetPrimaryElement(),
+                                      this->GetFileName());
+  if (compositeIndex < 0 ||
+      compositeIndex >= static_cast<vtkIdType>(this->Internal->NodesInfos.size()))
+    {
+    return -1;
+    }
+  int pieceFlatIndex = this->Internal->NodesInfos[compositeIndex].PieceIndex;
+  return pieceFlatIndex >= 0 ?
+    this->Internal->NodesInfos[pieceFlatIndex].ChildIndex : -1;
 }
 
 //------------------------------------------------------------------------------
@@ -798,3 +1182,37 @@ void msvVTKXMLMultiblockLODReader::RestoreDefaultLOD()
 {
   this->SetDefaultLOD(this->Internal->DefaultLOD);
 }
+
+//------------------------------------------------------------------------------
+int msvVTKXMLMultiblockLODReader::GetNumberOfLODPieces()
+{
+  this->Internal->InitListUpdateNodes(this->GetPrimaryElement(),
+                                      this->GetFileName());
+  return static_cast<int>(this->Internal->Pieces.size());
+}
+
+//------------------------------------------------------------------------------
+int msvVTKXMLMultiblockLODReader::GetPieceNumberOfLODs(int pieceIndex)
+{
+  this->Internal->InitListUpdateNodes(this->GetPrimaryElement(),
+                                      this->GetFileName());
+  int flatIndex = this->Internal->GetPieceFlatIndex(pieceIndex);
+  return flatIndex >= 0 ? this->Internal->NodesInfos[flatIndex].NumberOfLODs
+    : 0;
+}
+
+//------------------------------------------------------------------------------
+vtkIdType msvVTKXMLMultiblockLODReader::GetPieceLODStatistics(int pieceIndex,
+                                                              int lod,
+                                                              double bounds[6])
+{
+  this->Internal->InitListUpdateNodes(this->GetPrimaryElement(),
+                                      this->GetFileName());
+  int flatIndex = this->Internal->GetPieceFlatIndex(pieceIndex);
+  if (flatIndex < 0)
+    {
+    vtkMath::UninitializeBounds(bounds);
+    return -1;
+    }
+  return this->Internal->GetLODStatistics(flatIndex, lod, bounds);
+}
@@ -19,8 +19,16 @@
 ==============================================================================*/
 
 // By default the LOD setted is clampled to the closest available
-// CAUTION: please do not try to introduce optimization within the three searc
-// as it will break the FlatIndex
+// The LOD of each piece is kept in a flat table indexed like the composite
+// (flat) indices of the output, built once per file, so that changing or
+// querying the LOD of a piece does not walk the XML tree.
+// When only LODs change between two updates, the output is updated in place:
+// the leaves that stay selected keep their dataset and only the newly
+// selected leaves are read.
+// The leaves that leave the output stay resident, so that switching back to
+// their LOD does not read them again, until their total memory size with the
+// leaves of the output exceeds MemoryBudget: the leaves out of the output
+// for the longest time are evicted first.
 
 #ifndef __msvVTKXMLMultiblockLODReader_h
 #define __msvVTKXMLMultiblockLODReader_h
@@ -31,6 +39,7 @@
 #include "vtkXMLMultiBlockDataReader.h"
 
 
+class vtkDataSet;
 class msvVTKXMLMultiblockLODReaderInternal;
 
 class MSV_VTK_PARALLEL_EXPORT msvVTKXMLMultiblockLODReader : public vtkXMLMultiBlockDataReader
@@ -54,6 +63,17 @@ public:
   // Given the  number Index of a piece, request him to change its LOD.
   void SetPieceLOD(int pieceIndex, unsigned int lod);
 
+  // Description:
+  // Change the LOD of numberOfPieces pieces at once: pieceIndices[i] is
+  // set to lods[i]. The reader is modified only once, and only if a LOD
+  // actually changed.
+  void SetPieceLODs(int numberOfPieces, const int* pieceIndices,
+                    const unsigned int* lods);
+
+  // Description:
+  // Return the LOD of a given piece, -(lod+1) if the piece is hidden.
+  int GetPieceLOD(int pieceIndex);
+
   // Description:
   // Set the visibility of a given piece. When the visibility is restored, the
   // LOD is restored too.
@@ -63,6 +83,63 @@ public:
   // Return the piece index of a composite index.
   int GetPieceFromCompositeIndex(vtkIdType compositeIndex);
 
+  // Description:
+  // Number of piece indices, i.e. of nested elements of the root, including
+  // the ones that are not pieces.
+  int GetNumberOfLODPieces();
+
+  // Description:
+  // Number of LODs of a piece, 0 if pieceIndex is not a piece.
+  int GetPieceNumberOfLODs(int pieceIndex);
+
+  // Description:
+  // Return the number of cells of a LOD of a piece, and set bounds to the
+  // bounds of its datasets. They are given by the optional
+  // "number_of_cells" and "bounds" attributes of the DataSet elements, or
+  // measured the first time the datasets are read. -1 is returned if the
+  // number of cells is unknown, and bounds are uninitialized (min > max) if
+  // unknown.
+  vtkIdType GetPieceLODStatistics(int pieceIndex, int lod, double bounds[6]);
+
+  // Description:
+  // Number of leaf datasets read from their file since the reader was
+  // created. Leaves already in the output are not read again.
+  vtkGetMacro(NumberOfDataSetReads, int);
+
+  // Description:
+  // Number of threads reading the leaf datasets. When greater than 1, the
+  // leaves to read are first collected, then read concurrently, each on the
+  // reader of its node, and finally inserted in the output in flat index
+  // order. The leaves are read one after the other when 1. 1 by default.
+  vtkGetMacro(NumberOfReadThreads, int);
+  vtkSetClampMacro(NumberOfReadThreads, int, 1, VTK_LARGE_INTEGER);
+
+  // Description:
+  // Maximum memory size of the resident leaves, in kibibytes as returned
+  // by vtkDataObject::GetActualMemorySize(). The leaves of the output are
+  // kept even if they exceed it. 262144 (256 MiB) by default.
+  vtkGetMacro(MemoryBudget, unsigned long);
+  vtkSetMacro(MemoryBudget, unsigned long);
+
+  // Description:
+  // Memory size of the resident leaves, in and out of the output, in
+  // kibibytes.
+  unsigned long GetCacheMemorySize();
+
+  // Description:
+  // Number of resident leaves out of the output.
+  int GetNumberOfCachedLeaves();
+
+  // Description:
+  // Number of leaves entering the output that were resident (hits) or
+  // read from their file (misses), and number of leaves evicted to stay
+  // within the memory budget, since the last call to
+  // ResetCacheStatistics().
+  vtkGetMacro(CacheHits, int);
+  vtkGetMacro(CacheMisses, int);
+  vtkGetMacro(CacheEvictions, int);
+  void ResetCacheStatistics();
+
 protected:
   msvVTKXMLMultiblockLODReader();
   ~msvVTKXMLMultiblockLODReader();
@@ -88,6 +165,41 @@ protected:
   // process should get read the dataset within the composite.
   bool ShouldGetDataSet(int datasetIndex, vtkXMLDataElement* node);
 
+  // Description:
+  // Attach the children of the root, i.e. the composite nodes and the
+  // leaves in the output, to the output of the last complete read. The
+  // pipeline initializes the output before each update, which empties it.
+  void AttachRootChildren();
+
+  // Description:
+  // Add the newly selected leaves to the output of the last complete read
+  // and remove the unselected ones.
+  void UpdateLeaves(const char* filePath);
+
+  // Description:
+  // Return the dataset of the leaf at the current flat index: the one
+  // already in the output if any, otherwise the one read from element.
+  // With several NumberOfReadThreads, a leaf to read is queued and NULL is
+  // returned: it is inserted in the output by ReadLeafJobs().
+  vtkDataSet* GetLeafDataSet(vtkXMLDataElement* element, const char* filePath);
+
+  // Description:
+  // Read the queued leaves on NumberOfReadThreads threads and insert them
+  // in the output. Return 0 if a leaf could not be read.
+  int ReadLeafJobs();
+
+  // Description:
+  // Evict the resident leaves out of the output, least recently in the
+  // output first, until the resident leaves fit in the memory budget.
+  void EvictLeaves();
+
+  int NumberOfDataSetReads;
+  int NumberOfReadThreads;
+  unsigned long MemoryBudget;
+  int CacheHits;
+  int CacheMisses;
+  int CacheEvictions;
+
 private:
   msvVTKXMLMultiblockLODReader(const msvVTKXMLMultiblockLODReader&);  // Not implemented.
   void operator=(const msvVTKXMLMultiblockLODReader&);                // Not implemented.